@@ -2,27 +2,22 @@
 //! Copyright (c) CELSYS Inc.
 //! All Rights Reserved.
 #include "TriglavPlugInSDK/TriglavPlugInSDK.h"
+#include "SLICCore.h"
+#include "SLICStream.h"
+#include "SLICProfiler.h"
+#include "SLICIdleTimer.h"
 #include <vector>
 #include <cmath>
 #include <algorithm>
 #include <string>
 #include <limits>
-#include <fstream>
-#include <iostream>
 #include <exception>
 
 
-#define ENABLE_LOGGING 0 // 1: Enable logging, 0: Disable logging
-
+// Messages go to the profiler ring with the phase timings; set SLIC_PROFILE=<path> before
+// starting the host to record them (written at the end of every FilterRun)
 static void Log(const std::string& msg) {
-#if ENABLE_LOGGING
-	try {
-		std::ofstream outfile("C:\\Temp\\slic_debug.txt", std::ios_base::app);
-		if (outfile.is_open()) {
-			outfile << msg << std::endl;
-		}
-	} catch (...) {}
-#endif
+	SLICProfiler::Message(msg);
 }
 
 /* ---------------------------------------------------------------------------
@@ -52,23 +47,75 @@ SOFTWARE.
 // Property Keys
 static const int kItemKeyCellSize = 1;
 static const int kItemKeyCompactness = 2;
+static const int kItemKeyThreads = 3;
+static const int kItemKeyMaxIterations = 4;
+static const int kItemKeyConvergence = 5;
+static const int kItemKeyEngine = 6;
+static const int kItemKeyActiveSet = 7;
+static const int kItemKeyHierarchy = 8;
 
 // String IDs (Must match localized strings if used, or just be unique)
 static const int kStringIDFilterCategoryName = 101;
 static const int kStringIDFilterName = 102;
 static const int kStringIDItemCaptionCellSize = 103;
 static const int kStringIDItemCaptionCompactness = 104;
-
-typedef unsigned char BYTE;
+static const int kStringIDItemCaptionThreads = 105;
+static const int kStringIDItemCaptionMaxIterations = 106;
+static const int kStringIDItemCaptionConvergence = 107;
+static const int kStringIDItemCaptionEngine = 108;
+static const int kStringIDEngineSLIC = 109;
+static const int kStringIDEngineSNIC = 110;
+static const int kStringIDItemCaptionActiveSet = 111;
+static const int kStringIDItemCaptionHierarchy = 112;
+
+// Center movement under which the active set treats a cluster as settled (same metric as the
+// convergence threshold)
+static const double kActiveSetThreshold = 0.5;
+
+// The superpixel hierarchy is built at the smallest cell size; its margin is the one of the
+// largest, so the cached rect serves every cell size and a slider move only cuts again
+static const int kHierarchyBaseStep = 5;
+static const int kHierarchyMargin = 2 * 200;
+
+// The processor's buffers are kept between FilterRun calls, so filtering the same layer again
+// does not allocate; they are freed after this long without a FilterRun
+static const int kBufferIdleReleaseMs = 60 * 1000;
+
+// Lab image of the source, kept across restarts while the offscreen stays the same and the
+// cached rect still covers the rect to process
+struct SLICSourceCache
+{
+	TriglavPlugInOffscreenObject offscreen;
+	TriglavPlugInRect rect;
+	bool valid;
+	SLICProcessor processor; // Lab planes, alpha mask and the centers of the last run
+};
 
 // Filter Info
 struct SLICFilterInfo
 {
 	TriglavPlugInInt cellSize;
 	TriglavPlugInDouble compactness;
+	TriglavPlugInInt threadCount; // 0 = all cores
+	TriglavPlugInInt maxIterations;
+	TriglavPlugInDouble convergence; // 0 = always run maxIterations
+	TriglavPlugInInt engine; // SLICEngine
+	TriglavPlugInBool activeSet; // skip settled clusters after the first iteration
+	TriglavPlugInBool hierarchy; // cut every cell size from one superpixel hierarchy
 	TriglavPlugInPropertyService* pPropertyService;
+	SLICThreadPool* pThreadPool; // Created on first FilterRun, lives until ModuleTerminate
+	SLICSourceCache* pSourceCache; // Same lifetime as pThreadPool
+	SLICIdleTimer* pIdleTimer; // Frees pSourceCache's buffers when idle; same lifetime as pThreadPool
 };
 
+// Frees the buffers kept in the source cache
+static void SLICReleaseBuffers(SLICFilterInfo* pFilterInfo)
+{
+	if (pFilterInfo == NULL || pFilterInfo->pSourceCache == NULL) return;
+	pFilterInfo->pSourceCache->valid = false;
+	pFilterInfo->pSourceCache->processor.Release();
+}
+
 // Property Callback
 static void TRIGLAV_PLUGIN_CALLBACK TriglavPlugInFilterPropertyCallBack(TriglavPlugInInt* result, TriglavPlugInPropertyObject propertyObject, const TriglavPlugInInt itemKey, const TriglavPlugInInt notify, TriglavPlugInPtr data)
 {
@@ -99,307 +146,190 @@ static void TRIGLAV_PLUGIN_CALLBACK TriglavPlugInFilterPropertyCallBack(TriglavP
 					(*result) = kTriglavPlugInPropertyCallBackResultModify;
 				}
 			}
+			else if (itemKey == kItemKeyMaxIterations)
+			{
+				TriglavPlugInInt value;
+				pFilterInfo->pPropertyService->getIntegerValueProc(&value, propertyObject, itemKey);
+				if (pFilterInfo->maxIterations != value)
+				{
+					pFilterInfo->maxIterations = value;
+					(*result) = kTriglavPlugInPropertyCallBackResultModify;
+				}
+			}
+			else if (itemKey == kItemKeyConvergence)
+			{
+				TriglavPlugInDouble value;
+				pFilterInfo->pPropertyService->getDecimalValueProc(&value, propertyObject, itemKey);
+				if (std::abs(pFilterInfo->convergence - value) > 1e-6)
+				{
+					pFilterInfo->convergence = value;
+					(*result) = kTriglavPlugInPropertyCallBackResultModify;
+				}
+			}
+			else if (itemKey == kItemKeyEngine)
+			{
+				TriglavPlugInInt value;
+				pFilterInfo->pPropertyService->getEnumerationValueProc(&value, propertyObject, itemKey);
+				if (pFilterInfo->engine != value)
+				{
+					pFilterInfo->engine = value;
+					(*result) = kTriglavPlugInPropertyCallBackResultModify;
+				}
+			}
+			else if (itemKey == kItemKeyActiveSet)
+			{
+				TriglavPlugInBool value;
+				pFilterInfo->pPropertyService->getBooleanValueProc(&value, propertyObject, itemKey);
+				if (pFilterInfo->activeSet != value)
+				{
+					pFilterInfo->activeSet = value;
+					(*result) = kTriglavPlugInPropertyCallBackResultModify;
+				}
+			}
+			else if (itemKey == kItemKeyHierarchy)
+			{
+				TriglavPlugInBool value;
+				pFilterInfo->pPropertyService->getBooleanValueProc(&value, propertyObject, itemKey);
+				if (pFilterInfo->hierarchy != value)
+				{
+					pFilterInfo->hierarchy = value;
+					(*result) = kTriglavPlugInPropertyCallBackResultModify;
+				}
+			}
+			else if (itemKey == kItemKeyThreads)
+			{
+				// Same output for every thread count, so the preview does not need to rerun
+				TriglavPlugInInt value;
+				pFilterInfo->pPropertyService->getIntegerValueProc(&value, propertyObject, itemKey);
+				pFilterInfo->threadCount = value;
+			}
 		}
 	}
 }
 
-// --- SLIC Implementation ---
+static TriglavPlugInRect SLICIntersectRect(const TriglavPlugInRect& a, const TriglavPlugInRect& b)
+{
+	TriglavPlugInRect rect = { std::max(a.left, b.left), std::max(a.top, b.top), std::min(a.right, b.right), std::min(a.bottom, b.bottom) };
+	return rect;
+}
 
-struct SlicColor {
-	double l, a, b;
-};
+// Layout the offscreen's pixels take in a bitmap: gray layers copy gray + alpha, color layers
+// RGBA in the host's channel order
+static SLICPixelFormat SLICOffscreenPixelFormat(TriglavPlugInOffscreenService* pOffscreenService, TriglavPlugInOffscreenObject offscreen)
+{
+	TriglavPlugInInt channelOrder = kTriglavPlugInOffscreenChannelOrderRGBAlpha;
+	pOffscreenService->getChannelOrderProc(&channelOrder, offscreen);
+	if (channelOrder == kTriglavPlugInOffscreenChannelOrderGrayAlpha) return kSLICPixelGrayAlpha;
+	TriglavPlugInInt r = 0, g = 1, b = 2;
+	pOffscreenService->getRGBChannelIndexProc(&r, &g, &b, offscreen);
+	return (r == 2 && b == 0) ? kSLICPixelBGRA : kSLICPixelRGBA;
+}
+
+// --- Host adapter for SLICProcessor ---
 
-struct SlicCluster {
-	double l, a, b;
-	double x, y;
-	int count;
+struct SLICHostContext
+{
+	TriglavPlugInRecordSuite* pRecordSuite;
+	TriglavPlugInHostObject hostObject;
 };
 
-// RGB to LAB conversion
-static void RGB2LAB(BYTE r, BYTE g, BYTE b, double& lVal, double& aVal, double& bVal)
+static void SLICHostSetProgressDone(void* data, int done)
 {
-	double var_R = (r / 255.0);
-	double var_G = (g / 255.0);
-	double var_B = (b / 255.0);
-
-	if (var_R > 0.04045) var_R = pow((var_R + 0.055) / 1.055, 2.4);
-	else                 var_R = var_R / 12.92;
-	if (var_G > 0.04045) var_G = pow((var_G + 0.055) / 1.055, 2.4);
-	else                 var_G = var_G / 12.92;
-	if (var_B > 0.04045) var_B = pow((var_B + 0.055) / 1.055, 2.4);
-	else                 var_B = var_B / 12.92;
-
-	var_R = var_R * 100.0;
-	var_G = var_G * 100.0;
-	var_B = var_B * 100.0;
-
-	double X = var_R * 0.4124 + var_G * 0.3576 + var_B * 0.1805;
-	double Y = var_R * 0.2126 + var_G * 0.7152 + var_B * 0.0722;
-	double Z = var_R * 0.0193 + var_G * 0.1192 + var_B * 0.9505;
-
-	double var_X = X / 95.047;
-	double var_Y = Y / 100.000;
-	double var_Z = Z / 108.883;
-
-	if (var_X > 0.008856) var_X = pow(var_X, (1.0 / 3.0));
-	else                  var_X = (7.787 * var_X) + (16.0 / 116.0);
-	if (var_Y > 0.008856) var_Y = pow(var_Y, (1.0 / 3.0));
-	else                  var_Y = (7.787 * var_Y) + (16.0 / 116.0);
-	if (var_Z > 0.008856) var_Z = pow(var_Z, (1.0 / 3.0));
-	else                  var_Z = (7.787 * var_Z) + (16.0 / 116.0);
-
-	lVal = (116.0 * var_Y) - 16.0;
-	aVal = 500.0 * (var_X - var_Y);
-	bVal = 200.0 * (var_Y - var_Z);
+	SLICHostContext* pContext = static_cast<SLICHostContext*>(data);
+	TriglavPlugInFilterRunSetProgressDone(pContext->pRecordSuite, pContext->hostObject, done);
 }
 
-// LAB to RGB conversion
-static void LAB2RGB(double lVal, double aVal, double bVal, BYTE& r, BYTE& g, BYTE& b)
+static int SLICHostProcess(void* data)
 {
-	double var_Y = (lVal + 16.0) / 116.0;
-	double var_X = aVal / 500.0 + var_Y;
-	double var_Z = var_Y - bVal / 200.0;
-
-	if (pow(var_Y, 3) > 0.008856) var_Y = pow(var_Y, 3);
-	else                          var_Y = (var_Y - 16.0 / 116.0) / 7.787;
-	if (pow(var_X, 3) > 0.008856) var_X = pow(var_X, 3);
-	else                          var_X = (var_X - 16.0 / 116.0) / 7.787;
-	if (pow(var_Z, 3) > 0.008856) var_Z = pow(var_Z, 3);
-	else                          var_Z = (var_Z - 16.0 / 116.0) / 7.787;
-
-	double X = var_X * 95.047;
-	double Y = var_Y * 100.000;
-	double Z = var_Z * 108.883;
-
-	double var_R = X * 3.2406 + Y * -1.5372 + Z * -0.4986;
-	double var_G = X * -0.9689 + Y * 1.8758 + Z * 0.0415;
-	double var_B = X * 0.0557 + Y * -0.2040 + Z * 1.0570;
-
-	var_R = var_R / 100.0;
-	var_G = var_G / 100.0;
-	var_B = var_B / 100.0;
-
-	if (var_R > 0.0031308) var_R = 1.055 * pow(var_R, (1.0 / 2.4)) - 0.055;
-	else                   var_R = 12.92 * var_R;
-	if (var_G > 0.0031308) var_G = 1.055 * pow(var_G, (1.0 / 2.4)) - 0.055;
-	else                   var_G = 12.92 * var_G;
-	if (var_B > 0.0031308) var_B = 1.055 * pow(var_B, (1.0 / 2.4)) - 0.055;
-	else                   var_B = 12.92 * var_B;
-
-	var_R = std::max(0.0, std::min(1.0, var_R));
-	var_G = std::max(0.0, std::min(1.0, var_G));
-	var_B = std::max(0.0, std::min(1.0, var_B));
-
-	r = (BYTE)(var_R * 255.0);
-	g = (BYTE)(var_G * 255.0);
-	b = (BYTE)(var_B * 255.0);
+	SLICHostContext* pContext = static_cast<SLICHostContext*>(data);
+	TriglavPlugInInt processResult = 0;
+	TriglavPlugInFilterRunProcess(pContext->pRecordSuite, &processResult, pContext->hostObject, kTriglavPlugInFilterRunProcessStateContinue);
+	if (processResult == kTriglavPlugInFilterRunProcessResultExit) return kSLICResultExit;
+	if (processResult == kTriglavPlugInFilterRunProcessResultRestart) return kSLICResultRestart;
+	return kSLICResultContinue;
 }
 
-class SLICProcessor {
-public:
-	TriglavPlugInInt width, height;
-	std::vector<SlicColor> labData;
-	std::vector<int> labels;
-	std::vector<double> distances;
-	std::vector<SlicCluster> clusters;
-	std::vector<BYTE> resultRGB; // Storing final RGB to quickly serve blocks
-	std::vector<bool> validPixels;
-
-	// Modified Initialize to take raw pointers
-	void Initialize(TriglavPlugInInt w, TriglavPlugInInt h, const BYTE* srcBuffer, TriglavPlugInInt rowBytes, TriglavPlugInInt pixelBytes) {
-		width = w;
-		height = h;
-		size_t totalPixels = (size_t)w * (size_t)h;
-		labData.resize(totalPixels);
-		labels.assign(totalPixels, -1);
-		distances.assign(totalPixels, std::numeric_limits<double>::max());
-		resultRGB.resize(totalPixels * 4); // Keep it RGBA
-		validPixels.resize(totalPixels);
-
-		// Convert Input to Lab
-		for (TriglavPlugInInt y = 0; y < h; y++) {
-			const BYTE* srcRow = srcBuffer + (y * rowBytes);
-			for (TriglavPlugInInt x = 0; x < w; x++) {
-				size_t idx = (size_t)y * w + x;
-				const BYTE* px = srcRow + (x * pixelBytes);
-				
-				// Assumes pixelBytes >= 4 for RGBA, or at least 3 for RGB
-				BYTE r = px[0];
-				BYTE g = px[1];
-				BYTE b = px[2];
-				BYTE alpha = (pixelBytes >= 4) ? px[3] : 255;
-
-				double l, a, b_val; // b_val to avoid conflict with 'b'
-				RGB2LAB(r, g, b, l, a, b_val);
-				labData[idx] = { l, a, b_val };
-
-				validPixels[idx] = (alpha != 0);
-
-				// Initialize result with original
-				resultRGB[idx*4+0] = r;
-				resultRGB[idx*4+1] = g;
-				resultRGB[idx*4+2] = b;
-				resultRGB[idx*4+3] = alpha;
-			}
-		}
-	}
+// --- Band access for SLICStreamProcessor ---
 
-	TriglavPlugInInt Execute(int step, double m, TriglavPlugInRecordSuite* pRecordSuite, TriglavPlugInHostObject hostObject, TriglavPlugInInt* pCurrentProgress, TriglavPlugInInt progressUnit) {
-		if (step < 2) step = 2; // min step
-
-		// 1. Initialize Centers
-		clusters.clear();
-		for (TriglavPlugInInt y = step / 2; y < height; y += step) {
-			for (TriglavPlugInInt x = step / 2; x < width; x += step) {
-				TriglavPlugInInt cx = x;
-				TriglavPlugInInt cy = y;
-				size_t centerIdx = (size_t)cy * width + cx;
-
-				// If grid center is transparent (invalid), search neighbors for a valid spot
-				if (!validPixels[centerIdx]) {
-					bool found = false;
-					int searchRange = step / 2; 
-
-					TriglavPlugInInt startY = std::max<TriglavPlugInInt>(0, y - searchRange);
-					TriglavPlugInInt endY = std::min<TriglavPlugInInt>(height, y + searchRange);
-					TriglavPlugInInt startX = std::max<TriglavPlugInInt>(0, x - searchRange);
-					TriglavPlugInInt endX = std::min<TriglavPlugInInt>(width, x + searchRange);
-
-					for (TriglavPlugInInt ny = startY; ny < endY; ny++) {
-						for (TriglavPlugInInt nx = startX; nx < endX; nx++) {
-							if (validPixels[(size_t)ny * width + nx]) {
-								// Found a valid pixel
-								cx = nx;
-								cy = ny;
-								centerIdx = (size_t)ny * width + nx;
-								found = true;
-								break;
-							}
-						}
-						if (found) break;
-					}
-					// If no valid pixel found in neighborhood, skip this cluster
-					if (!found) continue;
-				}
+// Reads bands of processRect from the source offscreen and writes the part of each rendered band
+// inside writeRect to the destination. Both band bitmaps are width x bandRows.
+struct SLICHostStreamIO
+{
+	TriglavPlugInRecordSuite* pRecordSuite;
+	TriglavPlugInHostObject hostObject;
+	TriglavPlugInBitmapService* pBitmapService;
+	TriglavPlugInOffscreenService* pOffscreenService;
+	TriglavPlugInOffscreenObject sourceOffscreen;
+	TriglavPlugInOffscreenObject destinationOffscreen;
+	TriglavPlugInRect processRect;
+	TriglavPlugInRect writeRect;
+	TriglavPlugInInt bandRows;
+	TriglavPlugInInt pixelBytes;
+	TriglavPlugInBitmapObject sourceBand;
+	TriglavPlugInBitmapObject resultBand;
+
+	~SLICHostStreamIO()
+	{
+		if (sourceBand != NULL) pBitmapService->releaseProc(sourceBand);
+		if (resultBand != NULL) pBitmapService->releaseProc(resultBand);
+	}
 
-				SlicColor c = labData[centerIdx];
-				clusters.push_back({ c.l, c.a, c.b, (double)cx, (double)cy, 0 });
-			}
+	BYTE* BandAddress(TriglavPlugInBitmapObject* pBand, int* pRowBytes)
+	{
+		TriglavPlugInInt width = processRect.right - processRect.left;
+		if (*pBand == NULL && pBitmapService->createProc(pBand, width, bandRows, pixelBytes, kTriglavPlugInBitmapScanlineHorizontalLeftTop) != kTriglavPlugInAPIResultSuccess) {
+			*pBand = NULL;
+			return NULL;
 		}
+		TriglavPlugInPoint zeroPos = {0, 0};
+		TriglavPlugInPtr address = NULL;
+		pBitmapService->getAddressProc(&address, *pBand, &zeroPos);
+		TriglavPlugInInt rowBytes = 0;
+		pBitmapService->getRowBytesProc(&rowBytes, *pBand);
+		*pRowBytes = rowBytes;
+		return (BYTE*)address;
+	}
+};
 
-		int ns = step;
-		// 2. Iterations
-		for (int iter = 0; iter < 10; iter++) {
-			// Update Progress for Iteration
-			if (pCurrentProgress) {
-				*pCurrentProgress += progressUnit;
-				TriglavPlugInFilterRunSetProgressDone(pRecordSuite, hostObject, *pCurrentProgress);
-			}
-
-			TriglavPlugInInt processResult = 0;
-			TriglavPlugInFilterRunProcess(pRecordSuite, &processResult, hostObject, kTriglavPlugInFilterRunProcessStateContinue);
-			if (processResult == kTriglavPlugInFilterRunProcessResultExit || processResult == kTriglavPlugInFilterRunProcessResultRestart) {
-				return processResult;
-			}
-
-			// Assignment
-			for (int k = 0; k < (int)clusters.size(); k++) {
-				int cx = (int)clusters[k].x;
-				int cy = (int)clusters[k].y;
-				
-				// Search region 2S x 2S
-				TriglavPlugInInt startX = std::max<TriglavPlugInInt>(0, cx - ns);
-				TriglavPlugInInt startY = std::max<TriglavPlugInInt>(0, cy - ns);
-				TriglavPlugInInt endX = std::min<TriglavPlugInInt>(width, cx + ns);
-				TriglavPlugInInt endY = std::min<TriglavPlugInInt>(height, cy + ns);
-
-				for (TriglavPlugInInt y = startY; y < endY; y++) {
-					for (TriglavPlugInInt x = startX; x < endX; x++) {
-						size_t idx = (size_t)y * width + x;
-						if (!validPixels[idx]) continue;
-
-						SlicColor pixel = labData[idx];
-						
-						double d_lab = std::pow(pixel.l - clusters[k].l, 2) + 
-									   std::pow(pixel.a - clusters[k].a, 2) + 
-									   std::pow(pixel.b - clusters[k].b, 2);
-						
-						double d_xy = std::pow(x - clusters[k].x, 2) + 
-									  std::pow(y - clusters[k].y, 2);
-						
-						double D = d_lab + (m * m / (ns * ns)) * d_xy;
-
-						if (D < distances[idx]) {
-							distances[idx] = D;
-							labels[idx] = k;
-						}
-					}
-				}
-			}
-
-			// Restore previous clusters to handle empty ones
-			std::vector<SlicCluster> prevClusters = clusters;
-
-			// Update
-			for (auto& c : clusters) {
-				c.l = c.a = c.b = c.x = c.y = 0.0;
-				c.count = 0;
-			}
-
-			for (size_t i = 0; i < (size_t)width * height; i++) {
-				if (!validPixels[i]) continue;
-				int k = labels[i];
-				if (k >= 0 && k < (int)clusters.size()) {
-					clusters[k].l += labData[i].l;
-					clusters[k].a += labData[i].a;
-					clusters[k].b += labData[i].b;
-					clusters[k].x += (i % width);
-					clusters[k].y += (i / width);
-					clusters[k].count++;
-				}
-			}
+static const BYTE* SLICHostReadRows(void* data, int y, int rows, int* pRowBytes)
+{
+	SLICHostStreamIO* pIO = static_cast<SLICHostStreamIO*>(data);
+	BYTE* band = pIO->BandAddress(&pIO->sourceBand, pRowBytes);
+	if (band == NULL) return NULL;
+	TriglavPlugInPoint zeroPos = {0, 0};
+	TriglavPlugInPoint srcPos = {pIO->processRect.left, pIO->processRect.top + y};
+	TriglavPlugInInt width = pIO->processRect.right - pIO->processRect.left;
+	SLICProfileScope profile("offscreen copy", y);
+	if (pIO->pOffscreenService->getBitmapProc(pIO->sourceBand, &zeroPos, pIO->sourceOffscreen, &srcPos, width, rows, kTriglavPlugInOffscreenCopyModeNormal) != kTriglavPlugInAPIResultSuccess) {
+		Log("Failed to read band at " + std::to_string(y));
+		return NULL;
+	}
+	return band;
+}
 
-			// Average
-			for (size_t k = 0; k < clusters.size(); k++) {
-				if (clusters[k].count > 0) {
-					clusters[k].l /= clusters[k].count;
-					clusters[k].a /= clusters[k].count;
-					clusters[k].b /= clusters[k].count;
-					clusters[k].x /= clusters[k].count;
-					clusters[k].y /= clusters[k].count;
-				} else {
-					// Restore previous state if empty to prevent zeroing/black blocks
-					clusters[k] = prevClusters[k];
-				}
-			}
-			
-			// Reset distances for next iter (except last one)
-			if (iter < 9) {
-				distances.assign((size_t)width * height, std::numeric_limits<double>::max());
-			}
-		}
-		
-		// 3. Render Output
-		// Update Progress for Render
-		if (pCurrentProgress) {
-			*pCurrentProgress += progressUnit;
-			TriglavPlugInFilterRunSetProgressDone(pRecordSuite, hostObject, *pCurrentProgress);
-		}
+static BYTE* SLICHostBeginWriteRows(void* data, int y, int rows, int* pRowBytes)
+{
+	SLICHostStreamIO* pIO = static_cast<SLICHostStreamIO*>(data);
+	return pIO->BandAddress(&pIO->resultBand, pRowBytes);
+}
 
-		for (size_t i = 0; i < (size_t)width * height; i++) {
-			int k = labels[i];
-			if (k >= 0 && k < (int)clusters.size()) {
-				BYTE r, g, b;
-				LAB2RGB(clusters[k].l, clusters[k].a, clusters[k].b, r, g, b);
-				resultRGB[i * 4 + 0] = r;
-				resultRGB[i * 4 + 1] = g;
-				resultRGB[i * 4 + 2] = b;
-				// resultRGB[i * 4 + 3] is already original alpha or 255
-			}
-		}
-		return kTriglavPlugInFilterRunProcessResultContinue;
+static bool SLICHostEndWriteRows(void* data, int y, int rows)
+{
+	SLICHostStreamIO* pIO = static_cast<SLICHostStreamIO*>(data);
+	TriglavPlugInRect bandRect = { pIO->processRect.left, pIO->processRect.top + y, pIO->processRect.right, pIO->processRect.top + y + rows };
+	TriglavPlugInRect rect = SLICIntersectRect(bandRect, pIO->writeRect);
+	if (rect.bottom <= rect.top) return true;
+
+	TriglavPlugInPoint dstPos = {rect.left, rect.top};
+	TriglavPlugInPoint bandPos = {rect.left - bandRect.left, rect.top - bandRect.top};
+	SLICProfileScope profile("write back", y);
+	if (pIO->pOffscreenService->setBitmapProc(pIO->destinationOffscreen, &dstPos, pIO->resultBand, &bandPos, rect.right - rect.left, rect.bottom - rect.top, kTriglavPlugInOffscreenCopyModeNormal) != kTriglavPlugInAPIResultSuccess) {
+		Log("Failed to write band at " + std::to_string(y));
+		return false;
 	}
-};
+	TriglavPlugInFilterRunUpdateDestinationOffscreenRect(pIO->pRecordSuite, pIO->hostObject, &rect);
+	return true;
+}
 
 
 //	Main Entry Point
@@ -425,9 +355,21 @@ void TRIGLAV_PLUGIN_API TriglavPluginCall(TriglavPlugInInt* result, TriglavPlugI
 					(*pModuleInitializeRecord).setModuleKindProc((*pluginServer).hostObject, kTriglavPlugInModuleSwitchKindFilter);
 					(*pStringService).releaseProc(moduleID);
 
+					SLICProfiler::ConfigureFromEnvironment();
+
 					SLICFilterInfo* pFilterInfo = new SLICFilterInfo;
 					pFilterInfo->cellSize = 30;
 					pFilterInfo->compactness = 20.0;
+					pFilterInfo->threadCount = 0;
+					pFilterInfo->maxIterations = 10;
+					pFilterInfo->convergence = 0.5;
+					pFilterInfo->engine = kSLICEngineSLIC;
+					pFilterInfo->activeSet = true;
+					pFilterInfo->hierarchy = false;
+					pFilterInfo->pPropertyService = NULL;
+					pFilterInfo->pThreadPool = NULL;
+					pFilterInfo->pSourceCache = NULL;
+					pFilterInfo->pIdleTimer = NULL;
 					*data = pFilterInfo;
 					*result = kTriglavPlugInCallResultSuccess;
 				}
@@ -436,7 +378,12 @@ void TRIGLAV_PLUGIN_API TriglavPluginCall(TriglavPlugInInt* result, TriglavPlugI
 		else if (selector == kTriglavPlugInSelectorModuleTerminate)
 		{
 			SLICFilterInfo* pFilterInfo = static_cast<SLICFilterInfo*>(*data);
-			if (pFilterInfo) delete pFilterInfo;
+			if (pFilterInfo) {
+				delete pFilterInfo->pIdleTimer; // joins the timer thread before the cache goes
+				delete pFilterInfo->pSourceCache;
+				delete pFilterInfo->pThreadPool;
+				delete pFilterInfo;
+			}
 			*data = NULL;
 			*result = kTriglavPlugInCallResultSuccess;
 		}
@@ -461,8 +408,10 @@ void TRIGLAV_PLUGIN_API TriglavPluginCall(TriglavPlugInInt* result, TriglavPlugI
 
 				TriglavPlugInFilterInitializeSetCanPreview(pRecordSuite, hostObject, true);
 
-				TriglavPlugInInt target[] = { kTriglavPlugInFilterTargetKindRasterLayerRGBAlpha };
-				TriglavPlugInFilterInitializeSetTargetKinds(pRecordSuite, hostObject, target, 1);
+				// Gray layers are clustered on L alone. Binarized and alpha only layers have no
+				// tones to segment.
+				TriglavPlugInInt target[] = { kTriglavPlugInFilterTargetKindRasterLayerGrayAlpha, kTriglavPlugInFilterTargetKindRasterLayerRGBAlpha };
+				TriglavPlugInFilterInitializeSetTargetKinds(pRecordSuite, hostObject, target, 2);
 
 				TriglavPlugInPropertyObject propertyObject;
 				(*pPropertyService).createProc(&propertyObject);
@@ -487,6 +436,68 @@ void TRIGLAV_PLUGIN_API TriglavPluginCall(TriglavPlugInInt* result, TriglavPlugI
 				(*pPropertyService).setDecimalMaxValueProc(propertyObject, kItemKeyCompactness, 100.0);
 				(*pStringService).releaseProc(compactCaption);
 
+				// Threads (Integer, 0 = all cores)
+				TriglavPlugInStringObject threadsCaption = NULL;
+				(*pStringService).createWithStringIDProc(&threadsCaption, kStringIDItemCaptionThreads, hostObject);
+				(*pPropertyService).addItemProc(propertyObject, kItemKeyThreads, kTriglavPlugInPropertyValueTypeInteger, kTriglavPlugInPropertyValueKindDefault, kTriglavPlugInPropertyInputKindDefault, threadsCaption, 't');
+				(*pPropertyService).setIntegerValueProc(propertyObject, kItemKeyThreads, 0);
+				(*pPropertyService).setIntegerDefaultValueProc(propertyObject, kItemKeyThreads, 0);
+				(*pPropertyService).setIntegerMinValueProc(propertyObject, kItemKeyThreads, 0);
+				(*pPropertyService).setIntegerMaxValueProc(propertyObject, kItemKeyThreads, 64);
+				(*pStringService).releaseProc(threadsCaption);
+
+				// Max Iterations (Integer)
+				TriglavPlugInStringObject iterationsCaption = NULL;
+				(*pStringService).createWithStringIDProc(&iterationsCaption, kStringIDItemCaptionMaxIterations, hostObject);
+				(*pPropertyService).addItemProc(propertyObject, kItemKeyMaxIterations, kTriglavPlugInPropertyValueTypeInteger, kTriglavPlugInPropertyValueKindDefault, kTriglavPlugInPropertyInputKindDefault, iterationsCaption, 'i');
+				(*pPropertyService).setIntegerValueProc(propertyObject, kItemKeyMaxIterations, 10);
+				(*pPropertyService).setIntegerDefaultValueProc(propertyObject, kItemKeyMaxIterations, 10);
+				(*pPropertyService).setIntegerMinValueProc(propertyObject, kItemKeyMaxIterations, 1);
+				(*pPropertyService).setIntegerMaxValueProc(propertyObject, kItemKeyMaxIterations, 50);
+				(*pStringService).releaseProc(iterationsCaption);
+
+				// Convergence (Decimal, mean center movement; 0 = off)
+				TriglavPlugInStringObject convergenceCaption = NULL;
+				(*pStringService).createWithStringIDProc(&convergenceCaption, kStringIDItemCaptionConvergence, hostObject);
+				(*pPropertyService).addItemProc(propertyObject, kItemKeyConvergence, kTriglavPlugInPropertyValueTypeDecimal, kTriglavPlugInPropertyValueKindDefault, kTriglavPlugInPropertyInputKindDefault, convergenceCaption, 'e');
+				(*pPropertyService).setDecimalValueProc(propertyObject, kItemKeyConvergence, 0.5);
+				(*pPropertyService).setDecimalDefaultValueProc(propertyObject, kItemKeyConvergence, 0.5);
+				(*pPropertyService).setDecimalMinValueProc(propertyObject, kItemKeyConvergence, 0.0);
+				(*pPropertyService).setDecimalMaxValueProc(propertyObject, kItemKeyConvergence, 10.0);
+				(*pStringService).releaseProc(convergenceCaption);
+
+				// Engine (Enumeration): iterative SLIC (default, the fastest) or single pass SNIC (slower)
+				TriglavPlugInStringObject engineCaption = NULL;
+				TriglavPlugInStringObject engineSLICCaption = NULL;
+				TriglavPlugInStringObject engineSNICCaption = NULL;
+				(*pStringService).createWithStringIDProc(&engineCaption, kStringIDItemCaptionEngine, hostObject);
+				(*pStringService).createWithStringIDProc(&engineSLICCaption, kStringIDEngineSLIC, hostObject);
+				(*pStringService).createWithStringIDProc(&engineSNICCaption, kStringIDEngineSNIC, hostObject);
+				(*pPropertyService).addItemProc(propertyObject, kItemKeyEngine, kTriglavPlugInPropertyValueTypeEnumeration, kTriglavPlugInPropertyValueKindDefault, kTriglavPlugInPropertyInputKindDefault, engineCaption, 'g');
+				(*pPropertyService).addEnumerationItemProc(propertyObject, kItemKeyEngine, kSLICEngineSLIC, engineSLICCaption, 'l');
+				(*pPropertyService).addEnumerationItemProc(propertyObject, kItemKeyEngine, kSLICEngineSNIC, engineSNICCaption, 'n');
+				(*pPropertyService).setEnumerationValueProc(propertyObject, kItemKeyEngine, kSLICEngineSLIC);
+				(*pPropertyService).setEnumerationDefaultValueProc(propertyObject, kItemKeyEngine, kSLICEngineSLIC);
+				(*pStringService).releaseProc(engineCaption);
+				(*pStringService).releaseProc(engineSLICCaption);
+				(*pStringService).releaseProc(engineSNICCaption);
+
+				// Active set (Boolean): after the first iteration only reassign clusters near one that moved
+				TriglavPlugInStringObject activeSetCaption = NULL;
+				(*pStringService).createWithStringIDProc(&activeSetCaption, kStringIDItemCaptionActiveSet, hostObject);
+				(*pPropertyService).addItemProc(propertyObject, kItemKeyActiveSet, kTriglavPlugInPropertyValueTypeBoolean, kTriglavPlugInPropertyValueKindDefault, kTriglavPlugInPropertyInputKindDefault, activeSetCaption, 'a');
+				(*pPropertyService).setBooleanValueProc(propertyObject, kItemKeyActiveSet, true);
+				(*pPropertyService).setBooleanDefaultValueProc(propertyObject, kItemKeyActiveSet, true);
+				(*pStringService).releaseProc(activeSetCaption);
+
+				// Superpixel hierarchy
+				TriglavPlugInStringObject hierarchyCaption = NULL;
+				(*pStringService).createWithStringIDProc(&hierarchyCaption, kStringIDItemCaptionHierarchy, hostObject);
+				(*pPropertyService).addItemProc(propertyObject, kItemKeyHierarchy, kTriglavPlugInPropertyValueTypeBoolean, kTriglavPlugInPropertyValueKindDefault, kTriglavPlugInPropertyInputKindDefault, hierarchyCaption, 'h');
+				(*pPropertyService).setBooleanValueProc(propertyObject, kItemKeyHierarchy, false);
+				(*pPropertyService).setBooleanDefaultValueProc(propertyObject, kItemKeyHierarchy, false);
+				(*pStringService).releaseProc(hierarchyCaption);
+
 				TriglavPlugInFilterInitializeSetProperty(pRecordSuite, hostObject, propertyObject);
 				TriglavPlugInFilterInitializeSetPropertyCallBack(pRecordSuite, hostObject, TriglavPlugInFilterPropertyCallBack, *data);
 				(*pPropertyService).releaseProc(propertyObject);
@@ -530,15 +541,36 @@ void TRIGLAV_PLUGIN_API TriglavPluginCall(TriglavPlugInInt* result, TriglavPlugI
 					TriglavPlugInOffscreenObject destinationOffscreenObject;
 					TriglavPlugInFilterRunGetDestinationOffscreen(pRecordSuite, &destinationOffscreenObject, (*pluginServer).hostObject);
 
-					// We use full extent instead of block iteration
+					// Only the selection bounding box is written; see the processing rect below
 					TriglavPlugInRect selectAreaRect;
 					TriglavPlugInFilterRunGetSelectAreaRect(pRecordSuite, &selectAreaRect, (*pluginServer).hostObject);
 
 					SLICFilterInfo* pFilterInfo = static_cast<SLICFilterInfo*>(*data);
 					pFilterInfo->pPropertyService = pPropertyService;
 
-					// Local processor instance
-					SLICProcessor processor; 
+					// The pool persists across FilterRun calls and restarts
+					if (pFilterInfo->pThreadPool == NULL) {
+						pFilterInfo->pThreadPool = new SLICThreadPool(0);
+					}
+
+					// The processor lives in the cache; the layer may have been edited since the last
+					// FilterRun, so the cache only serves restarts of this call
+					if (pFilterInfo->pSourceCache == NULL) {
+						pFilterInfo->pSourceCache = new SLICSourceCache;
+					}
+					// The buffers kept since the last FilterRun are ours again
+					if (pFilterInfo->pIdleTimer == NULL) {
+						pFilterInfo->pIdleTimer = new SLICIdleTimer;
+					}
+					pFilterInfo->pIdleTimer->Cancel();
+					SLICSourceCache& sourceCache = *pFilterInfo->pSourceCache;
+					sourceCache.valid = false;
+					SLICProcessor& processor = sourceCache.processor;
+					processor.threadPool = pFilterInfo->pThreadPool;
+					// Same labels as the cluster order without the image sized distance plane
+					processor.assignMode = kSLICAssignPixels;
+					SLICHostContext hostContext = { pRecordSuite, (*pluginServer).hostObject };
+					SLICCallbacks callbacks = { &hostContext, SLICHostSetProgressDone, SLICHostProcess };
 					TriglavPlugInInt currentProgress = 0;
 					bool restart = true;
 					
@@ -555,111 +587,272 @@ void TRIGLAV_PLUGIN_API TriglavPluginCall(TriglavPlugInInt* result, TriglavPlugI
 							TriglavPlugInFilterRunProcess(pRecordSuite, &processResult, (*pluginServer).hostObject, kTriglavPlugInFilterRunProcessStateStart);
 							if (processResult == kTriglavPlugInFilterRunProcessResultExit) { break; }
 							
-							// Release previous if restart happened mid-way
-							srcBitmap.Release();
-							dstBitmap.Release();
-
 							// 1. Get Parameters
 							pPropertyService->getIntegerValueProc(&(pFilterInfo->cellSize), propertyObject, kItemKeyCellSize);
 							pPropertyService->getDecimalValueProc(&(pFilterInfo->compactness), propertyObject, kItemKeyCompactness);
-							Log("Parameters - CellSize: " + std::to_string(pFilterInfo->cellSize) + ", Compactness: " + std::to_string(pFilterInfo->compactness));
-
-							// 2. Load Full Image -> Bitmap
+							pPropertyService->getIntegerValueProc(&(pFilterInfo->threadCount), propertyObject, kItemKeyThreads);
+							pPropertyService->getIntegerValueProc(&(pFilterInfo->maxIterations), propertyObject, kItemKeyMaxIterations);
+							pPropertyService->getDecimalValueProc(&(pFilterInfo->convergence), propertyObject, kItemKeyConvergence);
+							pPropertyService->getEnumerationValueProc(&(pFilterInfo->engine), propertyObject, kItemKeyEngine);
+							pPropertyService->getBooleanValueProc(&(pFilterInfo->activeSet), propertyObject, kItemKeyActiveSet);
+							pPropertyService->getBooleanValueProc(&(pFilterInfo->hierarchy), propertyObject, kItemKeyHierarchy);
+							processor.maxIterations = pFilterInfo->maxIterations;
+							processor.convergenceThreshold = pFilterInfo->convergence;
+							processor.activeThreshold = pFilterInfo->activeSet ? kActiveSetThreshold : 0.0;
+							processor.engine = (pFilterInfo->engine == kSLICEngineSNIC) ? kSLICEngineSNIC : kSLICEngineSLIC;
+							pFilterInfo->pThreadPool->SetThreadCount(pFilterInfo->threadCount);
+							Log("Parameters - CellSize: " + std::to_string(pFilterInfo->cellSize) + ", Compactness: " + std::to_string(pFilterInfo->compactness) + ", Threads: " + std::to_string(pFilterInfo->pThreadPool->ThreadCount()));
+
+							// 2. Load Selection Area (+ margin) -> Bitmap
 							TriglavPlugInRect extent;
 							(*pOffscreenService).getExtentRectProc(&extent, sourceOffscreenObject);
-							
-							TriglavPlugInInt width = extent.right - extent.left;
-							TriglavPlugInInt height = extent.bottom - extent.top;
-							
+							SLICPixelFormat pixelFormat = SLICOffscreenPixelFormat(pOffscreenService, sourceOffscreenObject);
+							TriglavPlugInInt pixelBytes = SLICPixelBytes(pixelFormat);
+
+							// Pixels outside the selection are not written, but superpixels at its border
+							// still see 2S of their surroundings so they do not shrink at the edge.
+							TriglavPlugInRect writeRect = SLICIntersectRect(selectAreaRect, extent);
+							TriglavPlugInInt margin = pFilterInfo->hierarchy ? kHierarchyMargin : 2 * pFilterInfo->cellSize;
+							TriglavPlugInRect marginRect = { writeRect.left - margin, writeRect.top - margin, writeRect.right + margin, writeRect.bottom + margin };
+							TriglavPlugInRect processRect = SLICIntersectRect(marginRect, extent);
+
 							Log("Layer Extent: " + std::to_string((long long)extent.left) + "," + std::to_string((long long)extent.top));
-							Log("Bitmap Size: " + std::to_string(width) + "x" + std::to_string(height));
+							Log("Write Rect: " + std::to_string((long long)writeRect.left) + "," + std::to_string((long long)writeRect.top) + " - " + std::to_string((long long)writeRect.right) + "," + std::to_string((long long)writeRect.bottom));
 
-							if (width <= 0 || height <= 0) {
-								Log("Invalid dimensions, breaking.");
+							if (writeRect.right <= writeRect.left || writeRect.bottom <= writeRect.top) {
+								Log("Selection does not touch the layer, breaking.");
 								break;
 							}
-							
-							// Create Source Bitmap (Note: Depth 4 bytes = RGBA 8bit per channel)
-							if((*pBitmapService).createProc(&srcBitmap, width, height, 4, kTriglavPlugInBitmapScanlineHorizontalLeftTop) != kTriglavPlugInAPIResultSuccess) {
-								Log("Failed to create src bitmap");
-								break;
+
+							// A cached rect that covers the one needed now is reused as is (a smaller cell
+							// size only shrinks the margin)
+							bool cacheHit = sourceCache.valid && srcBitmap != NULL && sourceCache.offscreen == sourceOffscreenObject &&
+								sourceCache.rect.left <= processRect.left && sourceCache.rect.top <= processRect.top &&
+								sourceCache.rect.right >= processRect.right && sourceCache.rect.bottom >= processRect.bottom;
+							TriglavPlugInRect neededRect = processRect;
+							if (cacheHit) processRect = sourceCache.rect;
+
+							TriglavPlugInInt width = processRect.right - processRect.left;
+							TriglavPlugInInt height = processRect.bottom - processRect.top;
+
+							// Bytes an in-core run takes with the given layout: its buffers, the hierarchy
+							// clustered at its base step with its merges, and the source and destination
+							// bitmaps at pixelBytes per pixel each
+							auto inCoreBytes = [&](SLICKernel kernel) -> size_t {
+								int estimateStep = pFilterInfo->hierarchy ? kHierarchyBaseStep : pFilterInfo->cellSize;
+								size_t hierarchyBytes = pFilterInfo->hierarchy ? SLICProcessor::HierarchyMemory(width, height, kHierarchyBaseStep) : 0;
+								size_t bitmapBytes = (size_t)width * height * pixelBytes * 2;
+								return SLICProcessor::EstimateMemory(width, height, estimateStep, kernel, processor.assignMode, pixelFormat, true) + hierarchyBytes + bitmapBytes;
+							};
+
+							// The cached run may have been sized without the hierarchy that is on now.
+							// The kept bitmaps and buffers count as free memory; when the cached layout
+							// no longer fits, the source is loaded again and the layout picked anew.
+							if (cacheHit) {
+								size_t available = SLICAvailableMemory();
+								if (available > 0) {
+									TriglavPlugInInt writeWidth = writeRect.right - writeRect.left;
+									TriglavPlugInInt writeHeight = writeRect.bottom - writeRect.top;
+									available += processor.ReservedBytes() + (size_t)width * height * pixelBytes;
+									if (dstBitmap != NULL) available += (size_t)writeWidth * writeHeight * pixelBytes;
+									if (inCoreBytes(processor.kernel) > available / 4 * 3) {
+										Log("Cached Lab image does not fit the memory budget, loading again");
+										cacheHit = false;
+										processRect = neededRect;
+										width = processRect.right - processRect.left;
+										height = processRect.bottom - processRect.top;
+									}
+								}
 							}
-							
-							// Copy from Offscreen to Source Bitmap
-							TriglavPlugInPoint srcPos = {extent.left, extent.top};
+							Log("Bitmap Size: " + std::to_string(width) + "x" + std::to_string(height));
+
+							TriglavPlugInPoint srcPos = {processRect.left, processRect.top};
 							TriglavPlugInPoint zeroPos = {0, 0};
-							// Note: kTriglavPlugInOffscreenCopyModeImage is 0x02, Normal is 0x01
-							if((*pOffscreenService).getBitmapProc(srcBitmap, &zeroPos, sourceOffscreenObject, &srcPos, width, height, kTriglavPlugInOffscreenCopyModeNormal) != kTriglavPlugInAPIResultSuccess) {
-								Log("Failed to copy offscreen to src bitmap");
-								break;
-							}
+
+							// A hierarchy kept with the Lab image is only cut again; building one takes
+							// another clustering run
+							bool buildHierarchy = pFilterInfo->hierarchy && !(cacheHit && processor.HasHierarchy(kHierarchyBaseStep, pFilterInfo->compactness));
 
 							// Setup Progress
-							TriglavPlugInFilterRunSetProgressTotal(pRecordSuite, (*pluginServer).hostObject, 12);
+							TriglavPlugInFilterRunSetProgressTotal(pRecordSuite, (*pluginServer).hostObject, processor.ProgressTotal() + (buildHierarchy ? (pFilterInfo->maxIterations + 1) * kSLICProgressSteps : 0));
 							currentProgress = 0;
 
+							bool useStream = false;
+							if (!cacheHit) {
+								// Release previous if restart happened mid-way. The processor keeps its
+								// buffers: Initialize reuses them and only grows those that are too small.
+								sourceCache.valid = false;
+								srcBitmap.Release();
+								dstBitmap.Release();
+
+								// Pick the layout before allocating: the float planes when they fit in
+								// free memory, the 16 bit compact layout otherwise, and band streaming
+								// when not even that fits. The kept buffers count as free memory.
+								processor.kernel = kSLICKernelFloat;
+								size_t available = SLICAvailableMemory();
+								if (available > 0) {
+									available += processor.ReservedBytes();
+									size_t budget = available / 4 * 3; // leave room for the host
+									if (inCoreBytes(kSLICKernelFloat) > budget) {
+										processor.kernel = kSLICKernelCompact;
+										if (inCoreBytes(kSLICKernelCompact) > budget) {
+											size_t bandBytes = (size_t)width * SLICStreamProcessor::BandRows(pFilterInfo->cellSize) * pixelBytes * 2;
+											if (SLICStreamProcessor::EstimateMemory(width, height, pFilterInfo->cellSize, pixelFormat) + bandBytes > budget) {
+												Log("Not enough memory for " + std::to_string(width) + "x" + std::to_string(height) + ", breaking.");
+												break;
+											}
+											useStream = true;
+											processor.Release();
+											// SNIC needs random access to the whole image
+											Log(processor.engine == kSLICEngineSNIC ? "Streaming in bands (SLIC engine)" : "Streaming in bands");
+											if (pFilterInfo->hierarchy) Log("Streamed runs do not keep a hierarchy");
+										} else {
+											Log("Using compact memory layout");
+										}
+									}
+								}
+							}
+
+							if (useStream) {
+								// Nothing is cached: every pass reads the bands from the offscreen again,
+								// and each rendered band is written as soon as it is done
+								SLICStreamProcessor streamProcessor;
+								streamProcessor.threadPool = pFilterInfo->pThreadPool;
+								streamProcessor.maxIterations = pFilterInfo->maxIterations;
+								streamProcessor.convergenceThreshold = pFilterInfo->convergence;
+								streamProcessor.pixelFormat = pixelFormat;
+								SLICHostStreamIO hostStreamIO = { pRecordSuite, (*pluginServer).hostObject, pBitmapService, pOffscreenService, sourceOffscreenObject, destinationOffscreenObject,
+									processRect, writeRect, SLICStreamProcessor::BandRows(pFilterInfo->cellSize), pixelBytes, NULL, NULL };
+								SLICStreamIO streamIO = { &hostStreamIO, SLICHostReadRows, SLICHostBeginWriteRows, SLICHostEndWriteRows, NULL };
+								SLICResult streamResult = streamProcessor.Execute(width, height, pFilterInfo->cellSize, pFilterInfo->compactness, &streamIO, &callbacks, &currentProgress, kSLICProgressSteps);
+								if (streamResult == kSLICResultRestart) {
+									Log("Processor requested Restart");
+									restart = true;
+									continue;
+								}
+								if (streamResult != kSLICResultContinue) {
+									Log(streamResult == kSLICResultExit ? "Processor requested Exit" : "Band read or write failed");
+									break;
+								}
+								Log("Streaming Done. Iterations: " + std::to_string(streamProcessor.iterationsRun) + ", Residual: " + std::to_string(streamProcessor.lastResidual));
+
+								TriglavPlugInInt processResult2;
+								TriglavPlugInFilterRunProcess(pRecordSuite, &processResult2, (*pluginServer).hostObject, kTriglavPlugInFilterRunProcessStateEnd);
+								if (processResult2 == kTriglavPlugInFilterRunProcessResultRestart) {
+									restart = true;
+									continue;
+								}
+								break;
+							}
+
+							if (!cacheHit) {
+								// Create Source Bitmap (8bit per channel, 4 bytes for RGBA or 2 for gray + alpha)
+								if((*pBitmapService).createProc(&srcBitmap, width, height, pixelBytes, kTriglavPlugInBitmapScanlineHorizontalLeftTop) != kTriglavPlugInAPIResultSuccess) {
+									Log("Failed to create src bitmap");
+									break;
+								}
+
+								// Copy from Offscreen to Source Bitmap
+								// Note: kTriglavPlugInOffscreenCopyModeImage is 0x02, Normal is 0x01
+								SLICProfileScope profile("offscreen copy");
+								if((*pOffscreenService).getBitmapProc(srcBitmap, &zeroPos, sourceOffscreenObject, &srcPos, width, height, kTriglavPlugInOffscreenCopyModeNormal) != kTriglavPlugInAPIResultSuccess) {
+									Log("Failed to copy offscreen to src bitmap");
+									break;
+								}
+							}
+
 							// 3. Process
-							Log("Initializing Processor...");
-							
 							TriglavPlugInPtr srcRaw = NULL;
 							(*pBitmapService).getAddressProc(&srcRaw, srcBitmap, &zeroPos);
 							TriglavPlugInInt srcRowBytes = 0;
 							(*pBitmapService).getRowBytesProc(&srcRowBytes, srcBitmap);
-							TriglavPlugInInt srcPixelBytes = 0;
-							(*pBitmapService).getPixelBytesProc(&srcPixelBytes, srcBitmap); 
-							
-							processor.Initialize(width, height, (BYTE*)srcRaw, srcRowBytes, srcPixelBytes);
 
-							currentProgress = 1;
+							if (cacheHit) {
+								// Only the clustering parameters changed: keep the Lab image
+								Log("Reusing cached Lab image");
+							} else {
+								Log("Initializing Processor...");
+								processor.Initialize(width, height, (BYTE*)srcRaw, srcRowBytes, pixelFormat);
+								sourceCache.offscreen = sourceOffscreenObject;
+								sourceCache.rect = processRect;
+								sourceCache.valid = true;
+							}
+
+							currentProgress = kSLICProgressSteps;
 							TriglavPlugInFilterRunSetProgressDone(pRecordSuite, (*pluginServer).hostObject, currentProgress);
 
-							TriglavPlugInInt execResult = processor.Execute(pFilterInfo->cellSize, pFilterInfo->compactness, pRecordSuite, (*pluginServer).hostObject, &currentProgress, 1);
+							// 4. Result Bitmap -> Dest Offscreen, write rect only (dst is created once per source and reused)
+							TriglavPlugInInt writeWidth = writeRect.right - writeRect.left;
+							TriglavPlugInInt writeHeight = writeRect.bottom - writeRect.top;
+							TriglavPlugInInt writeOffsetX = writeRect.left - processRect.left;
+							TriglavPlugInInt writeOffsetY = writeRect.top - processRect.top;
+							TriglavPlugInPoint writePos = {writeRect.left, writeRect.top};
+							auto writeResult = [&]() -> bool {
+								if (dstBitmap == NULL && (*pBitmapService).createProc(&dstBitmap, writeWidth, writeHeight, pixelBytes, kTriglavPlugInBitmapScanlineHorizontalLeftTop) != kTriglavPlugInAPIResultSuccess) {
+									Log("Failed to create dst bitmap");
+									return false;
+								}
 
-							if (execResult == kTriglavPlugInFilterRunProcessResultRestart) {
+								TriglavPlugInPtr dstRaw = NULL;
+								(*pBitmapService).getAddressProc(&dstRaw, dstBitmap, &zeroPos);
+								TriglavPlugInInt dstRowBytes = 0;
+								(*pBitmapService).getRowBytesProc(&dstRowBytes, dstBitmap);
+
+								// Palette colors go straight into the bitmap rows
+								processor.Render((BYTE*)srcRaw, srcRowBytes, (BYTE*)dstRaw, dstRowBytes, writeOffsetX, writeOffsetY, writeWidth, writeHeight);
+
+								SLICProfileScope profile("write back");
+								if((*pOffscreenService).setBitmapProc(destinationOffscreenObject, &writePos, dstBitmap, &zeroPos, writeWidth, writeHeight, kTriglavPlugInOffscreenCopyModeNormal) != kTriglavPlugInAPIResultSuccess) {
+									Log("Failed to write to dest offscreen");
+								}
+
+								TriglavPlugInFilterRunUpdateDestinationOffscreenRect(pRecordSuite, (*pluginServer).hostObject, &writeRect);
+								return true;
+							};
+
+							// Slider changes first get a coarse pyramid result at full size. The full
+							// resolution refinement starts from its centers and is abandoned by the
+							// next restart while the user keeps changing parameters.
+							// A change that keeps the cell size (compactness, iterations) warm starts from the
+							// centers of the previous run instead. SNIC is a single pass and needs neither.
+							// With the hierarchy every cell size is a cut of it, refined by one iteration.
+							SLICResult execResult;
+							int previewLevel = (processor.engine == kSLICEngineSLIC) ? processor.PreviewLevel(pFilterInfo->cellSize) : 0;
+							if (pFilterInfo->hierarchy) {
+								execResult = kSLICResultContinue;
+								if (buildHierarchy) {
+									Log("Building superpixel hierarchy");
+									execResult = processor.BuildHierarchy(kHierarchyBaseStep, pFilterInfo->compactness, &callbacks, &currentProgress, kSLICProgressSteps);
+								}
+								if (execResult == kSLICResultContinue) execResult = processor.CutHierarchy(pFilterInfo->cellSize, true, &callbacks, &currentProgress, kSLICProgressSteps);
+							} else if (cacheHit && processor.seedStep == pFilterInfo->cellSize) {
+								Log("Warm start from previous centers");
+								execResult = processor.Refine(pFilterInfo->cellSize, pFilterInfo->compactness, &callbacks, &currentProgress, kSLICProgressSteps);
+							} else if (previewLevel > 0) {
+								execResult = processor.ExecutePreview(pFilterInfo->cellSize, pFilterInfo->compactness, previewLevel, &callbacks);
+								if (execResult == kSLICResultContinue) {
+									Log("Preview Done. Level: " + std::to_string(previewLevel));
+									if (!writeResult()) break;
+									execResult = processor.Refine(pFilterInfo->cellSize, pFilterInfo->compactness, &callbacks, &currentProgress, kSLICProgressSteps);
+								}
+							} else {
+								execResult = processor.Execute(pFilterInfo->cellSize, pFilterInfo->compactness, &callbacks, &currentProgress, kSLICProgressSteps);
+							}
+
+							if (execResult == kSLICResultRestart) {
 								Log("Processor requested Restart");
 								restart = true;
 								continue;
 							}
-							if (execResult == kTriglavPlugInFilterRunProcessResultExit) {
+							if (execResult == kSLICResultExit) {
 								Log("Processor requested Exit");
 								break;
 							}
-							Log("Processor Done.");
-							
-							// 4. Create Result Bitmap
-							if((*pBitmapService).createProc(&dstBitmap, width, height, 4, kTriglavPlugInBitmapScanlineHorizontalLeftTop) != kTriglavPlugInAPIResultSuccess) {
-								Log("Failed to create dst bitmap");
-								break;
-							}
-							
-							TriglavPlugInPtr dstRaw = NULL;
-							(*pBitmapService).getAddressProc(&dstRaw, dstBitmap, &zeroPos);
-							TriglavPlugInInt dstRowBytes = 0;
-							(*pBitmapService).getRowBytesProc(&dstRowBytes, dstBitmap);
-							
-							// Copy result to bitmap buffer (assuming RGBA structure match)
-							for (TriglavPlugInInt y = 0; y < height; y++) {
-								BYTE* dstRow = (BYTE*)dstRaw + (y * dstRowBytes);
-								for (TriglavPlugInInt x = 0; x < width; x++) {
-									size_t idx = (size_t)y * width + x;
-									dstRow[x*4 + 0] = processor.resultRGB[idx*4 + 0];
-									dstRow[x*4 + 1] = processor.resultRGB[idx*4 + 1];
-									dstRow[x*4 + 2] = processor.resultRGB[idx*4 + 2];
-									dstRow[x*4 + 3] = processor.resultRGB[idx*4 + 3];
-								}
-							}
-							
-							// 5. Write back to Dest Offscreen
-							if((*pOffscreenService).setBitmapProc(destinationOffscreenObject, &srcPos, dstBitmap, &zeroPos, width, height, kTriglavPlugInOffscreenCopyModeNormal) != kTriglavPlugInAPIResultSuccess) {
-								Log("Failed to write to dest offscreen");
-							}
+							Log("Processor Done. Iterations: " + std::to_string(processor.iterationsRun) + ", Residual: " + std::to_string(processor.lastResidual));
 
-							TriglavPlugInFilterRunUpdateDestinationOffscreenRect(pRecordSuite, (*pluginServer).hostObject, &extent);
+							if (!writeResult()) break;
 
-							// Cleanup
-							srcBitmap.Release();
-							dstBitmap.Release();
-							
+							// The bitmaps stay for a restart (ScopeBitmap releases them on exit)
 							Log("Loop Finished (one pass)");
 							
 							// End State
@@ -675,15 +868,21 @@ void TRIGLAV_PLUGIN_API TriglavPluginCall(TriglavPlugInInt* result, TriglavPlugI
 					}
 
 					Log("FilterRun Success");
+					SLICProfiler::Dump();
+					pFilterInfo->pIdleTimer->Arm(kBufferIdleReleaseMs, [pFilterInfo] { SLICReleaseBuffers(pFilterInfo); });
 					*result = kTriglavPlugInCallResultSuccess;
 				}
 			}
 			catch (const std::exception& e) {
 				Log("Exception caught: " + std::string(e.what()));
+				SLICProfiler::Dump();
+				SLICReleaseBuffers(static_cast<SLICFilterInfo*>(*data)); // may have run out of memory
 				*result = kTriglavPlugInCallResultFailed;
 			}
 			catch (...) {
 				Log("Unknown exception caught in FilterRun");
+				SLICProfiler::Dump();
+				SLICReleaseBuffers(static_cast<SLICFilterInfo*>(*data)); // may have run out of memory
 				*result = kTriglavPlugInCallResultFailed;
 			}
 		}
@@ -0,0 +1,46 @@
+//! Aligned storage for SIMD planes
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#pragma once
+
+#include <vector>
+#include <new>
+#include <cstddef>
+
+// 64 byte alignment covers one AVX-512 register / one cache line
+template <class T, size_t Alignment = 64>
+struct SLICAlignedAllocator
+{
+	typedef T value_type;
+
+	template <class U> struct rebind { typedef SLICAlignedAllocator<U, Alignment> other; };
+
+	SLICAlignedAllocator() {}
+	template <class U> SLICAlignedAllocator(const SLICAlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t n)
+	{
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+	}
+	void deallocate(T* p, size_t)
+	{
+		::operator delete(p, std::align_val_t(Alignment));
+	}
+
+	template <class U> bool operator==(const SLICAlignedAllocator<U, Alignment>&) const { return true; }
+	template <class U> bool operator!=(const SLICAlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+typedef std::vector<float, SLICAlignedAllocator<float> > SLICFloatPlane;
+typedef std::vector<int, SLICAlignedAllocator<int> > SLICIntPlane;
+typedef std::vector<unsigned short, SLICAlignedAllocator<unsigned short> > SLICShortPlane;
+typedef std::vector<short, SLICAlignedAllocator<short> > SLICInt16Plane;
+
+// Sets the size of a buffer whose old contents are not needed. Growing drops the old buffer
+// first, so the two never coexist and nothing is copied; shrinking keeps the capacity, so a
+// buffer kept across images is only reallocated when an image needs more than it had.
+template <class Vector>
+inline void SLICResizeBuffer(Vector& v, size_t n)
+{
+	if (v.capacity() < n) Vector().swap(v);
+	v.resize(n);
+}
@@ -0,0 +1,394 @@
+//! SLIC assignment kernels
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICAssign.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SLIC_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define SLIC_X86 0
+#endif
+
+// MSVC accepts every intrinsic without flags; GCC/Clang need the target per function
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SLIC_TARGET(isa)
+#else
+#define SLIC_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// --- Scalar ---
+
+// Luma variants read L only: with a and b at 0 the color term is dl * dl in every variant,
+// so they agree with the full kernel run on zero A and B planes.
+template <bool Luma>
+static inline void AssignPixel(const float* L, const float* A, const float* B, float* dist, int* labels, int i, float x, float rowTerm, const SLICAssignCluster& c)
+{
+	float dl = L[i] - c.l;
+	float dlab = dl * dl;
+	if constexpr (!Luma) {
+		float da = A[i] - c.a;
+		float db = B[i] - c.b;
+		dlab = (dlab + da * da) + db * db;
+	}
+	float dx = x - c.x;
+	float D = dlab + (c.spatialWeight * dx) * dx + rowTerm;
+	if (D < dist[i] || (D == dist[i] && c.label < labels[i])) {
+		dist[i] = D;
+		labels[i] = c.label;
+	}
+}
+
+template <bool Luma>
+static void AssignRowScalar(const float* L, const float* A, const float* B, float* dist, int* labels, int x0, int count, float rowTerm, const SLICAssignCluster& c)
+{
+	for (int i = 0; i < count; i++) {
+		AssignPixel<Luma>(L, A, B, dist, labels, i, (float)(x0 + i), rowTerm, c);
+	}
+}
+
+template <bool Luma>
+static inline void AssignPixelInt(const short* L, const short* A, const short* B, int* dist, int* labels, int i, int colTerm, int rowTerm, const SLICAssignClusterInt& c)
+{
+	if (L[i] == kSLICLabIntTransparent) return;
+	int dl = L[i] - c.l;
+	int D = dl * dl;
+	if constexpr (!Luma) {
+		int da = A[i] - c.a;
+		int db = B[i] - c.b;
+		D += da * da + db * db;
+	}
+	D += colTerm + rowTerm;
+	if (D < dist[i] || (D == dist[i] && c.label < labels[i])) {
+		dist[i] = D;
+		labels[i] = c.label;
+	}
+}
+
+template <bool Luma>
+static void AssignRowIntScalar(const short* L, const short* A, const short* B, int* dist, int* labels, const int* colTerm, int count, int rowTerm, const SLICAssignClusterInt& c)
+{
+	for (int i = 0; i < count; i++) {
+		AssignPixelInt<Luma>(L, A, B, dist, labels, i, colTerm[i], rowTerm, c);
+	}
+}
+
+#if SLIC_X86
+
+// --- SSE2 (4 lanes) ---
+
+template <bool Luma>
+SLIC_TARGET("sse2")
+static void AssignRowSSE2(const float* L, const float* A, const float* B, float* dist, int* labels, int x0, int count, float rowTerm, const SLICAssignCluster& c)
+{
+	const __m128 cl = _mm_set1_ps(c.l);
+	const __m128 ca = _mm_set1_ps(c.a);
+	const __m128 cb = _mm_set1_ps(c.b);
+	const __m128 cx = _mm_set1_ps(c.x);
+	const __m128 w = _mm_set1_ps(c.spatialWeight);
+	const __m128 row = _mm_set1_ps(rowTerm);
+	const __m128 step = _mm_set1_ps(4.0f);
+	const __m128i label = _mm_set1_epi32(c.label);
+	__m128 xs = _mm_add_ps(_mm_set1_ps((float)x0), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 dl = _mm_sub_ps(_mm_loadu_ps(L + i), cl);
+		__m128 dlab = _mm_mul_ps(dl, dl);
+		if constexpr (!Luma) {
+			__m128 da = _mm_sub_ps(_mm_loadu_ps(A + i), ca);
+			__m128 db = _mm_sub_ps(_mm_loadu_ps(B + i), cb);
+			dlab = _mm_add_ps(_mm_add_ps(dlab, _mm_mul_ps(da, da)), _mm_mul_ps(db, db));
+		}
+		__m128 dx = _mm_sub_ps(xs, cx);
+		__m128 D = _mm_add_ps(_mm_add_ps(dlab, _mm_mul_ps(_mm_mul_ps(w, dx), dx)), row);
+
+		__m128 old = _mm_loadu_ps(dist + i);
+		__m128i oldLabel = _mm_loadu_si128((const __m128i*)(labels + i));
+		__m128 tie = _mm_and_ps(_mm_cmpeq_ps(D, old), _mm_castsi128_ps(_mm_cmpgt_epi32(oldLabel, label)));
+		__m128 mask = _mm_or_ps(_mm_cmplt_ps(D, old), tie);
+		_mm_storeu_ps(dist + i, _mm_or_ps(_mm_and_ps(mask, D), _mm_andnot_ps(mask, old)));
+		__m128i m = _mm_castps_si128(mask);
+		_mm_storeu_si128((__m128i*)(labels + i), _mm_or_si128(_mm_and_si128(m, label), _mm_andnot_si128(m, oldLabel)));
+		xs = _mm_add_ps(xs, step);
+	}
+	for (; i < count; i++) {
+		AssignPixel<Luma>(L, A, B, dist, labels, i, (float)(x0 + i), rowTerm, c);
+	}
+}
+
+// Integer: 8 pixels per step. The differences are taken in 16 bit lanes; interleaving dl with
+// da (and db with 0) lets pmaddwd square and add them into 32 bit lanes in pixel order.
+template <bool Luma>
+SLIC_TARGET("sse2")
+static void AssignRowIntSSE2(const short* L, const short* A, const short* B, int* dist, int* labels, const int* colTerm, int count, int rowTerm, const SLICAssignClusterInt& c)
+{
+	const __m128i cl = _mm_set1_epi16(c.l);
+	const __m128i ca = _mm_set1_epi16(c.a);
+	const __m128i cb = _mm_set1_epi16(c.b);
+	const __m128i transparent = _mm_set1_epi16(kSLICLabIntTransparent);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i row = _mm_set1_epi32(rowTerm);
+	const __m128i label = _mm_set1_epi32(c.label);
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i l = _mm_loadu_si128((const __m128i*)(L + i));
+		__m128i skip = _mm_cmpeq_epi16(l, transparent);
+		__m128i dl = _mm_sub_epi16(l, cl);
+		__m128i da = zero, db = zero;
+		if constexpr (!Luma) {
+			da = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(A + i)), ca);
+			db = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(B + i)), cb);
+		}
+		for (int half = 0; half < 2; half++) {
+			__m128i la = half ? _mm_unpackhi_epi16(dl, da) : _mm_unpacklo_epi16(dl, da);
+			__m128i skip32 = half ? _mm_unpackhi_epi16(skip, skip) : _mm_unpacklo_epi16(skip, skip);
+			int j = i + half * 4;
+			__m128i D = _mm_madd_epi16(la, la);
+			if constexpr (!Luma) {
+				__m128i bz = half ? _mm_unpackhi_epi16(db, zero) : _mm_unpacklo_epi16(db, zero);
+				D = _mm_add_epi32(D, _mm_madd_epi16(bz, bz));
+			}
+			D = _mm_add_epi32(D, _mm_add_epi32(_mm_loadu_si128((const __m128i*)(colTerm + j)), row));
+
+			__m128i old = _mm_loadu_si128((const __m128i*)(dist + j));
+			__m128i oldLabel = _mm_loadu_si128((const __m128i*)(labels + j));
+			__m128i tie = _mm_and_si128(_mm_cmpeq_epi32(D, old), _mm_cmpgt_epi32(oldLabel, label));
+			__m128i mask = _mm_andnot_si128(skip32, _mm_or_si128(_mm_cmplt_epi32(D, old), tie));
+			_mm_storeu_si128((__m128i*)(dist + j), _mm_or_si128(_mm_and_si128(mask, D), _mm_andnot_si128(mask, old)));
+			_mm_storeu_si128((__m128i*)(labels + j), _mm_or_si128(_mm_and_si128(mask, label), _mm_andnot_si128(mask, oldLabel)));
+		}
+	}
+	for (; i < count; i++) {
+		AssignPixelInt<Luma>(L, A, B, dist, labels, i, colTerm[i], rowTerm, c);
+	}
+}
+
+// --- AVX2 (8 lanes) ---
+
+template <bool Luma>
+SLIC_TARGET("avx2")
+static void AssignRowAVX2(const float* L, const float* A, const float* B, float* dist, int* labels, int x0, int count, float rowTerm, const SLICAssignCluster& c)
+{
+	const __m256 cl = _mm256_set1_ps(c.l);
+	const __m256 ca = _mm256_set1_ps(c.a);
+	const __m256 cb = _mm256_set1_ps(c.b);
+	const __m256 cx = _mm256_set1_ps(c.x);
+	const __m256 w = _mm256_set1_ps(c.spatialWeight);
+	const __m256 row = _mm256_set1_ps(rowTerm);
+	const __m256 step = _mm256_set1_ps(8.0f);
+	const __m256i label = _mm256_set1_epi32(c.label);
+	__m256 xs = _mm256_add_ps(_mm256_set1_ps((float)x0), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 dl = _mm256_sub_ps(_mm256_loadu_ps(L + i), cl);
+		__m256 dlab = _mm256_mul_ps(dl, dl);
+		if constexpr (!Luma) {
+			__m256 da = _mm256_sub_ps(_mm256_loadu_ps(A + i), ca);
+			__m256 db = _mm256_sub_ps(_mm256_loadu_ps(B + i), cb);
+			dlab = _mm256_add_ps(_mm256_add_ps(dlab, _mm256_mul_ps(da, da)), _mm256_mul_ps(db, db));
+		}
+		__m256 dx = _mm256_sub_ps(xs, cx);
+		__m256 D = _mm256_add_ps(_mm256_add_ps(dlab, _mm256_mul_ps(_mm256_mul_ps(w, dx), dx)), row);
+
+		__m256 old = _mm256_loadu_ps(dist + i);
+		__m256i oldLabel = _mm256_loadu_si256((const __m256i*)(labels + i));
+		__m256 tie = _mm256_and_ps(_mm256_cmp_ps(D, old, _CMP_EQ_OQ), _mm256_castsi256_ps(_mm256_cmpgt_epi32(oldLabel, label)));
+		__m256 mask = _mm256_or_ps(_mm256_cmp_ps(D, old, _CMP_LT_OQ), tie);
+		_mm256_storeu_ps(dist + i, _mm256_blendv_ps(old, D, mask));
+		_mm256_storeu_ps((float*)(labels + i), _mm256_blendv_ps(_mm256_castsi256_ps(oldLabel), _mm256_castsi256_ps(label), mask));
+		xs = _mm256_add_ps(xs, step);
+	}
+	for (; i < count; i++) {
+		AssignPixel<Luma>(L, A, B, dist, labels, i, (float)(x0 + i), rowTerm, c);
+	}
+}
+
+// Integer: 16 pixels per step. unpack works inside 128 bit halves, so the 64 bit quarters are
+// reordered first to get the 32 bit results in pixel order.
+template <bool Luma>
+SLIC_TARGET("avx2")
+static void AssignRowIntAVX2(const short* L, const short* A, const short* B, int* dist, int* labels, const int* colTerm, int count, int rowTerm, const SLICAssignClusterInt& c)
+{
+	const __m256i cl = _mm256_set1_epi16(c.l);
+	const __m256i ca = _mm256_set1_epi16(c.a);
+	const __m256i cb = _mm256_set1_epi16(c.b);
+	const __m256i transparent = _mm256_set1_epi16(kSLICLabIntTransparent);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i row = _mm256_set1_epi32(rowTerm);
+	const __m256i label = _mm256_set1_epi32(c.label);
+
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i l = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*)(L + i)), 0xD8);
+		__m256i skip = _mm256_cmpeq_epi16(l, transparent);
+		__m256i dl = _mm256_sub_epi16(l, cl);
+		__m256i da = zero, db = zero;
+		if constexpr (!Luma) {
+			da = _mm256_sub_epi16(_mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*)(A + i)), 0xD8), ca);
+			db = _mm256_sub_epi16(_mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*)(B + i)), 0xD8), cb);
+		}
+		for (int half = 0; half < 2; half++) {
+			__m256i la = half ? _mm256_unpackhi_epi16(dl, da) : _mm256_unpacklo_epi16(dl, da);
+			__m256i skip32 = half ? _mm256_unpackhi_epi16(skip, skip) : _mm256_unpacklo_epi16(skip, skip);
+			int j = i + half * 8;
+			__m256i D = _mm256_madd_epi16(la, la);
+			if constexpr (!Luma) {
+				__m256i bz = half ? _mm256_unpackhi_epi16(db, zero) : _mm256_unpacklo_epi16(db, zero);
+				D = _mm256_add_epi32(D, _mm256_madd_epi16(bz, bz));
+			}
+			D = _mm256_add_epi32(D, _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(colTerm + j)), row));
+
+			__m256i old = _mm256_loadu_si256((const __m256i*)(dist + j));
+			__m256i oldLabel = _mm256_loadu_si256((const __m256i*)(labels + j));
+			__m256i tie = _mm256_and_si256(_mm256_cmpeq_epi32(D, old), _mm256_cmpgt_epi32(oldLabel, label));
+			__m256i mask = _mm256_andnot_si256(skip32, _mm256_or_si256(_mm256_cmpgt_epi32(old, D), tie));
+			_mm256_storeu_si256((__m256i*)(dist + j), _mm256_blendv_epi8(old, D, mask));
+			_mm256_storeu_si256((__m256i*)(labels + j), _mm256_blendv_epi8(oldLabel, label, mask));
+		}
+	}
+	for (; i < count; i++) {
+		AssignPixelInt<Luma>(L, A, B, dist, labels, i, colTerm[i], rowTerm, c);
+	}
+}
+
+// --- AVX-512 (16 lanes, masked tail) ---
+
+template <bool Luma>
+SLIC_TARGET("avx512f")
+static void AssignRowAVX512(const float* L, const float* A, const float* B, float* dist, int* labels, int x0, int count, float rowTerm, const SLICAssignCluster& c)
+{
+	const __m512 cl = _mm512_set1_ps(c.l);
+	const __m512 ca = _mm512_set1_ps(c.a);
+	const __m512 cb = _mm512_set1_ps(c.b);
+	const __m512 cx = _mm512_set1_ps(c.x);
+	const __m512 w = _mm512_set1_ps(c.spatialWeight);
+	const __m512 row = _mm512_set1_ps(rowTerm);
+	const __m512 step = _mm512_set1_ps(16.0f);
+	const __m512i label = _mm512_set1_epi32(c.label);
+	__m512 xs = _mm512_add_ps(_mm512_set1_ps((float)x0), _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f));
+
+	for (int i = 0; i < count; i += 16) {
+		int remaining = count - i;
+		__mmask16 lanes = (remaining >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << remaining) - 1);
+		__m512 dl = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, L + i), cl);
+		__m512 dlab = _mm512_mul_ps(dl, dl);
+		if constexpr (!Luma) {
+			__m512 da = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, A + i), ca);
+			__m512 db = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, B + i), cb);
+			dlab = _mm512_add_ps(_mm512_add_ps(dlab, _mm512_mul_ps(da, da)), _mm512_mul_ps(db, db));
+		}
+		__m512 dx = _mm512_sub_ps(xs, cx);
+		__m512 D = _mm512_add_ps(_mm512_add_ps(dlab, _mm512_mul_ps(_mm512_mul_ps(w, dx), dx)), row);
+
+		__m512 old = _mm512_maskz_loadu_ps(lanes, dist + i);
+		__m512i oldLabel = _mm512_maskz_loadu_epi32(lanes, labels + i);
+		__mmask16 tie = _mm512_mask_cmp_ps_mask(lanes, D, old, _CMP_EQ_OQ) & _mm512_mask_cmpgt_epi32_mask(lanes, oldLabel, label);
+		__mmask16 mask = _mm512_mask_cmp_ps_mask(lanes, D, old, _CMP_LT_OQ) | tie;
+		_mm512_mask_storeu_ps(dist + i, mask, D);
+		_mm512_mask_storeu_epi32(labels + i, mask, label);
+		xs = _mm512_add_ps(xs, step);
+	}
+}
+
+// --- CPU detection ---
+
+#if defined(_MSC_VER) && !defined(__clang__)
+static bool OsSupportsYmm(unsigned long long mask)
+{
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	return osxsave && ((_xgetbv(0) & mask) == mask);
+}
+#endif
+
+SLICIsa SLICDetectIsa()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	SLICIsa best = kSLICIsaSSE2;
+	if (maxLeaf >= 7 && OsSupportsYmm(0x6)) {
+		int ext[4];
+		__cpuidex(ext, 7, 0);
+		if (ext[1] & (1 << 5)) best = kSLICIsaAVX2;
+		if ((ext[1] & (1 << 16)) && OsSupportsYmm(0xE6)) best = kSLICIsaAVX512;
+	}
+	return best;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return kSLICIsaAVX512;
+	if (__builtin_cpu_supports("avx2")) return kSLICIsaAVX2;
+	if (__builtin_cpu_supports("sse2")) return kSLICIsaSSE2;
+	return kSLICIsaScalar;
+#endif
+}
+
+#else // !SLIC_X86
+
+SLICIsa SLICDetectIsa()
+{
+	return kSLICIsaScalar;
+}
+
+#endif
+
+SLICIsa SLICResolveIsa(SLICIsa requested)
+{
+	static const SLICIsa detected = SLICDetectIsa();
+	if (requested == kSLICIsaAuto || requested > detected) return detected;
+	return requested;
+}
+
+const char* SLICIsaName(SLICIsa isa)
+{
+	switch (isa) {
+	case kSLICIsaScalar: return "scalar";
+	case kSLICIsaSSE2: return "sse2";
+	case kSLICIsaAVX2: return "avx2";
+	case kSLICIsaAVX512: return "avx512";
+	default: return "auto";
+	}
+}
+
+template <bool Luma>
+static SLICAssignRowProc GetAssignRowProc(SLICIsa isa)
+{
+	switch (SLICResolveIsa(isa)) {
+#if SLIC_X86
+	case kSLICIsaSSE2: return AssignRowSSE2<Luma>;
+	case kSLICIsaAVX2: return AssignRowAVX2<Luma>;
+	case kSLICIsaAVX512: return AssignRowAVX512<Luma>;
+#endif
+	default: return AssignRowScalar<Luma>;
+	}
+}
+
+template <bool Luma>
+static SLICAssignRowIntProc GetAssignRowIntProc(SLICIsa isa)
+{
+	switch (SLICResolveIsa(isa)) {
+#if SLIC_X86
+	case kSLICIsaSSE2: return AssignRowIntSSE2<Luma>;
+	case kSLICIsaAVX2:
+	case kSLICIsaAVX512: return AssignRowIntAVX2<Luma>;
+#endif
+	default: return AssignRowIntScalar<Luma>;
+	}
+}
+
+SLICAssignRowProc SLICGetAssignRowProc(SLICIsa isa, bool luma)
+{
+	return luma ? GetAssignRowProc<true>(isa) : GetAssignRowProc<false>(isa);
+}
+
+SLICAssignRowIntProc SLICGetAssignRowIntProc(SLICIsa isa, bool luma)
+{
+	return luma ? GetAssignRowIntProc<true>(isa) : GetAssignRowIntProc<false>(isa);
+}
@@ -0,0 +1,63 @@
+//! SLIC assignment kernels
+//! Vectorized inner loop of the assignment step over structure-of-arrays float Lab planes, and
+//! an integer variant over 16 bit fixed point planes. The instruction set is picked at runtime;
+//! every variant produces the same results as its scalar fallback (no FMA, same operation order;
+//! integer sums are exact).
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#pragma once
+
+enum SLICIsa
+{
+	kSLICIsaAuto = 0,   // best available at runtime
+	kSLICIsaScalar,
+	kSLICIsaSSE2,
+	kSLICIsaAVX2,
+	kSLICIsaAVX512
+};
+
+// Cluster center as seen by the row kernel
+struct SLICAssignCluster
+{
+	float l, a, b;
+	float x, y;
+	float spatialWeight; // m^2 / S^2
+	int label;
+};
+
+// Evaluates count pixels of one window row starting at image column x0:
+//   D = (L-l)^2 + (A-a)^2 + (B-b)^2 + spatialWeight * (x-cx)^2 + rowTerm
+// rowTerm is spatialWeight * (y-cy)^2. Lanes with D < dist take the cluster label; equal
+// distances go to the lower label so the outcome does not depend on cluster order.
+// Transparent pixels carry L = NaN, so they never compare less and need no branch.
+typedef void (*SLICAssignRowProc)(const float* L, const float* A, const float* B, float* dist, int* labels, int x0, int count, float rowTerm, const SLICAssignCluster& cluster);
+
+// Highest instruction set supported by CPU and OS
+SLICIsa SLICDetectIsa();
+// Resolves kSLICIsaAuto and clamps requests the CPU cannot run
+SLICIsa SLICResolveIsa(SLICIsa requested);
+const char* SLICIsaName(SLICIsa isa);
+
+// luma selects the variant for images without color (a = b = 0): only L is read, A and B
+// may be NULL, and the results equal the full kernel's on zero A and B planes
+SLICAssignRowProc SLICGetAssignRowProc(SLICIsa isa, bool luma);
+
+// Fixed point Lab of the integer kernel: value * kSLICLabIntScale, rounded. Differences of two
+// colors fit in 16 bits and a squared Lab distance plus the spatial terms fits in int32.
+const int kSLICLabIntScale = 64;
+const short kSLICLabIntTransparent = -32768; // L of transparent pixels
+
+// Cluster center as seen by the integer row kernel
+struct SLICAssignClusterInt
+{
+	short l, a, b;
+	int label;
+};
+
+// Integer counterpart of SLICAssignRowProc:
+//   D = (L-l)^2 + (A-a)^2 + (B-b)^2 + colTerm[i] + rowTerm
+// in units of 1/kSLICLabIntScale^2 Lab^2. colTerm and rowTerm are the spatial terms of the
+// column and the row, precomputed per cluster. Pixels with L = kSLICLabIntTransparent are skipped.
+typedef void (*SLICAssignRowIntProc)(const short* L, const short* A, const short* B, int* dist, int* labels, const int* colTerm, int count, int rowTerm, const SLICAssignClusterInt& cluster);
+
+// AVX-512 runs the AVX2 variant (16 bit lanes at 512 bits need AVX512BW)
+SLICAssignRowIntProc SLICGetAssignRowIntProc(SLICIsa isa, bool luma);
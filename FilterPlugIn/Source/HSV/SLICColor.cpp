@@ -0,0 +1,263 @@
+//! SLIC color conversion
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICColor.h"
+#include <cmath>
+#include <algorithm>
+
+// RGB to LAB conversion
+void RGB2LAB(BYTE r, BYTE g, BYTE b, double& lVal, double& aVal, double& bVal)
+{
+	double var_R = (r / 255.0);
+	double var_G = (g / 255.0);
+	double var_B = (b / 255.0);
+
+	if (var_R > 0.04045) var_R = pow((var_R + 0.055) / 1.055, 2.4);
+	else                 var_R = var_R / 12.92;
+	if (var_G > 0.04045) var_G = pow((var_G + 0.055) / 1.055, 2.4);
+	else                 var_G = var_G / 12.92;
+	if (var_B > 0.04045) var_B = pow((var_B + 0.055) / 1.055, 2.4);
+	else                 var_B = var_B / 12.92;
+
+	var_R = var_R * 100.0;
+	var_G = var_G * 100.0;
+	var_B = var_B * 100.0;
+
+	double X = var_R * 0.4124 + var_G * 0.3576 + var_B * 0.1805;
+	double Y = var_R * 0.2126 + var_G * 0.7152 + var_B * 0.0722;
+	double Z = var_R * 0.0193 + var_G * 0.1192 + var_B * 0.9505;
+
+	double var_X = X / 95.047;
+	double var_Y = Y / 100.000;
+	double var_Z = Z / 108.883;
+
+	if (var_X > 0.008856) var_X = pow(var_X, (1.0 / 3.0));
+	else                  var_X = (7.787 * var_X) + (16.0 / 116.0);
+	if (var_Y > 0.008856) var_Y = pow(var_Y, (1.0 / 3.0));
+	else                  var_Y = (7.787 * var_Y) + (16.0 / 116.0);
+	if (var_Z > 0.008856) var_Z = pow(var_Z, (1.0 / 3.0));
+	else                  var_Z = (7.787 * var_Z) + (16.0 / 116.0);
+
+	lVal = (116.0 * var_Y) - 16.0;
+	aVal = 500.0 * (var_X - var_Y);
+	bVal = 200.0 * (var_Y - var_Z);
+}
+
+// LAB to RGB conversion
+void LAB2RGB(double lVal, double aVal, double bVal, BYTE& r, BYTE& g, BYTE& b)
+{
+	double var_Y = (lVal + 16.0) / 116.0;
+	double var_X = aVal / 500.0 + var_Y;
+	double var_Z = var_Y - bVal / 200.0;
+
+	if (pow(var_Y, 3) > 0.008856) var_Y = pow(var_Y, 3);
+	else                          var_Y = (var_Y - 16.0 / 116.0) / 7.787;
+	if (pow(var_X, 3) > 0.008856) var_X = pow(var_X, 3);
+	else                          var_X = (var_X - 16.0 / 116.0) / 7.787;
+	if (pow(var_Z, 3) > 0.008856) var_Z = pow(var_Z, 3);
+	else                          var_Z = (var_Z - 16.0 / 116.0) / 7.787;
+
+	double X = var_X * 95.047;
+	double Y = var_Y * 100.000;
+	double Z = var_Z * 108.883;
+
+	double var_R = X * 3.2406 + Y * -1.5372 + Z * -0.4986;
+	double var_G = X * -0.9689 + Y * 1.8758 + Z * 0.0415;
+	double var_B = X * 0.0557 + Y * -0.2040 + Z * 1.0570;
+
+	var_R = var_R / 100.0;
+	var_G = var_G / 100.0;
+	var_B = var_B / 100.0;
+
+	if (var_R > 0.0031308) var_R = 1.055 * pow(var_R, (1.0 / 2.4)) - 0.055;
+	else                   var_R = 12.92 * var_R;
+	if (var_G > 0.0031308) var_G = 1.055 * pow(var_G, (1.0 / 2.4)) - 0.055;
+	else                   var_G = 12.92 * var_G;
+	if (var_B > 0.0031308) var_B = 1.055 * pow(var_B, (1.0 / 2.4)) - 0.055;
+	else                   var_B = 12.92 * var_B;
+
+	var_R = std::max(0.0, std::min(1.0, var_R));
+	var_G = std::max(0.0, std::min(1.0, var_G));
+	var_B = std::max(0.0, std::min(1.0, var_B));
+
+	r = (BYTE)(var_R * 255.0);
+	g = (BYTE)(var_G * 255.0);
+	b = (BYTE)(var_B * 255.0);
+}
+
+// --- Tables ---
+
+static const int kFTableSize = 4096;           // f(t) samples over [0, kFTableRange]
+static const double kFTableRange = 1.0625;     // X/Xn and Z/Zn of white slightly exceed 1.0
+static const int kGammaIndexSize = 4096;       // first guess for the gamma encode
+
+// Same expression as the reference gamma encode, used to build and check thresholds
+static BYTE EncodeGammaReference(double v)
+{
+	if (v > 0.0031308) v = 1.055 * pow(v, (1.0 / 2.4)) - 0.055;
+	else               v = 12.92 * v;
+	v = std::max(0.0, std::min(1.0, v));
+	return (BYTE)(v * 255.0);
+}
+
+static double LabFReference(double t)
+{
+	if (t > 0.008856) return pow(t, (1.0 / 3.0));
+	return (7.787 * t) + (16.0 / 116.0);
+}
+
+struct SLICColorTables
+{
+	double linear[256];                  // sRGB -> linear * 100 (identical to the reference)
+	double f[kFTableSize + 1];           // f(t) samples for the fast mode
+	double gammaThreshold[257];          // smallest linear value that encodes to byte k
+	BYTE gammaIndex[kGammaIndexSize + 1];
+
+	SLICColorTables()
+	{
+		for (int i = 0; i < 256; i++) {
+			double v = (i / 255.0);
+			if (v > 0.04045) v = pow((v + 0.055) / 1.055, 2.4);
+			else             v = v / 12.92;
+			linear[i] = v * 100.0;
+		}
+		for (int i = 0; i <= kFTableSize; i++) {
+			f[i] = LabFReference(kFTableRange * i / kFTableSize);
+		}
+
+		// Bisection on the reference encode gives exact byte boundaries
+		gammaThreshold[0] = -HUGE_VAL;
+		for (int k = 1; k <= 255; k++) {
+			double lo = 0.0, hi = 1.0;
+			for (int n = 0; n < 200; n++) {
+				double mid = 0.5 * (lo + hi);
+				if (mid <= lo || mid >= hi) break;
+				if (EncodeGammaReference(mid) >= k) hi = mid;
+				else                                lo = mid;
+			}
+			gammaThreshold[k] = hi;
+		}
+		gammaThreshold[256] = HUGE_VAL;
+		for (int i = 0; i <= kGammaIndexSize; i++) {
+			gammaIndex[i] = EncodeGammaReference((double)i / kGammaIndexSize);
+		}
+	}
+};
+
+static const SLICColorTables& ColorTables()
+{
+	static const SLICColorTables tables;
+	return tables;
+}
+
+static inline double LabFFast(const SLICColorTables& tables, double t)
+{
+	double pos = t * (kFTableSize / kFTableRange);
+	if (!(pos >= 0.0 && pos < kFTableSize)) return LabFReference(t);
+	int i = (int)pos;
+	double frac = pos - i;
+	return tables.f[i] + (tables.f[i + 1] - tables.f[i]) * frac;
+}
+
+static inline BYTE EncodeGamma(const SLICColorTables& tables, double v)
+{
+	if (!(v > 0.0)) return EncodeGammaReference(v);
+	if (v >= 1.0) return 255;
+	int k = tables.gammaIndex[(int)(v * kGammaIndexSize)];
+	while (v >= tables.gammaThreshold[k + 1]) k++;
+	while (v < tables.gammaThreshold[k]) k--;
+	return (BYTE)k;
+}
+
+// --- Converter ---
+
+static const int kCacheBits = 12;
+
+SLICColorConverter::SLICColorConverter(SLICColorMode mode)
+	: mode(mode)
+{
+	ColorTables();
+	CacheEntry empty = { 0, 0.0, 0.0, 0.0 };
+	cache.assign((size_t)1 << kCacheBits, empty);
+}
+
+void SLICColorConverter::RGBToLab(BYTE r, BYTE g, BYTE b, double& lVal, double& aVal, double& bVal)
+{
+	unsigned int key = (((unsigned int)r << 16) | ((unsigned int)g << 8) | b) + 1;
+	CacheEntry& entry = cache[(key * 2654435761u) >> (32 - kCacheBits)];
+	if (entry.key == key) {
+		lVal = entry.l;
+		aVal = entry.a;
+		bVal = entry.b;
+		return;
+	}
+
+	const SLICColorTables& tables = ColorTables();
+	double var_R = tables.linear[r];
+	double var_G = tables.linear[g];
+	double var_B = tables.linear[b];
+
+	double X = var_R * 0.4124 + var_G * 0.3576 + var_B * 0.1805;
+	double Y = var_R * 0.2126 + var_G * 0.7152 + var_B * 0.0722;
+	double Z = var_R * 0.0193 + var_G * 0.1192 + var_B * 0.9505;
+
+	double var_X = X / 95.047;
+	double var_Y = Y / 100.000;
+	double var_Z = Z / 108.883;
+
+	if (mode == kSLICColorFast) {
+		var_X = LabFFast(tables, var_X);
+		var_Y = LabFFast(tables, var_Y);
+		var_Z = LabFFast(tables, var_Z);
+	} else {
+		var_X = LabFReference(var_X);
+		var_Y = LabFReference(var_Y);
+		var_Z = LabFReference(var_Z);
+	}
+
+	lVal = (116.0 * var_Y) - 16.0;
+	aVal = 500.0 * (var_X - var_Y);
+	bVal = 200.0 * (var_Y - var_Z);
+
+	entry.key = key;
+	entry.l = lVal;
+	entry.a = aVal;
+	entry.b = bVal;
+}
+
+void SLICColorConverter::LabToRGB(double lVal, double aVal, double bVal, BYTE& r, BYTE& g, BYTE& b) const
+{
+	const SLICColorTables& tables = ColorTables();
+	double var_Y = (lVal + 16.0) / 116.0;
+	double var_X = aVal / 500.0 + var_Y;
+	double var_Z = var_Y - bVal / 200.0;
+
+	double cubeY, cubeX, cubeZ;
+	if (mode == kSLICColorFast) {
+		cubeY = var_Y * var_Y * var_Y;
+		cubeX = var_X * var_X * var_X;
+		cubeZ = var_Z * var_Z * var_Z;
+	} else {
+		cubeY = pow(var_Y, 3);
+		cubeX = pow(var_X, 3);
+		cubeZ = pow(var_Z, 3);
+	}
+
+	if (cubeY > 0.008856) var_Y = cubeY;
+	else                  var_Y = (var_Y - 16.0 / 116.0) / 7.787;
+	if (cubeX > 0.008856) var_X = cubeX;
+	else                  var_X = (var_X - 16.0 / 116.0) / 7.787;
+	if (cubeZ > 0.008856) var_Z = cubeZ;
+	else                  var_Z = (var_Z - 16.0 / 116.0) / 7.787;
+
+	double X = var_X * 95.047;
+	double Y = var_Y * 100.000;
+	double Z = var_Z * 108.883;
+
+	double var_R = X * 3.2406 + Y * -1.5372 + Z * -0.4986;
+	double var_G = X * -0.9689 + Y * 1.8758 + Z * 0.0415;
+	double var_B = X * 0.0557 + Y * -0.2040 + Z * 1.0570;
+
+	r = EncodeGamma(tables, var_R / 100.0);
+	g = EncodeGamma(tables, var_G / 100.0);
+	b = EncodeGamma(tables, var_B / 100.0);
+}
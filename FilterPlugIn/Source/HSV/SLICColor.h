@@ -0,0 +1,46 @@
+//! SLIC color conversion
+//! sRGB (D65) <-> CIE L*a*b*. RGB2LAB / LAB2RGB are the original reference formulas;
+//! SLICColorConverter is the table driven path used by the processor.
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#pragma once
+
+#include <vector>
+
+typedef unsigned char BYTE;
+
+// Reference conversions (6 pow calls each)
+void RGB2LAB(BYTE r, BYTE g, BYTE b, double& lVal, double& aVal, double& bVal);
+void LAB2RGB(double lVal, double aVal, double bVal, BYTE& r, BYTE& g, BYTE& b);
+
+// kSLICColorExact : bit identical to RGB2LAB / LAB2RGB. The sRGB linearization and the gamma
+//                   encode are table driven but produce the same values; f(t) uses pow.
+// kSLICColorFast  : f(t) = cbrt(t) comes from a linearly interpolated table and Lab->RGB cubes
+//                   by multiplication. Measured over all 2^24 RGB values: RGB->Lab max error
+//                   dE76 0.0027; Lab->RGB differs from the reference by at most 1 level per
+//                   channel on rounding boundaries (max dE76 1.75 between the two results).
+enum SLICColorMode
+{
+	kSLICColorExact = 0,
+	kSLICColorFast
+};
+
+// Converts with shared static tables plus a small direct mapped cache of recently seen RGB
+// values (flat color illustrations hit it for most pixels). Not thread safe: use one instance
+// per thread.
+class SLICColorConverter {
+public:
+	explicit SLICColorConverter(SLICColorMode mode = kSLICColorFast);
+
+	SLICColorMode Mode() const { return mode; }
+
+	void RGBToLab(BYTE r, BYTE g, BYTE b, double& lVal, double& aVal, double& bVal);
+	void LabToRGB(double lVal, double aVal, double bVal, BYTE& r, BYTE& g, BYTE& b) const;
+
+private:
+	struct CacheEntry {
+		unsigned int key; // rgb + 1, 0 = empty
+		double l, a, b;
+	};
+	SLICColorMode mode;
+	std::vector<CacheEntry> cache;
+};
@@ -0,0 +1,2083 @@
+//! SLIC superpixel core
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICCore.h"
+#include "SLICProfiler.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+// 16 bit Lab of the compact kernel: L in [0, 100] with 0xFFFF reserved for transparent pixels,
+// a/b offset by 128 in steps of 1/256. The quantization error stays below 0.004.
+static const unsigned short kLab16Transparent = 0xFFFF;
+static const unsigned short kNoLabel16 = 0xFFFF;
+
+static inline unsigned short QuantizeL(double l)
+{
+	return (unsigned short)std::min(65534.0, std::max(0.0, std::floor(l * (65534.0 / 100.0) + 0.5)));
+}
+
+static inline unsigned short QuantizeAB(double v)
+{
+	return (unsigned short)std::min(65535.0, std::max(0.0, std::floor((v + 128.0) * 256.0 + 0.5)));
+}
+
+static inline float DequantizeL(unsigned short q) { return (float)q * (100.0f / 65534.0f); }
+static inline float DequantizeAB(unsigned short q) { return (float)q * (1.0f / 256.0f) - 128.0f; }
+
+// Fixed point Lab of the integer kernel (kSLICLabIntScale steps, error below 0.008); also used
+// for the cluster centers, so a pixel and a center of the same color are at distance 0
+static inline short QuantizeInt(double v)
+{
+	return (short)std::min(32767.0, std::max(-32767.0, std::floor(v * kSLICLabIntScale + 0.5)));
+}
+
+static inline float DequantizeInt(short q) { return (float)q * (1.0f / kSLICLabIntScale); }
+
+// Spatial term of the integer kernel for an offset d from the center, in 1/kSLICLabIntScale^2
+// Lab^2 units. Capped so the distance sum stays inside int32.
+static inline int SpatialTermInt(double scaledWeight, double d)
+{
+	double term = scaledWeight * d * d + 0.5;
+	return (term < (double)(1 << 29)) ? (int)term : (1 << 29);
+}
+
+static inline int LabelValue(int label) { return label; }
+static inline int LabelValue(unsigned short label) { return (label == kNoLabel16) ? -1 : (int)label; }
+
+static size_t SystemAvailableMemory()
+{
+#if defined(_WIN32)
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if (GlobalMemoryStatusEx(&status)) return (size_t)status.ullAvailPhys;
+	return 0;
+#elif defined(__linux__)
+	long pages = sysconf(_SC_AVPHYS_PAGES);
+	long pageSize = sysconf(_SC_PAGESIZE);
+	return (pages > 0 && pageSize > 0) ? (size_t)pages * (size_t)pageSize : 0;
+#else
+	return 0;
+#endif
+}
+
+size_t SLICAvailableMemory()
+{
+	size_t available = SystemAvailableMemory();
+	// SLIC_MEMORY_LIMIT_MB caps the result, to exercise the compact and streaming paths
+	const char* limit = getenv("SLIC_MEMORY_LIMIT_MB");
+	if (limit != NULL && atoi(limit) > 0) {
+		size_t limitBytes = (size_t)atoi(limit) << 20;
+		if (available == 0 || limitBytes < available) available = limitBytes;
+	}
+	return available;
+}
+
+static inline int SlicCellCount(int size, int ns) { return (size + ns - 1) / ns; }
+
+// Side of the blocks the pixel order labels at once, in pixels. Small cells are grouped so the
+// kernels see rows of a useful length.
+static const int kSlicPixelBlock = 64;
+static inline int SlicBlockCells(int ns) { return std::max(1, kSlicPixelBlock / ns); }
+
+size_t SLICProcessor::EstimateMemory(int w, int h, int step, SLICKernel kernel, SLICAssignMode assignMode, SLICPixelFormat format, bool preview)
+{
+	if (step < 2) step = 2;
+	size_t pixels = (size_t)w * (size_t)h;
+	size_t clusterCount = (size_t)((w + step - 1) / step) * (size_t)((h + step - 1) / step);
+	// Gray sources keep the L plane only (the reference kernel keeps its AoS layout)
+	size_t planes = SLICPixelIsGray(format) ? 1 : 3;
+	size_t perPixel, distance;
+	switch (kernel) {
+	case kSLICKernelReference: perPixel = 3 * sizeof(double) + sizeof(int); distance = sizeof(double); break;
+	case kSLICKernelCompact:   perPixel = planes * sizeof(unsigned short) + ((clusterCount < kNoLabel16) ? sizeof(unsigned short) : sizeof(int)); distance = sizeof(float); break;
+	case kSLICKernelInteger:   perPixel = planes * sizeof(short) + sizeof(int); distance = sizeof(int); break;
+	default:                   perPixel = planes * sizeof(float) + sizeof(int); distance = sizeof(float); break;
+	}
+	// The pixel order keeps the distances of one block per thread only
+	if (assignMode == kSLICAssignClusters) perPixel += distance;
+	size_t bytes = pixels * perPixel + pixels / 8;
+	// Clusters, update sums, tile buckets and palette
+	bytes += clusterCount * (sizeof(SlicCluster) + 2 * sizeof(SlicAccumulator) + 4 * sizeof(int) + 4);
+	// Pyramid: the level 1 planes dominate (12 bytes per pixel at a quarter of the size), plus
+	// the coarse distances and labels
+	if (preview) bytes += pixels * 5;
+	return bytes;
+}
+
+void SLICProcessor::Initialize(int w, int h, const BYTE* srcBuffer, int rowBytes, SLICPixelFormat format)
+{
+	SLICProfileScope profile("lab conversion");
+	width = w;
+	height = h;
+	pixelFormat = format;
+	luma = SLICPixelIsGray(format) && kernel != kSLICKernelReference;
+	size_t totalPixels = (size_t)w * (size_t)h;
+
+	// Only the layout of the selected kernel is kept; labels and distances are (re)allocated by
+	// ResetAssignment below
+	bool useFloat = (kernel == kSLICKernelFloat);
+	bool useCompact = (kernel == kSLICKernelCompact);
+	bool useInteger = (kernel == kSLICKernelInteger);
+	if (!useFloat) planeL = SLICFloatPlane();
+	if (!useFloat || luma) {
+		planeA = SLICFloatPlane();
+		planeB = SLICFloatPlane();
+	}
+	if (!useCompact) planeL16 = SLICShortPlane();
+	if (!useCompact || luma) {
+		planeA16 = SLICShortPlane();
+		planeB16 = SLICShortPlane();
+	}
+	if (!useInteger) {
+		planeLi = SLICInt16Plane();
+		distancesI = SLICIntPlane();
+	}
+	if (!useInteger || luma) {
+		planeAi = SLICInt16Plane();
+		planeBi = SLICInt16Plane();
+	}
+	if (kernel != kSLICKernelReference) {
+		labData = std::vector<SlicColor>();
+		distances = std::vector<double>();
+	}
+	if (kernel == kSLICKernelReference || useInteger) {
+		distancesF = SLICFloatPlane();
+	}
+	if (useFloat) {
+		SLICResizeBuffer(planeL, totalPixels);
+		if (!luma) {
+			SLICResizeBuffer(planeA, totalPixels);
+			SLICResizeBuffer(planeB, totalPixels);
+		}
+	} else if (useCompact) {
+		SLICResizeBuffer(planeL16, totalPixels);
+		if (!luma) {
+			SLICResizeBuffer(planeA16, totalPixels);
+			SLICResizeBuffer(planeB16, totalPixels);
+		}
+	} else if (useInteger) {
+		SLICResizeBuffer(planeLi, totalPixels);
+		if (!luma) {
+			SLICResizeBuffer(planeAi, totalPixels);
+			SLICResizeBuffer(planeBi, totalPixels);
+		}
+	} else {
+		SLICResizeBuffer(labData, totalPixels);
+	}
+
+	SLICColorConverter converter(colorMode);
+	auto store = [&](size_t idx, double l, double a, double b_val, bool opaque) { // b_val to avoid conflict with 'b'
+		validPixels[idx] = opaque;
+		if (useFloat) {
+			// NaN keeps transparent pixels out of the branch free assignment
+			planeL[idx] = opaque ? (float)l : std::numeric_limits<float>::quiet_NaN();
+			if (luma) return;
+			planeA[idx] = (float)a;
+			planeB[idx] = (float)b_val;
+		} else if (useCompact) {
+			planeL16[idx] = opaque ? QuantizeL(l) : kLab16Transparent;
+			if (luma) return;
+			planeA16[idx] = QuantizeAB(a);
+			planeB16[idx] = QuantizeAB(b_val);
+		} else if (useInteger) {
+			planeLi[idx] = opaque ? QuantizeInt(l) : kSLICLabIntTransparent;
+			if (luma) return;
+			planeAi[idx] = QuantizeInt(a);
+			planeBi[idx] = QuantizeInt(b_val);
+		} else {
+			labData[idx] = { l, a, b_val };
+		}
+	};
+	// Transparent pixels only need the marker the kernels test for
+	SlicColor clear = { 0.0, 0.0, 0.0 };
+	auto markTransparent = [&](size_t start, size_t end) {
+		if (useFloat)        std::fill(planeL.begin() + start, planeL.begin() + end, std::numeric_limits<float>::quiet_NaN());
+		else if (useCompact) std::fill(planeL16.begin() + start, planeL16.begin() + end, kLab16Transparent);
+		else if (useInteger) std::fill(planeLi.begin() + start, planeLi.begin() + end, kSLICLabIntTransparent);
+		else                 std::fill(labData.begin() + start, labData.begin() + end, clear);
+	};
+	validPixels.assign(totalPixels, false);
+
+	// The channel offsets are constants of each instantiation. Gray pixels take L from a table
+	// of the 256 gray levels and a = b = 0.
+	SLICDispatchPixelFormat(format, [&](auto layout) {
+		typedef decltype(layout) Layout;
+		auto opaqueAt = [](const BYTE* px) {
+			if constexpr (Layout::alpha < 0) return true;
+			else return px[Layout::alpha] != 0;
+		};
+		double grayL[256];
+		if constexpr (Layout::gray) {
+			for (int v = 0; v < 256; v++) {
+				double a, b_val;
+				converter.RGBToLab((BYTE)v, (BYTE)v, (BYTE)v, grayL[v], a, b_val);
+			}
+		}
+
+		// One pass over the alpha builds the occupancy index; only the spans it finds opaque are
+		// converted, and full spans skip the alpha test
+		occupancy.Build(w, h, [&](int x, int y) { return opaqueAt(srcBuffer + (size_t)y * rowBytes + (size_t)x * Layout::bytes); });
+
+		for (int y = 0; y < h; y++) {
+			const BYTE* srcRow = srcBuffer + ((size_t)y * rowBytes);
+			size_t row = (size_t)y * w;
+			int next = 0;
+			occupancy.ForEachSpan(y, 0, w, [&](int x0, int x1, bool full) {
+				markTransparent(row + next, row + x0);
+				for (int x = x0; x < x1; x++) {
+					const BYTE* px = srcRow + (size_t)x * Layout::bytes;
+					if constexpr (Layout::gray) {
+						store(row + x, grayL[px[0]], 0.0, 0.0, full || opaqueAt(px));
+					} else {
+						double l, a, b_val;
+						converter.RGBToLab(px[Layout::r], px[Layout::g], px[Layout::b], l, a, b_val);
+						store(row + x, l, a, b_val, full || opaqueAt(px));
+					}
+				}
+				next = x1;
+			});
+			markTransparent(row + next, row + w);
+		}
+	});
+
+	clusters.clear();
+	palette.clear();
+	seedStep = 0;
+	DropHierarchy();
+	ResetAssignment();
+	// The pixel order's block distances, for every step up to kSlicPixelBlock (AssignPixels grows
+	// them for larger steps)
+	if (engine == kSLICEngineSLIC && assignMode == kSLICAssignPixels) ReserveCellScratch((size_t)kSlicPixelBlock * kSlicPixelBlock);
+}
+
+void SLICProcessor::Release()
+{
+	width = 0;
+	height = 0;
+	labData = std::vector<SlicColor>();
+	labels = SLICIntPlane();
+	labels16 = SLICShortPlane();
+	distances = std::vector<double>();
+	clusters = std::vector<SlicCluster>();
+	palette = std::vector<BYTE>();
+	validPixels = std::vector<bool>();
+	occupancy.Release();
+	planeL = SLICFloatPlane();
+	planeA = SLICFloatPlane();
+	planeB = SLICFloatPlane();
+	planeL16 = SLICShortPlane();
+	planeA16 = SLICShortPlane();
+	planeB16 = SLICShortPlane();
+	distancesF = SLICFloatPlane();
+	planeLi = SLICInt16Plane();
+	planeAi = SLICInt16Plane();
+	planeBi = SLICInt16Plane();
+	distancesI = SLICIntPlane();
+	tileOf = std::vector<int>();
+	cellScratch = std::vector<SlicCellScratch>();
+	tileStart = std::vector<int>();
+	tileFill = std::vector<int>();
+	tileClusters = std::vector<int>();
+	phaseTiles = std::vector<int>();
+	bands = std::vector<SlicBandAccumulator>();
+	sums = std::vector<SlicAccumulator>();
+	profileLabels = std::vector<int>();
+	preview.reset();
+	seedStep = 0;
+	hierarchyLabels = SLICIntPlane();
+	hierarchyRegions = std::vector<SlicAccumulator>();
+	hierarchyMerges = std::vector<SlicMerge>();
+	hierarchyStep = 0;
+}
+
+size_t SLICProcessor::ReservedBytes() const
+{
+	auto bytes = [](const auto& buffer) { return buffer.capacity() * sizeof(buffer[0]); };
+	size_t total = bytes(labData) + bytes(labels) + bytes(labels16) + bytes(distances) + validPixels.capacity() / 8;
+	total += bytes(planeL) + bytes(planeA) + bytes(planeB) + bytes(distancesF);
+	total += bytes(planeL16) + bytes(planeA16) + bytes(planeB16);
+	total += bytes(planeLi) + bytes(planeAi) + bytes(planeBi) + bytes(distancesI);
+	total += bytes(profileLabels);
+	for (const SlicCellScratch& scratch : cellScratch) total += bytes(scratch.distances) + bytes(scratch.distancesF) + bytes(scratch.distancesI);
+	total += bytes(hierarchyLabels) + bytes(hierarchyRegions) + bytes(hierarchyMerges);
+	return preview ? total + preview->ReservedBytes() : total;
+}
+
+SlicColor SLICProcessor::LabAt(size_t idx) const
+{
+	if (kernel == kSLICKernelFloat) {
+		SlicColor c = { planeL[idx], luma ? 0.0f : planeA[idx], luma ? 0.0f : planeB[idx] };
+		return c;
+	}
+	if (kernel == kSLICKernelCompact) {
+		SlicColor c = { DequantizeL(planeL16[idx]), luma ? 0.0f : DequantizeAB(planeA16[idx]), luma ? 0.0f : DequantizeAB(planeB16[idx]) };
+		return c;
+	}
+	if (kernel == kSLICKernelInteger) {
+		SlicColor c = { DequantizeInt(planeLi[idx]), luma ? 0.0f : DequantizeInt(planeAi[idx]), luma ? 0.0f : DequantizeInt(planeBi[idx]) };
+		return c;
+	}
+	return labData[idx];
+}
+
+// Pixels of k's 2S search window that lie inside the image, shrunk to the opaque tiles it
+// touches (only transparent pixels are cut off, so the labels do not change); empty when
+// there is nothing to assign
+SlicWindow SLICProcessor::ClusterWindow(int k, int ns) const
+{
+	int cx = (int)clusters[k].x;
+	int cy = (int)clusters[k].y;
+	SlicWindow w = { std::max<int>(0, cx - ns), std::min<int>(width, cx + ns), std::max<int>(0, cy - ns), std::min<int>(height, cy + ns) };
+	if (!occupancy.Clip(w)) w.x1 = w.x0;
+	return w;
+}
+
+// Original double precision assignment, kept as the reference for the fast kernels
+void SLICProcessor::AssignWindowReference(int k, const SlicWindow& w, double spatialWeight, double* dist, size_t distStride)
+{
+	for (int y = w.y0; y < w.y1; y++) {
+		double* distRow = dist + (size_t)(y - w.y0) * distStride - w.x0;
+		for (int x = w.x0; x < w.x1; x++) {
+			size_t idx = (size_t)y * width + x;
+			if (!validPixels[idx]) continue;
+
+			SlicColor pixel = labData[idx];
+			
+			double d_lab = std::pow(pixel.l - clusters[k].l, 2) + 
+						   std::pow(pixel.a - clusters[k].a, 2) + 
+						   std::pow(pixel.b - clusters[k].b, 2);
+			
+			double d_xy = std::pow(x - clusters[k].x, 2) + 
+						  std::pow(y - clusters[k].y, 2);
+			
+			double D = d_lab + spatialWeight * d_xy;
+
+			// Ties go to the lower cluster index, as in a serial k loop
+			if (D < distRow[x] || (D == distRow[x] && k < labels[idx])) {
+				distRow[x] = D;
+				labels[idx] = k;
+			}
+		}
+	}
+}
+
+// One SIMD row kernel call per window row; the luma row kernel does not read A and B
+void SLICProcessor::AssignWindowFloat(int k, const SlicWindow& w, float spatialWeight, SLICAssignRowProc assignRow, float* dist, size_t distStride)
+{
+	SLICAssignCluster c = { (float)clusters[k].l, (float)clusters[k].a, (float)clusters[k].b, (float)clusters[k].x, (float)clusters[k].y, spatialWeight, k };
+	for (int y = w.y0; y < w.y1; y++) {
+		size_t idx = (size_t)y * width + w.x0;
+		float dy = (float)y - c.y;
+		assignRow(&planeL[idx], luma ? NULL : &planeA[idx], luma ? NULL : &planeB[idx], dist + (size_t)(y - w.y0) * distStride, &labels[idx], w.x0, w.x1 - w.x0, (spatialWeight * dy) * dy, c);
+	}
+}
+
+// Float kernel arithmetic on 16 bit planes; labels are 16 or 32 bit. Luma reads L only.
+template <bool Luma, class Label>
+void SLICProcessor::AssignWindowCompact(int k, const SlicWindow& w, float spatialWeight, Label* labelPlane, float* dist, size_t distStride)
+{
+	float cl = (float)clusters[k].l;
+	float ca = (float)clusters[k].a;
+	float cb = (float)clusters[k].b;
+	float fx = (float)clusters[k].x;
+	float fy = (float)clusters[k].y;
+
+	for (int y = w.y0; y < w.y1; y++) {
+		size_t row = (size_t)y * width;
+		float* distRow = dist + (size_t)(y - w.y0) * distStride - w.x0;
+		float dy = (float)y - fy;
+		float rowTerm = (spatialWeight * dy) * dy;
+		for (int x = w.x0; x < w.x1; x++) {
+			size_t idx = row + x;
+			if (planeL16[idx] == kLab16Transparent) continue;
+			float dl = DequantizeL(planeL16[idx]) - cl;
+			float dlab = dl * dl;
+			if constexpr (!Luma) {
+				float da = DequantizeAB(planeA16[idx]) - ca;
+				float db = DequantizeAB(planeB16[idx]) - cb;
+				dlab = (dlab + da * da) + db * db;
+			}
+			float dx = (float)x - fx;
+			float D = dlab + (spatialWeight * dx) * dx + rowTerm;
+			if (D < distRow[x] || (D == distRow[x] && k < LabelValue(labelPlane[idx]))) {
+				distRow[x] = D;
+				labelPlane[idx] = (Label)k;
+			}
+		}
+	}
+}
+
+// Integer row kernel over the fixed point planes. The spatial terms are rounded per column and
+// per row, so the distances are exact integers and every ISA agrees.
+void SLICProcessor::AssignWindowInteger(int k, const SlicWindow& w, double spatialWeight, SLICAssignRowIntProc assignRow, int* dist, size_t distStride)
+{
+	SLICAssignClusterInt c = { QuantizeInt(clusters[k].l), QuantizeInt(clusters[k].a), QuantizeInt(clusters[k].b), k };
+
+	double scaledWeight = spatialWeight * kSLICLabIntScale * kSLICLabIntScale;
+	int count = w.x1 - w.x0;
+	int stackTerms[512];
+	std::vector<int> heapTerms;
+	int* colTerms = stackTerms;
+	if (count > 512) {
+		heapTerms.resize(count);
+		colTerms = heapTerms.data();
+	}
+	for (int i = 0; i < count; i++) colTerms[i] = SpatialTermInt(scaledWeight, (double)(w.x0 + i) - clusters[k].x);
+
+	for (int y = w.y0; y < w.y1; y++) {
+		size_t idx = (size_t)y * width + w.x0;
+		assignRow(&planeLi[idx], luma ? NULL : &planeAi[idx], luma ? NULL : &planeBi[idx], dist + (size_t)(y - w.y0) * distStride, &labels[idx], colTerms, count, SpatialTermInt(scaledWeight, (double)y - clusters[k].y), c);
+	}
+}
+
+SLICCheckpoint::SLICCheckpoint(const SLICCallbacks* callbacks, int* pCurrentProgress)
+	: callbacks(callbacks), pCurrentProgress(pCurrentProgress), owner(std::this_thread::get_id()),
+	lastPoll(std::chrono::steady_clock::now()), base(0), span(0), items(0), done(0), result(kSLICResultContinue)
+{
+}
+
+void SLICCheckpoint::Begin(int progressUnits, long long itemCount)
+{
+	base = pCurrentProgress ? *pCurrentProgress : 0;
+	span = progressUnits;
+	items = itemCount;
+	done = 0;
+}
+
+void SLICCheckpoint::End()
+{
+	items = 0; // closed: polls until the next Begin leave the progress alone
+	if (pCurrentProgress == NULL) return;
+	*pCurrentProgress = base + span;
+	if (callbacks && callbacks->setProgressDone) callbacks->setProgressDone(callbacks->data, *pCurrentProgress);
+}
+
+void SLICCheckpoint::Report()
+{
+	if (pCurrentProgress == NULL || items <= 0) return;
+	long long finished = std::min(done.load(), items);
+	int progress = base + (int)(span * finished / items);
+	if (progress == *pCurrentProgress) return;
+	*pCurrentProgress = progress;
+	if (callbacks && callbacks->setProgressDone) callbacks->setProgressDone(callbacks->data, progress);
+}
+
+bool SLICCheckpoint::Step(long long count)
+{
+	done += count;
+	if (Stopped()) return false;
+	if (std::this_thread::get_id() != owner) return true;
+	if (std::chrono::steady_clock::now() - lastPoll < std::chrono::milliseconds(kSLICPollIntervalMs)) return true;
+	return Poll();
+}
+
+bool SLICCheckpoint::Poll()
+{
+	if (Stopped()) return false;
+	Report();
+	lastPoll = std::chrono::steady_clock::now();
+	if (callbacks && callbacks->process) {
+		int processResult = callbacks->process(callbacks->data);
+		if (processResult == kSLICResultExit || processResult == kSLICResultRestart) {
+			result = processResult;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Clusters are bucketed into 2S x 2S tiles by their center. Windows reach S around the
+// center, so tiles of the same checkerboard phase (equal x and y parity) never touch the same
+// pixel and can run concurrently; the 4 phases run one after another. With ties broken by
+// cluster index the result does not depend on the order, so it matches the serial loop.
+// active lists the clusters to assign in ascending order; NULL assigns all of them.
+bool SLICProcessor::Assign(int ns, double m, const int* active, int activeCount, SLICCheckpoint* pCheckpoint)
+{
+	int clusterCount = (active != NULL) ? activeCount : (int)clusters.size();
+	clusterAssignments += clusterCount;
+	// SelectActive() lists every cluster when it reset all distances
+	if (assignMode == kSLICAssignPixels) return AssignPixels(ns, m, clusterCount < (int)clusters.size(), pCheckpoint);
+
+	SLICAssignRowProc assignRow = SLICGetAssignRowProc(isa, luma);
+	SLICAssignRowIntProc assignRowInt = SLICGetAssignRowIntProc(isa, luma);
+	double weight = m * m / (ns * ns);
+	float spatialWeight = (float)weight;
+
+	auto assignCluster = [&](int k) {
+		SlicWindow w = ClusterWindow(k, ns);
+		if (w.x0 >= w.x1 || w.y0 >= w.y1) return;
+		size_t idx = (size_t)w.y0 * width + w.x0;
+		if (kernel == kSLICKernelFloat)          AssignWindowFloat(k, w, spatialWeight, assignRow, &distancesF[idx], width);
+		else if (kernel == kSLICKernelReference) AssignWindowReference(k, w, weight, &distances[idx], width);
+		else if (kernel == kSLICKernelInteger)   AssignWindowInteger(k, w, weight, assignRowInt, &distancesI[idx], width);
+		else if (luma && narrowLabels)           AssignWindowCompact<true>(k, w, spatialWeight, labels16.data(), &distancesF[idx], width);
+		else if (luma)                           AssignWindowCompact<true>(k, w, spatialWeight, labels.data(), &distancesF[idx], width);
+		else if (narrowLabels)                   AssignWindowCompact<false>(k, w, spatialWeight, labels16.data(), &distancesF[idx], width);
+		else                                     AssignWindowCompact<false>(k, w, spatialWeight, labels.data(), &distancesF[idx], width);
+	};
+
+	if (threadPool == NULL || threadPool->ThreadCount() <= 1) {
+		for (int i = 0; i < clusterCount; i++) {
+			assignCluster(active ? active[i] : i);
+			if (pCheckpoint && !pCheckpoint->Step()) return false;
+		}
+		return true;
+	}
+
+	int tileSize = 2 * ns;
+	int tilesX = (width + tileSize - 1) / tileSize;
+	int tilesY = (height + tileSize - 1) / tileSize;
+	int tileCount = tilesX * tilesY;
+
+	// Counting sort of clusters by tile, k stays ascending inside a tile
+	tileOf.resize(clusterCount);
+	tileStart.assign(tileCount + 1, 0);
+	for (int i = 0; i < clusterCount; i++) {
+		int k = active ? active[i] : i;
+		int tx = std::min(tilesX - 1, std::max(0, (int)clusters[k].x / tileSize));
+		int ty = std::min(tilesY - 1, std::max(0, (int)clusters[k].y / tileSize));
+		tileOf[i] = ty * tilesX + tx;
+		tileStart[tileOf[i] + 1]++;
+	}
+	for (int t = 0; t < tileCount; t++) tileStart[t + 1] += tileStart[t];
+	tileClusters.resize(clusterCount);
+	tileFill.assign(tileStart.begin(), tileStart.end() - 1);
+	for (int i = 0; i < clusterCount; i++) tileClusters[tileFill[tileOf[i]]++] = active ? active[i] : i;
+
+	for (int phase = 0; phase < 4; phase++) {
+		phaseTiles.clear();
+		for (int ty = (phase >> 1); ty < tilesY; ty += 2) {
+			for (int tx = (phase & 1); tx < tilesX; tx += 2) {
+				int t = ty * tilesX + tx;
+				if (tileStart[t] != tileStart[t + 1]) phaseTiles.push_back(t);
+			}
+		}
+		threadPool->ParallelFor((int)phaseTiles.size(), [&](int index) {
+			int t = phaseTiles[index];
+			for (int i = tileStart[t]; i < tileStart[t + 1]; i++) {
+				assignCluster(tileClusters[i]);
+				if (pCheckpoint && !pCheckpoint->Step()) return;
+			}
+		});
+		if (pCheckpoint && pCheckpoint->Stopped()) return false;
+	}
+	return true;
+}
+
+// One scratch per worker with the distances of the selected kernel for blocks of blockPixels;
+// AssignBlock() refills them in place
+void SLICProcessor::ReserveCellScratch(size_t blockPixels)
+{
+	size_t workers = (threadPool != NULL) ? (size_t)threadPool->ThreadCount() : 1;
+	if (cellScratch.size() < workers) cellScratch.resize(workers);
+	for (SlicCellScratch& scratch : cellScratch) {
+		scratch.assignRow = SLICGetAssignRowProc(isa, luma);
+		scratch.assignRowInt = SLICGetAssignRowIntProc(isa, luma);
+		if (kernel == kSLICKernelReference) {
+			if (scratch.distances.size() < blockPixels) SLICResizeBuffer(scratch.distances, blockPixels);
+		} else if (kernel == kSLICKernelInteger) {
+			if (scratch.distancesI.size() < blockPixels) SLICResizeBuffer(scratch.distancesI, blockPixels);
+		} else {
+			if (scratch.distancesF.size() < blockPixels) SLICResizeBuffer(scratch.distancesF, blockPixels);
+		}
+	}
+}
+
+// Labels one block of blockCells x blockCells grid cells. Only the clusters bucketed in the
+// block's cells and the ring of cells around it can reach it (a window spans S on either side
+// of its center), so their windows are clipped to the block and run through the usual kernels
+// against block sized distances. Every candidate sees the same pixels as in the cluster
+// order, so the labels are identical. Returns the number of pixel evaluations.
+long long SLICProcessor::AssignBlock(int blockX, int blockY, int ns, double m, SlicCellScratch& scratch)
+{
+	int cellsX = SlicCellCount(width, ns);
+	int cellsY = SlicCellCount(height, ns);
+	int blockCells = SlicBlockCells(ns);
+	int blockSize = blockCells * ns;
+	SlicWindow block = { blockX * blockSize, std::min(width, (blockX + 1) * blockSize), blockY * blockSize, std::min(height, (blockY + 1) * blockSize) };
+	// Transparent pixels keep the label -1 from ResetAssignment()
+	if (!occupancy.Clip(block)) return 0;
+	int blockWidth = block.x1 - block.x0;
+	size_t blockPixels = (size_t)blockWidth * (block.y1 - block.y0);
+	double weight = m * m / (ns * ns);
+	float spatialWeight = (float)weight;
+
+	for (int y = block.y0; y < block.y1; y++) {
+		size_t row = (size_t)y * width;
+		if (narrowLabels) std::fill(labels16.begin() + row + block.x0, labels16.begin() + row + block.x1, kNoLabel16);
+		else              std::fill(labels.begin() + row + block.x0, labels.begin() + row + block.x1, -1);
+	}
+	if (kernel == kSLICKernelReference)    scratch.distances.assign(blockPixels, std::numeric_limits<double>::max());
+	else if (kernel == kSLICKernelInteger) scratch.distancesI.assign(blockPixels, std::numeric_limits<int>::max());
+	else                                   scratch.distancesF.assign(blockPixels, std::numeric_limits<float>::max());
+
+	long long evaluated = 0;
+	int cy0 = std::max(0, blockY * blockCells - 1), cy1 = std::min(cellsY - 1, (blockY + 1) * blockCells);
+	int cx0 = std::max(0, blockX * blockCells - 1), cx1 = std::min(cellsX - 1, (blockX + 1) * blockCells);
+	for (int cy = cy0; cy <= cy1; cy++) {
+		for (int cx = cx0; cx <= cx1; cx++) {
+			int c = cy * cellsX + cx;
+			for (int i = cellStart[c]; i < cellStart[c + 1]; i++) {
+				int k = cellClusters[i];
+				SlicWindow w = ClusterWindow(k, ns);
+				w.x0 = std::max(w.x0, block.x0);
+				w.x1 = std::min(w.x1, block.x1);
+				w.y0 = std::max(w.y0, block.y0);
+				w.y1 = std::min(w.y1, block.y1);
+				if (w.x0 >= w.x1 || w.y0 >= w.y1) continue;
+				size_t offset = (size_t)(w.y0 - block.y0) * blockWidth + (w.x0 - block.x0);
+				if (kernel == kSLICKernelFloat)          AssignWindowFloat(k, w, spatialWeight, scratch.assignRow, &scratch.distancesF[offset], blockWidth);
+				else if (kernel == kSLICKernelReference) AssignWindowReference(k, w, weight, &scratch.distances[offset], blockWidth);
+				else if (kernel == kSLICKernelInteger)   AssignWindowInteger(k, w, weight, scratch.assignRowInt, &scratch.distancesI[offset], blockWidth);
+				else if (luma && narrowLabels)           AssignWindowCompact<true>(k, w, spatialWeight, labels16.data(), &scratch.distancesF[offset], blockWidth);
+				else if (luma)                           AssignWindowCompact<true>(k, w, spatialWeight, labels.data(), &scratch.distancesF[offset], blockWidth);
+				else if (narrowLabels)                   AssignWindowCompact<false>(k, w, spatialWeight, labels16.data(), &scratch.distancesF[offset], blockWidth);
+				else                                     AssignWindowCompact<false>(k, w, spatialWeight, labels.data(), &scratch.distancesF[offset], blockWidth);
+				evaluated += (long long)(w.x1 - w.x0) * (w.y1 - w.y0);
+			}
+		}
+	}
+	return evaluated;
+}
+
+// Pixel-centric assignment: clusters are bucketed into S x S grid cells by their center and
+// every block of cells is labeled on its own, in raster order, so rows of blocks split freely
+// over the threads and no image sized distance plane is kept. activeOnly relabels only the
+// blocks that touch a tile SelectActive() cleared; the other blocks keep their labels, as in
+// the active set of the cluster order.
+bool SLICProcessor::AssignPixels(int ns, double m, bool activeOnly, SLICCheckpoint* pCheckpoint)
+{
+	int clusterCount = (int)clusters.size();
+	int cellsX = SlicCellCount(width, ns);
+	int cellsY = SlicCellCount(height, ns);
+	int cellCount = cellsX * cellsY;
+	int blockSize = SlicBlockCells(ns) * ns;
+	int blocksX = SlicCellCount(width, blockSize);
+	int blocksY = SlicCellCount(height, blockSize);
+
+	// Counting sort of clusters by cell
+	tileOf.resize(clusterCount);
+	cellStart.assign(cellCount + 1, 0);
+	for (int k = 0; k < clusterCount; k++) {
+		int cx = std::min(cellsX - 1, std::max(0, (int)clusters[k].x / ns));
+		int cy = std::min(cellsY - 1, std::max(0, (int)clusters[k].y / ns));
+		tileOf[k] = cy * cellsX + cx;
+		cellStart[tileOf[k] + 1]++;
+	}
+	for (int c = 0; c < cellCount; c++) cellStart[c + 1] += cellStart[c];
+	cellClusters.resize(clusterCount);
+	tileFill.assign(cellStart.begin(), cellStart.end() - 1);
+	for (int k = 0; k < clusterCount; k++) cellClusters[tileFill[tileOf[k]]++] = k;
+
+	int tileSize = std::max(1, ns / 4); // SelectActive() tiles
+	int tilesX = (width + tileSize - 1) / tileSize;
+	auto blockCleared = [&](int blockX, int blockY) {
+		int tx0 = blockX * blockSize / tileSize, tx1 = (std::min(width, (blockX + 1) * blockSize) - 1) / tileSize;
+		int ty0 = blockY * blockSize / tileSize, ty1 = (std::min(height, (blockY + 1) * blockSize) - 1) / tileSize;
+		for (int ty = ty0; ty <= ty1; ty++) {
+			for (int tx = tx0; tx <= tx1; tx++) {
+				if (clearedTiles[(size_t)ty * tilesX + tx]) return true;
+			}
+		}
+		return false;
+	};
+
+	ReserveCellScratch((size_t)blockSize * blockSize);
+	std::atomic<long long> evaluated(0);
+	auto assignBlockRow = [&](int blockY, int worker) {
+		if (pCheckpoint && pCheckpoint->Stopped()) return;
+		SlicCellScratch& scratch = cellScratch[worker];
+		long long count = 0;
+		for (int blockX = 0; blockX < blocksX; blockX++) {
+			if (!activeOnly || blockCleared(blockX, blockY)) count += AssignBlock(blockX, blockY, ns, m, scratch);
+			if (pCheckpoint && !pCheckpoint->Step()) break;
+		}
+		evaluated += count;
+	};
+
+	if (threadPool != NULL && threadPool->ThreadCount() > 1) threadPool->ParallelForWorkers(blocksY, assignBlockRow);
+	else for (int blockY = 0; blockY < blocksY; blockY++) assignBlockRow(blockY, 0);
+	pixelsEvaluated = evaluated;
+	return !(pCheckpoint && pCheckpoint->Stopped());
+}
+
+// Accumulates rows [y0, y1) into acc, indexed by label - base. Coordinates come from the
+// loop counters; transparent pixels never receive a label, so label < 0 is the only check and
+// the spans the occupancy index rules out are skipped without changing the summation order.
+template <class LabSource, class Label>
+static void AccumulateRows(const SLICOccupancy& occupancy, const LabSource& lab, const Label* labels, int width, int y0, int y1, int base, SlicAccumulator* acc)
+{
+	for (int y = y0; y < y1; y++) {
+		size_t row = (size_t)y * width;
+		occupancy.ForEachSpan(y, 0, width, [&](int x0, int x1, bool) {
+			for (int x = x0; x < x1; x++) {
+				int k = LabelValue(labels[row + x]);
+				if (k < 0) continue;
+				SlicAccumulator& s = acc[k - base];
+				lab.Add(row + x, s);
+				s.x += x;
+				s.y += y;
+				s.count++;
+			}
+		});
+	}
+}
+
+struct SlicLabSourceAoS {
+	const SlicColor* data;
+	void Add(size_t idx, SlicAccumulator& s) const { s.l += data[idx].l; s.a += data[idx].a; s.b += data[idx].b; }
+};
+
+// The plane sources read L only when Luma is set; the a and b sums stay 0
+template <bool Luma>
+struct SlicLabSourcePlanes {
+	const float* L;
+	const float* A;
+	const float* B;
+	void Add(size_t idx, SlicAccumulator& s) const
+	{
+		s.l += L[idx];
+		if constexpr (!Luma) {
+			s.a += A[idx];
+			s.b += B[idx];
+		}
+	}
+};
+
+// The fixed point values are exact multiples of 1/64 in double, so the sums are exact integer
+// sums (as int64 would be) and do not depend on the summation order
+template <bool Luma>
+struct SlicLabSourceInteger {
+	const short* L;
+	const short* A;
+	const short* B;
+	void Add(size_t idx, SlicAccumulator& s) const
+	{
+		s.l += L[idx] * (1.0 / kSLICLabIntScale);
+		if constexpr (!Luma) {
+			s.a += A[idx] * (1.0 / kSLICLabIntScale);
+			s.b += B[idx] * (1.0 / kSLICLabIntScale);
+		}
+	}
+};
+
+template <bool Luma>
+struct SlicLabSourceCompact {
+	const unsigned short* L;
+	const unsigned short* A;
+	const unsigned short* B;
+	void Add(size_t idx, SlicAccumulator& s) const
+	{
+		s.l += DequantizeL(L[idx]);
+		if constexpr (!Luma) {
+			s.a += DequantizeAB(A[idx]);
+			s.b += DequantizeAB(B[idx]);
+		}
+	}
+};
+
+template <class Label>
+static void LabelRange(const SLICOccupancy& occupancy, const Label* labels, int width, int y0, int y1, int& kMin, int& kMax)
+{
+	for (int y = y0; y < y1; y++) {
+		const Label* labelRow = labels + (size_t)y * width;
+		occupancy.ForEachSpan(y, 0, width, [&](int x0, int x1, bool) {
+			for (int x = x0; x < x1; x++) {
+				int k = LabelValue(labelRow[x]);
+				if (k < 0) continue;
+				kMin = std::min(kMin, k);
+				kMax = std::max(kMax, k);
+			}
+		});
+	}
+}
+
+// Average. Empty clusters keep their previous state to prevent zeroing/black blocks.
+// The residual is the mean center movement, measured with the assignment metric.
+double SLICApplyClusterSums(std::vector<SlicCluster>& clusters, const std::vector<SlicAccumulator>& sums, double spatialWeight)
+{
+	int clusterCount = (int)clusters.size();
+	double residual = 0.0;
+	for (int k = 0; k < clusterCount; k++) {
+		const SlicAccumulator& s = sums[k];
+		if (s.count > 0) {
+			double count = (double)s.count;
+			SlicCluster prev = clusters[k];
+			clusters[k].l = s.l / count;
+			clusters[k].a = s.a / count;
+			clusters[k].b = s.b / count;
+			clusters[k].x = (double)s.x / count;
+			clusters[k].y = (double)s.y / count;
+			clusters[k].count = (int)s.count;
+
+			double dl = clusters[k].l - prev.l;
+			double da = clusters[k].a - prev.a;
+			double db = clusters[k].b - prev.b;
+			double dx = clusters[k].x - prev.x;
+			double dy = clusters[k].y - prev.y;
+			residual += std::sqrt(dl * dl + da * da + db * db + spatialWeight * (dx * dx + dy * dy));
+		}
+	}
+	return (clusterCount > 0) ? residual / clusterCount : 0.0;
+}
+
+// Cluster update as a row band reduction. Each band sums into its own accumulators covering
+// only the label range found in the band, and the bands are merged in band order. The band
+// height does not depend on the thread count, so the centers are reproducible. The reference
+// kernel uses a single band, which keeps its summation order identical to the original loop.
+double SLICProcessor::UpdateClusters(int ns, double m, bool resetDistances, SLICCheckpoint* pCheckpoint)
+{
+	int clusterCount = (int)clusters.size();
+	bool banded = (kernel != kSLICKernelReference);
+	int bandRows = banded ? SLICReductionRows(ns) : height;
+	int bandCount = (height + bandRows - 1) / bandRows;
+	if ((int)bands.size() < bandCount) bands.resize(bandCount);
+
+	SlicLabSourceAoS aos = { labData.data() };
+	auto accumulate = [&](auto isLuma, int y0, int y1, int base, SlicAccumulator* acc) {
+		constexpr bool Luma = decltype(isLuma)::value;
+		SlicLabSourcePlanes<Luma> planes = { planeL.data(), planeA.data(), planeB.data() };
+		SlicLabSourceCompact<Luma> compact = { planeL16.data(), planeA16.data(), planeB16.data() };
+		SlicLabSourceInteger<Luma> integer = { planeLi.data(), planeAi.data(), planeBi.data() };
+		if (kernel == kSLICKernelFloat)          AccumulateRows(occupancy, planes, labels.data(), width, y0, y1, base, acc);
+		else if (kernel == kSLICKernelReference) AccumulateRows(occupancy, aos, labels.data(), width, y0, y1, base, acc);
+		else if (kernel == kSLICKernelInteger)   AccumulateRows(occupancy, integer, labels.data(), width, y0, y1, base, acc);
+		else if (narrowLabels)                   AccumulateRows(occupancy, compact, labels16.data(), width, y0, y1, base, acc);
+		else                                     AccumulateRows(occupancy, compact, labels.data(), width, y0, y1, base, acc);
+	};
+
+	auto reduceBand = [&](int band) {
+		int y0 = band * bandRows;
+		int y1 = std::min(height, y0 + bandRows);
+
+		int kMin = clusterCount, kMax = -1;
+		if (narrowLabels) LabelRange(occupancy, labels16.data(), width, y0, y1, kMin, kMax);
+		else              LabelRange(occupancy, labels.data(), width, y0, y1, kMin, kMax);
+
+		SlicBandAccumulator& local = bands[band];
+		local.base = kMin;
+		SlicAccumulator zero = { 0.0, 0.0, 0.0, 0, 0, 0 };
+		local.sums.assign((kMax >= kMin) ? (size_t)(kMax - kMin + 1) : 0, zero);
+		// In chunks of rows so the host is polled within a band; the summation order is unchanged
+		const int chunkRows = 64;
+		for (int c0 = y0; c0 < y1; c0 += chunkRows) {
+			int c1 = std::min(y1, c0 + chunkRows);
+			if (kMax >= kMin) {
+				if (luma) accumulate(std::true_type(), c0, c1, kMin, local.sums.data());
+				else      accumulate(std::false_type(), c0, c1, kMin, local.sums.data());
+			}
+			if (pCheckpoint && !pCheckpoint->Step(c1 - c0)) return;
+		}
+
+		// The kernels never lower the distance of a transparent pixel, so only the spans that
+		// may hold opaque pixels need a reset
+		if (resetDistances && banded) {
+			for (int y = y0; y < y1; y++) {
+				size_t row = (size_t)y * width;
+				occupancy.ForEachSpan(y, 0, width, [&](int x0, int x1, bool) { ResetDistances(row + x0, row + x1); });
+			}
+		}
+	};
+
+	if (threadPool != NULL && bandCount > 1) threadPool->ParallelFor(bandCount, reduceBand);
+	else for (int band = 0; band < bandCount; band++) reduceBand(band);
+	if (pCheckpoint && pCheckpoint->Stopped()) return 0.0;
+
+	// Merge in band order
+	SlicAccumulator zero = { 0.0, 0.0, 0.0, 0, 0, 0 };
+	sums.assign(clusterCount, zero);
+	for (int band = 0; band < bandCount; band++) {
+		const SlicBandAccumulator& local = bands[band];
+		for (size_t j = 0; j < local.sums.size(); j++) {
+			SlicAccumulator& dst = sums[local.base + j];
+			const SlicAccumulator& src = local.sums[j];
+			dst.l += src.l;
+			dst.a += src.a;
+			dst.b += src.b;
+			dst.x += src.x;
+			dst.y += src.y;
+			dst.count += src.count;
+		}
+	}
+
+	double residual = SLICApplyClusterSums(clusters, sums, m * m / (ns * ns));
+
+	if (resetDistances && !banded) {
+		distances.assign((size_t)width * height, std::numeric_limits<double>::max());
+	}
+	return residual;
+}
+
+void SLICProcessor::SeedGrid(int step)
+{
+	SLICProfileScope profile("seed");
+	// 1. Initialize Centers
+	clusters.clear();
+	for (int y = step / 2; y < height; y += step) {
+		for (int x = step / 2; x < width; x += step) {
+			int cx = x;
+			int cy = y;
+			size_t centerIdx = (size_t)cy * width + cx;
+
+			// If grid center is transparent (invalid), search neighbors for a valid spot: the first
+			// one in raster order, skipping the tiles the occupancy index knows are transparent
+			if (!validPixels[centerIdx]) {
+				int searchRange = step / 2; 
+				SlicWindow search = { std::max<int>(0, x - searchRange), std::min<int>(width, x + searchRange), std::max<int>(0, y - searchRange), std::min<int>(height, y + searchRange) };
+				bool found = false;
+				if (occupancy.Clip(search)) {
+					for (int ny = search.y0; ny < search.y1 && !found; ny++) {
+						occupancy.ForEachSpan(ny, search.x0, search.x1, [&](int s0, int s1, bool full) {
+							for (int nx = s0; nx < s1 && !found; nx++) {
+								if (full || validPixels[(size_t)ny * width + nx]) {
+									// Found a valid pixel
+									cx = nx;
+									cy = ny;
+									found = true;
+								}
+							}
+						});
+					}
+				}
+				// If no valid pixel found in neighborhood, skip this cluster
+				if (!found) continue;
+				centerIdx = (size_t)cy * width + cx;
+			}
+
+			SlicColor c = LabAt(centerIdx);
+			clusters.push_back({ c.l, c.a, c.b, (double)cx, (double)cy, 0 });
+		}
+	}
+	seedStep = step;
+}
+
+// Also sizes the label plane: 16 bit in the compact kernel while the cluster count fits
+void SLICProcessor::ResetAssignment()
+{
+	SLICProfileScope profile("reset");
+	size_t totalPixels = (size_t)width * height;
+	narrowLabels = (kernel == kSLICKernelCompact && clusters.size() < kNoLabel16);
+	if (narrowLabels) {
+		labels = SLICIntPlane();
+		labels16.assign(totalPixels, kNoLabel16);
+	} else {
+		labels16 = SLICShortPlane();
+		labels.assign(totalPixels, -1);
+	}
+	// Snapshot for the label change counter, only kept while profiling
+	if (SLICProfiler::Enabled()) profileLabels.assign(totalPixels, -1);
+	else                         profileLabels = std::vector<int>();
+	if (engine == kSLICEngineSLIC && assignMode == kSLICAssignPixels) {
+		// AssignBlock() keeps the distances of one block at a time
+		distances = std::vector<double>();
+		distancesF = SLICFloatPlane();
+		distancesI = SLICIntPlane();
+	} else if (kernel == kSLICKernelReference && engine == kSLICEngineSLIC) {
+		distances.assign(totalPixels, std::numeric_limits<double>::max());
+	} else if (kernel == kSLICKernelInteger && engine == kSLICEngineSLIC) {
+		distancesI.assign(totalPixels, std::numeric_limits<int>::max());
+	} else {
+		distancesF.assign(totalPixels, std::numeric_limits<float>::max());
+	}
+}
+
+void SLICProcessor::ResetDistances(size_t start, size_t end)
+{
+	if (assignMode == kSLICAssignPixels) return; // no distance plane
+	if (kernel == kSLICKernelReference)    std::fill(distances.begin() + start, distances.begin() + end, std::numeric_limits<double>::max());
+	else if (kernel == kSLICKernelInteger) std::fill(distancesI.begin() + start, distancesI.begin() + end, std::numeric_limits<int>::max());
+	else                                   std::fill(distancesF.begin() + start, distancesF.begin() + end, std::numeric_limits<float>::max());
+}
+
+// Labels that differ from the last snapshot (unassigned = -1); updates the snapshot
+template <class Label>
+static long long SlicCountLabelChanges(const Label* labelPlane, std::vector<int>& snapshot)
+{
+	long long changes = 0;
+	for (size_t i = 0; i < snapshot.size(); i++) {
+		int label = LabelValue(labelPlane[i]);
+		if (label != snapshot[i]) {
+			snapshot[i] = label;
+			changes++;
+		}
+	}
+	return changes;
+}
+
+void SLICProcessor::ProfileAssignment(int ns, const int* active, int clusterCount)
+{
+	// Window pixels the assignment visited
+	long long evaluated = (assignMode == kSLICAssignPixels) ? pixelsEvaluated : 0;
+	for (int i = 0; i < clusterCount && assignMode == kSLICAssignClusters; i++) {
+		SlicWindow w = ClusterWindow(active ? active[i] : i, ns);
+		if (w.x0 < w.x1 && w.y0 < w.y1) evaluated += (long long)(w.x1 - w.x0) * (w.y1 - w.y0);
+	}
+	SLICProfiler::Counter("pixels evaluated", evaluated);
+	SLICProfiler::Counter("active clusters", clusterCount);
+
+	// Profiling may have been switched on after ResetAssignment()
+	if (profileLabels.size() != (size_t)width * height) return;
+	long long changes = narrowLabels ? SlicCountLabelChanges(labels16.data(), profileLabels) : SlicCountLabelChanges(labels.data(), profileLabels);
+	SLICProfiler::Counter("label changes", changes);
+}
+
+// Active set: after an update, the windows of the clusters that moved more than activeThreshold
+// (at the old and the new center) are cleared, and only the clusters whose window reaches into
+// a cleared S/4 tile are assigned again. Those are the only clusters that can claim a cleared
+// pixel; every other pixel keeps its label and distance. Returns the active count.
+int SLICProcessor::SelectActive(int ns, double m)
+{
+	SLICProfileScope profile("select active");
+	int clusterCount = (int)clusters.size();
+	double spatialWeight = m * m / (ns * ns);
+	int tileSize = std::max(1, ns / 4);
+	int tilesX = (width + tileSize - 1) / tileSize;
+	int tilesY = (height + tileSize - 1) / tileSize;
+	clearedTiles.assign((size_t)tilesX * tilesY, 0);
+
+	auto clearWindow = [&](const SlicCluster& center) {
+		int cx = (int)center.x;
+		int cy = (int)center.y;
+		int startX = std::max<int>(0, cx - ns);
+		int startY = std::max<int>(0, cy - ns);
+		int endX = std::min<int>(width, cx + ns);
+		int endY = std::min<int>(height, cy + ns);
+		if (startX >= endX || startY >= endY) return;
+		for (int y = startY; y < endY; y++) ResetDistances((size_t)y * width + startX, (size_t)y * width + endX);
+		for (int ty = startY / tileSize; ty <= (endY - 1) / tileSize; ty++) {
+			for (int tx = startX / tileSize; tx <= (endX - 1) / tileSize; tx++) clearedTiles[(size_t)ty * tilesX + tx] = 1;
+		}
+	};
+
+	movedClusters.clear();
+	for (int k = 0; k < clusterCount; k++) {
+		const SlicCluster& prev = assignedCenters[k];
+		const SlicCluster& next = clusters[k];
+		double dl = next.l - prev.l;
+		double da = next.a - prev.a;
+		double db = next.b - prev.b;
+		double dx = next.x - prev.x;
+		double dy = next.y - prev.y;
+		if (std::sqrt(dl * dl + da * da + db * db + spatialWeight * (dx * dx + dy * dy)) > activeThreshold) movedClusters.push_back(k);
+	}
+
+	activeClusters.clear();
+	if (movedClusters.empty()) return 0;
+	// Once half of the clusters moved nearly every cluster is active again: reset everything
+	if ((size_t)clusterCount < movedClusters.size() * 2) {
+		ResetDistances(0, (size_t)width * height);
+		for (int k = 0; k < clusterCount; k++) activeClusters.push_back(k);
+		return clusterCount;
+	}
+	for (size_t i = 0; i < movedClusters.size(); i++) {
+		clearWindow(assignedCenters[movedClusters[i]]);
+		clearWindow(clusters[movedClusters[i]]);
+	}
+
+	for (int k = 0; k < clusterCount; k++) {
+		int cx = (int)clusters[k].x;
+		int cy = (int)clusters[k].y;
+		int startX = std::max(0, cx - ns), endX = std::min(width, cx + ns);
+		int startY = std::max(0, cy - ns), endY = std::min(height, cy + ns);
+		if (startX >= endX || startY >= endY) continue;
+		int tx0 = startX / tileSize, tx1 = (endX - 1) / tileSize;
+		int ty0 = startY / tileSize, ty1 = (endY - 1) / tileSize;
+		bool reaches = false;
+		for (int ty = ty0; ty <= ty1 && !reaches; ty++) {
+			for (int tx = tx0; tx <= tx1; tx++) {
+				if (clearedTiles[(size_t)ty * tilesX + tx]) { reaches = true; break; }
+			}
+		}
+		if (reaches) activeClusters.push_back(k);
+	}
+	return (int)activeClusters.size();
+}
+
+SLICResult SLICProcessor::Iterate(int ns, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit)
+{
+	iterationsRun = 0;
+	lastResidual = 0.0;
+	bool activeSet = (activeThreshold > 0.0);
+	SLICCheckpoint checkpoint(callbacks, pCurrentProgress);
+	// The assignment takes about 3/4 of an iteration, the update the rest
+	int assignUnits = progressUnit * 3 / 4;
+	for (int iter = 0; iter < maxIterations; iter++) {
+		if (!checkpoint.Poll()) return checkpoint.Result();
+
+		// Assignment (the pixel order steps once per block)
+		bool all = (iter == 0 || !activeSet);
+		int blockSize = SlicBlockCells(ns) * ns;
+		if (assignMode == kSLICAssignPixels) checkpoint.Begin(assignUnits, (long long)SlicCellCount(width, blockSize) * SlicCellCount(height, blockSize));
+		else                                 checkpoint.Begin(assignUnits, all ? (long long)clusters.size() : (long long)activeClusters.size());
+		{
+			SLICProfileScope profile("assign", iter);
+			if (!Assign(ns, m, all ? NULL : activeClusters.data(), (int)activeClusters.size(), &checkpoint)) return checkpoint.Result();
+		}
+		checkpoint.End();
+		if (SLICProfiler::Enabled()) ProfileAssignment(ns, all ? NULL : activeClusters.data(), all ? (int)clusters.size() : (int)activeClusters.size());
+
+		// Update (also resets distances for the next iteration, except after the last one; the
+		// active set resets only the windows of the clusters that moved)
+		if (activeSet) assignedCenters = clusters;
+		checkpoint.Begin(progressUnit - assignUnits, height);
+		{
+			SLICProfileScope profile("update", iter);
+			lastResidual = UpdateClusters(ns, m, !activeSet && assignMode == kSLICAssignClusters && iter < maxIterations - 1, &checkpoint);
+		}
+		if (checkpoint.Stopped()) return checkpoint.Result();
+		checkpoint.End();
+		iterationsRun = iter + 1;
+		if (convergenceThreshold > 0.0 && lastResidual < convergenceThreshold) {
+			break;
+		}
+		if (activeSet && iter < maxIterations - 1 && SelectActive(ns, m) == 0) {
+			break;
+		}
+	}
+
+	// Skip the progress of iterations saved by early termination
+	if (pCurrentProgress) {
+		*pCurrentProgress += (maxIterations - iterationsRun) * progressUnit;
+	}
+	return kSLICResultContinue;
+}
+
+// --- SNIC ---
+
+static const int kSnicBucketShift = 14; // float bits >> 14: 8 exponent + 9 mantissa bits
+static const int kSnicBucketCount = 1 << (31 - kSnicBucketShift);
+
+static inline int LowestBit(unsigned long long v)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long index;
+	_BitScanForward64(&index, v);
+	return (int)index;
+#else
+	return __builtin_ctzll(v);
+#endif
+}
+
+void SLICSnicQueue::Reset()
+{
+	nodeCount = 0;
+	heads.assign(kSnicBucketCount, -1);
+	bits.assign(kSnicBucketCount / 64, 0);
+	summary.assign(kSnicBucketCount / 64 / 64, 0);
+	top = 0;
+	freeNode = -1;
+}
+
+void SLICSnicQueue::Push(float d, int k, size_t idx)
+{
+	unsigned int key;
+	memcpy(&key, &d, sizeof(key));
+	int bucket = (int)(key >> kSnicBucketShift);
+
+	int n = freeNode;
+	if (n >= 0) {
+		freeNode = NodeAt(n).next;
+	} else {
+		n = nodeCount++;
+		if ((size_t)(n >> kNodeBlockShift) == nodes.size()) nodes.push_back(std::vector<Node>((size_t)1 << kNodeBlockShift));
+	}
+	Node& node = NodeAt(n);
+	node.idx = idx;
+	node.k = k;
+	node.next = heads[bucket];
+	heads[bucket] = n;
+
+	bits[bucket >> 6] |= 1ULL << (bucket & 63);
+	summary[bucket >> 12] |= 1ULL << ((bucket >> 6) & 63);
+	top |= 1ULL << (bucket >> 12);
+}
+
+void SLICSnicQueue::Pop(int& k, size_t& idx)
+{
+	int summaryWord = LowestBit(top);
+	int bitsWord = summaryWord * 64 + LowestBit(summary[summaryWord]);
+	int bucket = bitsWord * 64 + LowestBit(bits[bitsWord]);
+
+	int n = heads[bucket];
+	Node& node = NodeAt(n);
+	k = node.k;
+	idx = node.idx;
+	heads[bucket] = node.next;
+	node.next = freeNode;
+	freeNode = n;
+
+	if (heads[bucket] < 0) {
+		bits[bitsWord] &= ~(1ULL << (bucket & 63));
+		if (bits[bitsWord] == 0) {
+			summary[summaryWord] &= ~(1ULL << (bitsWord & 63));
+			if (summary[summaryWord] == 0) top &= ~(1ULL << summaryWord);
+		}
+	}
+}
+
+// Simple non-iterative clustering (Achanta & Susstrunk 2017). Every seed starts a region; the
+// closest pending pixel of all regions is labeled next and moves its cluster's centroid at
+// once, then its unlabeled opaque 4-neighbours are queued with their distance to that centroid
+// (the SLIC metric, so compactness means the same). A neighbour is not queued again when an
+// earlier entry already reaches it with a smaller distance.
+// get(idx, l, a, b) returns false for transparent pixels.
+template <class LabGetter, class Label>
+SLICResult SLICProcessor::Grow(int ns, double m, const LabGetter& get, Label* labelPlane, SLICCheckpoint& checkpoint, int progressUnits)
+{
+	int clusterCount = (int)clusters.size();
+	double spatialWeight = m * m / ((double)ns * ns);
+	float* best = distancesF.data();
+
+	SlicAccumulator zero = { 0.0, 0.0, 0.0, 0, 0, 0 };
+	sums.assign(clusterCount, zero);
+	snicQueue.Reset();
+	for (int k = clusterCount - 1; k >= 0; k--) {
+		snicQueue.Push(0.0f, k, (size_t)clusters[k].y * width + (size_t)clusters[k].x);
+	}
+
+	// Progress counts labeled pixels; the clock is only read every kStepPixels
+	const int kStepPixels = 1024;
+	size_t validCount = (size_t)std::count(validPixels.begin(), validPixels.end(), true);
+	checkpoint.Begin(progressUnits, (long long)validCount);
+	size_t labeledCount = 0;
+
+	const int offsetX[4] = { -1, 1, 0, 0 };
+	const int offsetY[4] = { 0, 0, -1, 1 };
+	while (!snicQueue.Empty()) {
+		int k;
+		size_t idx;
+		snicQueue.Pop(k, idx);
+		if (LabelValue(labelPlane[idx]) >= 0) continue;
+		// Only seeds can be transparent (neighbours are checked before they are queued)
+		float l = 0.0f, a = 0.0f, b = 0.0f;
+		if (!get(idx, l, a, b)) continue;
+		labelPlane[idx] = (Label)k;
+
+		// Online centroid update
+		int x = (int)(idx % width);
+		int y = (int)(idx / width);
+		SlicAccumulator& s = sums[k];
+		s.l += l;
+		s.a += a;
+		s.b += b;
+		s.x += x;
+		s.y += y;
+		s.count++;
+		SlicCluster& cluster = clusters[k];
+		double inverseCount = 1.0 / (double)s.count;
+		cluster.l = s.l * inverseCount;
+		cluster.a = s.a * inverseCount;
+		cluster.b = s.b * inverseCount;
+		cluster.x = (double)s.x * inverseCount;
+		cluster.y = (double)s.y * inverseCount;
+		cluster.count = (int)s.count;
+
+		for (int n = 0; n < 4; n++) {
+			int nx = x + offsetX[n];
+			int ny = y + offsetY[n];
+			if (nx < 0 || nx >= width || ny < 0 || ny >= height) continue;
+			size_t nIdx = (size_t)ny * width + nx;
+			if (LabelValue(labelPlane[nIdx]) >= 0 || !get(nIdx, l, a, b)) continue;
+
+			double dl = l - cluster.l;
+			double da = a - cluster.a;
+			double db = b - cluster.b;
+			double dx = nx - cluster.x;
+			double dy = ny - cluster.y;
+			float D = (float)(dl * dl + da * da + db * db + spatialWeight * (dx * dx + dy * dy));
+			if (D > best[nIdx]) continue;
+			best[nIdx] = D;
+			snicQueue.Push(D, k, nIdx);
+		}
+
+		labeledCount++;
+		if (labeledCount % kStepPixels == 0 && !checkpoint.Step(kStepPixels)) return checkpoint.Result();
+	}
+
+	checkpoint.End();
+	return kSLICResultContinue;
+}
+
+SLICResult SLICProcessor::Snic(int ns, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit)
+{
+	SLICProfileScope profile("snic");
+	iterationsRun = 1;
+	lastResidual = 0.0;
+	SLICCheckpoint checkpoint(callbacks, pCurrentProgress);
+	if (!checkpoint.Poll()) return checkpoint.Result();
+	// The single pass takes the progress of maxIterations iterations
+	int progressUnits = std::max(1, maxIterations) * progressUnit;
+
+	if (kernel == kSLICKernelFloat) {
+		auto get = [&](size_t idx, float& l, float& a, float& b) {
+			l = planeL[idx];
+			a = luma ? 0.0f : planeA[idx];
+			b = luma ? 0.0f : planeB[idx];
+			return !std::isnan(l);
+		};
+		return Grow(ns, m, get, labels.data(), checkpoint, progressUnits);
+	}
+	if (kernel == kSLICKernelCompact) {
+		auto get = [&](size_t idx, float& l, float& a, float& b) {
+			if (planeL16[idx] == kLab16Transparent) return false;
+			l = DequantizeL(planeL16[idx]);
+			a = luma ? 0.0f : DequantizeAB(planeA16[idx]);
+			b = luma ? 0.0f : DequantizeAB(planeB16[idx]);
+			return true;
+		};
+		if (narrowLabels) return Grow(ns, m, get, labels16.data(), checkpoint, progressUnits);
+		return Grow(ns, m, get, labels.data(), checkpoint, progressUnits);
+	}
+	if (kernel == kSLICKernelInteger) {
+		auto get = [&](size_t idx, float& l, float& a, float& b) {
+			if (planeLi[idx] == kSLICLabIntTransparent) return false;
+			l = DequantizeInt(planeLi[idx]);
+			a = luma ? 0.0f : DequantizeInt(planeAi[idx]);
+			b = luma ? 0.0f : DequantizeInt(planeBi[idx]);
+			return true;
+		};
+		return Grow(ns, m, get, labels.data(), checkpoint, progressUnits);
+	}
+	auto get = [&](size_t idx, float& l, float& a, float& b) {
+		if (!validPixels[idx]) return false;
+		l = (float)labData[idx].l;
+		a = (float)labData[idx].a;
+		b = (float)labData[idx].b;
+		return true;
+	};
+	return Grow(ns, m, get, labels.data(), checkpoint, progressUnits);
+}
+
+// One color conversion per cluster instead of one per pixel
+void SLICBuildPalette(const std::vector<SlicCluster>& clusters, SLICColorMode mode, std::vector<BYTE>& palette)
+{
+	SLICColorConverter converter(mode);
+	palette.resize(clusters.size() * 4);
+	for (size_t k = 0; k < clusters.size(); k++) {
+		converter.LabToRGB(clusters[k].l, clusters[k].a, clusters[k].b, palette[k * 4 + 0], palette[k * 4 + 1], palette[k * 4 + 2]);
+		palette[k * 4 + 3] = 0;
+	}
+}
+
+void SLICProcessor::BuildPalette()
+{
+	SLICProfileScope profile("palette");
+	SLICBuildPalette(clusters, colorMode, palette);
+}
+
+void SLICProcessor::Render(const BYTE* src, int srcRowBytes, BYTE* dst, int dstRowBytes, int x0, int y0, int w, int h) const
+{
+	SLICProfileScope profile("render");
+	int clusterCount = (int)palette.size() / 4;
+	auto renderRows = [&](auto layout, const auto* labelPlane, int row0, int row1) {
+		typedef decltype(layout) Layout;
+		for (int y = row0; y < row1; y++) {
+			const auto* labelRow = labelPlane + (size_t)(y0 + y) * width + x0;
+			const BYTE* srcRow = src + (size_t)(y0 + y) * srcRowBytes + (size_t)x0 * Layout::bytes;
+			BYTE* dstRow = dst + (size_t)y * dstRowBytes;
+			int ty = (y0 + y) >> kSLICOccupancyTileShift;
+			for (int x = 0; x < w; ) {
+				int tx = (x0 + x) >> kSLICOccupancyTileShift;
+				int end = std::min(w, ((tx + 1) << kSLICOccupancyTileShift) - x0);
+				if (occupancy.State(tx, ty) == kSLICTileEmpty) {
+					// Nothing is labeled in an empty tile: the source passes through
+					if (srcRow != dstRow) memmove(dstRow + x * Layout::bytes, srcRow + x * Layout::bytes, (size_t)(end - x) * Layout::bytes);
+					x = end;
+					continue;
+				}
+				for (; x < end; x++) {
+					int k = LabelValue(labelRow[x]);
+					const BYTE* px = srcRow + x * Layout::bytes;
+					BYTE* out = dstRow + x * Layout::bytes;
+					if (k >= 0 && k < clusterCount) {
+						const BYTE* color = &palette[(size_t)k * 4];
+						if constexpr (Layout::gray) {
+							// The palette color of a = b = 0 is neutral
+							out[0] = color[1];
+						} else {
+							out[Layout::r] = color[0];
+							out[Layout::g] = color[1];
+							out[Layout::b] = color[2];
+						}
+					} else if (out != px) {
+						for (int c = 0; c < Layout::bytes; c++) out[c] = px[c];
+					}
+					// The color channels never overlap the alpha, so this is safe in place
+					if constexpr (Layout::alpha >= 0) out[Layout::alpha] = px[Layout::alpha];
+				}
+			}
+		}
+	};
+
+	const int bandRows = 64;
+	int bandCount = (h + bandRows - 1) / bandRows;
+	auto renderBand = [&](int band) {
+		int row0 = band * bandRows;
+		int row1 = std::min(h, row0 + bandRows);
+		SLICDispatchPixelFormat(pixelFormat, [&](auto layout) {
+			if (narrowLabels) renderRows(layout, labels16.data(), row0, row1);
+			else              renderRows(layout, labels.data(), row0, row1);
+		});
+	};
+	if (threadPool != NULL && bandCount > 1) threadPool->ParallelFor(bandCount, renderBand);
+	else for (int band = 0; band < bandCount; band++) renderBand(band);
+}
+
+SLICResult SLICProcessor::Run(int step, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit)
+{
+	// 2. Iterations
+	ResetAssignment();
+	clusterAssignments = 0;
+	SLICResult result = (engine == kSLICEngineSNIC) ? Snic(step, m, callbacks, pCurrentProgress, progressUnit) : Iterate(step, m, callbacks, pCurrentProgress, progressUnit);
+	if (result != kSLICResultContinue) return result;
+
+	// 3. Render Output
+	// Update Progress for Render
+	if (pCurrentProgress) {
+		*pCurrentProgress += progressUnit;
+		if (callbacks && callbacks->setProgressDone) callbacks->setProgressDone(callbacks->data, *pCurrentProgress);
+	}
+	BuildPalette();
+	return kSLICResultContinue;
+}
+
+void SLICLeftoverGrid::Build(const std::vector<SlicCluster>& clusters, int w, int h, int cellStep)
+{
+	step = cellStep;
+	cellsX = (w + step - 1) / step;
+	cellsY = (h + step - 1) / step;
+	int cellCount = cellsX * cellsY;
+	auto cellOf = [&](const SlicCluster& c) {
+		int gx = std::min(cellsX - 1, std::max(0, (int)c.x / step));
+		int gy = std::min(cellsY - 1, std::max(0, (int)c.y / step));
+		return gy * cellsX + gx;
+	};
+	cellStart.assign(cellCount + 1, 0);
+	for (const SlicCluster& c : clusters) cellStart[cellOf(c) + 1]++;
+	for (int i = 0; i < cellCount; i++) cellStart[i + 1] += cellStart[i];
+	std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+	cellClusters.resize(clusters.size());
+	for (int k = 0; k < (int)clusters.size(); k++) cellClusters[fill[cellOf(clusters[k])]++] = k;
+}
+
+int SLICLeftoverGrid::Nearest(const std::vector<SlicCluster>& clusters, int x, int y, const SlicColor& color, double spatialWeight) const
+{
+	int gx = x / step;
+	int gy = y / step;
+	int bestK = -1;
+	double bestD = 0.0;
+	int maxRing = std::max(cellsX, cellsY);
+	int lastRing = maxRing;
+	for (int ring = 0; ring <= lastRing; ring++) {
+		for (int ty = gy - ring; ty <= gy + ring; ty++) {
+			if (ty < 0 || ty >= cellsY) continue;
+			bool edgeRow = (ty == gy - ring || ty == gy + ring);
+			for (int tx = gx - ring; tx <= gx + ring; tx += edgeRow ? 1 : 2 * ring) {
+				if (tx >= 0 && tx < cellsX) {
+					int t = ty * cellsX + tx;
+					for (int i = cellStart[t]; i < cellStart[t + 1]; i++) {
+						const SlicCluster& c = clusters[cellClusters[i]];
+						double dl = color.l - c.l;
+						double da = color.a - c.a;
+						double db = color.b - c.b;
+						double dx = x - c.x;
+						double dy = y - c.y;
+						double D = dl * dl + da * da + db * db + spatialWeight * (dx * dx + dy * dy);
+						if (bestK < 0 || D < bestD || (D == bestD && cellClusters[i] < bestK)) {
+							bestK = cellClusters[i];
+							bestD = D;
+						}
+					}
+				}
+				if (ring == 0) break;
+			}
+		}
+		if (bestK >= 0 && lastRing == maxRing) lastRing = ring + 1;
+	}
+	return bestK;
+}
+
+// Opaque pixels no assignment reached: SNIC regions do not grow across transparent pixels into
+// islands without a seed, and SLIC centers can move out of reach of a pixel. They take the
+// nearest cluster of SLICLeftoverGrid; the centers and the palette are left as they are.
+void SLICProcessor::LabelLeftovers(int step, double m)
+{
+	size_t totalPixels = (size_t)width * height;
+	std::vector<size_t> leftovers;
+	for (size_t idx = 0; idx < totalPixels; idx++) {
+		if (validPixels[idx] && (narrowLabels ? labels16[idx] == kNoLabel16 : labels[idx] < 0)) leftovers.push_back(idx);
+	}
+	if (leftovers.empty() || clusters.empty()) return;
+	SLICProfileScope profile("leftovers");
+
+	SLICLeftoverGrid grid;
+	grid.Build(clusters, width, height, step);
+	double spatialWeight = m * m / ((double)step * step);
+	for (size_t idx : leftovers) {
+		int k = grid.Nearest(clusters, (int)(idx % width), (int)(idx / width), LabAt(idx), spatialWeight);
+		if (narrowLabels) labels16[idx] = (unsigned short)k;
+		else              labels[idx] = k;
+	}
+}
+
+SLICResult SLICProcessor::Execute(int step, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit)
+{
+	if (step < 2) step = 2; // min step
+	SeedGrid(step);
+	SLICResult result = Run(step, m, callbacks, pCurrentProgress, progressUnit);
+	if (result == kSLICResultContinue) LabelLeftovers(step, m);
+	return result;
+}
+
+SLICResult SLICProcessor::Refine(int step, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit)
+{
+	if (step < 2) step = 2; // min step
+	if (clusters.empty() || seedStep != step || engine == kSLICEngineSNIC) SeedGrid(step);
+	SLICResult result = Run(step, m, callbacks, pCurrentProgress, progressUnit);
+	if (result == kSLICResultContinue) LabelLeftovers(step, m);
+	return result;
+}
+
+// The carried centers are checked against the new frame's alpha. A window reaches S around its
+// center, so a center inside an S x S grid cell reaches every pixel of it; a cell without one
+// may still be reached by the windows of its neighbours. Cells with an opaque pixel that no
+// window reaches get a grid seed (the cell center when it is opaque), which labels content
+// that moved into empty areas.
+void SLICProcessor::WarmStart(const std::vector<SlicCluster>& centers, int step)
+{
+	SLICProfileScope profile("seed");
+	if (step < 2) step = 2; // min step
+	int cellsX = (width + step - 1) / step;
+	int cellsY = (height + step - 1) / step;
+	int cellCount = cellsX * cellsY;
+	std::vector<unsigned char> covered(cellCount, 0);
+
+	// 1. Carried centers that still sit on opaque pixels
+	clusters.clear();
+	for (const SlicCluster& c : centers) {
+		int cx = (int)c.x, cy = (int)c.y;
+		if (cx < 0 || cy < 0 || cx >= width || cy >= height || !validPixels[(size_t)cy * width + cx]) continue;
+		clusters.push_back(c);
+		covered[(cy / step) * cellsX + cx / step] = 1;
+	}
+
+	// Centers bucketed by cell: those of cell c are bucketClusters[bucketStart[c], bucketStart[c + 1])
+	std::vector<int> bucketStart, bucketClusters;
+	auto bucket = [&]() {
+		bucketStart.assign(cellCount + 1, 0);
+		for (const SlicCluster& c : clusters) bucketStart[((int)c.y / step) * cellsX + (int)c.x / step + 1]++;
+		for (int i = 0; i < cellCount; i++) bucketStart[i + 1] += bucketStart[i];
+		std::vector<int> fill(bucketStart.begin(), bucketStart.end() - 1);
+		bucketClusters.resize(clusters.size());
+		for (int k = 0; k < (int)clusters.size(); k++) bucketClusters[fill[((int)clusters[k].y / step) * cellsX + (int)clusters[k].x / step]++] = k;
+	};
+	// First opaque pixel of cell (gx, gy), in raster order, that no center's window reaches.
+	// Only centers of the 3 x 3 cells around it can reach it.
+	auto firstUnreached = [&](int gx, int gy, int& x, int& y) {
+		SlicWindow cell = { gx * step, std::min(width, (gx + 1) * step), gy * step, std::min(height, (gy + 1) * step) };
+		if (!occupancy.Clip(cell)) return false;
+		bool found = false;
+		for (int ny = cell.y0; ny < cell.y1 && !found; ny++) {
+			occupancy.ForEachSpan(ny, cell.x0, cell.x1, [&](int s0, int s1, bool full) {
+				for (int nx = s0; nx < s1 && !found; nx++) {
+					if (!full && !validPixels[(size_t)ny * width + nx]) continue;
+					bool reached = false;
+					for (int ty = std::max(0, gy - 1); ty <= std::min(cellsY - 1, gy + 1) && !reached; ty++) {
+						for (int tx = std::max(0, gx - 1); tx <= std::min(cellsX - 1, gx + 1) && !reached; tx++) {
+							int t = ty * cellsX + tx;
+							for (int i = bucketStart[t]; i < bucketStart[t + 1] && !reached; i++) {
+								int cx = (int)clusters[bucketClusters[i]].x, cy = (int)clusters[bucketClusters[i]].y;
+								reached = (nx >= cx - step && nx < cx + step && ny >= cy - step && ny < cy + step);
+							}
+						}
+					}
+					if (!reached) {
+						x = nx;
+						y = ny;
+						found = true;
+					}
+				}
+			});
+		}
+		return found;
+	};
+
+	// 2. Grid seeds for the cells with unreached opaque pixels
+	bucket();
+	size_t carried = clusters.size();
+	for (int gy = 0; gy < cellsY; gy++) {
+		for (int gx = 0; gx < cellsX; gx++) {
+			int x, y;
+			if (covered[gy * cellsX + gx] || !firstUnreached(gx, gy, x, y)) continue;
+			int cx = std::min(width - 1, gx * step + step / 2);
+			int cy = std::min(height - 1, gy * step + step / 2);
+			if (!validPixels[(size_t)cy * width + cx]) {
+				cx = x;
+				cy = y;
+			}
+			SlicColor c = LabAt((size_t)cy * width + cx);
+			clusters.push_back({ c.l, c.a, c.b, (double)cx, (double)cy, 0 });
+			covered[gy * cellsX + gx] = 1;
+		}
+	}
+
+	// 3. Check that every opaque pixel is now in reach of a center; otherwise start from the grid
+	bool reachable = true;
+	if (clusters.size() != carried) bucket();
+	for (int gy = 0; gy < cellsY && reachable; gy++) {
+		for (int gx = 0; gx < cellsX && reachable; gx++) {
+			int x, y;
+			if (!covered[gy * cellsX + gx] && firstUnreached(gx, gy, x, y)) reachable = false;
+		}
+	}
+	if (clusters.empty() || !reachable) {
+		SeedGrid(step);
+		return;
+	}
+	seedStep = step;
+}
+
+// --- Superpixel hierarchy ---
+
+// Merge of two neighbouring regions (a < b), valid while both still carry the stamps they had
+// when it was queued
+struct SlicMergeCandidate {
+	double cost;
+	int a, b;
+	unsigned int stampA, stampB;
+};
+
+// Heap order: cheapest first, ties by region index so the merge order is reproducible
+static bool SlicMergeLater(const SlicMergeCandidate& x, const SlicMergeCandidate& y)
+{
+	if (x.cost != y.cost) return x.cost > y.cost;
+	if (x.a != y.a) return x.a > y.a;
+	return x.b > y.b;
+}
+
+static inline unsigned long long SlicPairKey(int a, int b)
+{
+	if (a > b) std::swap(a, b);
+	return ((unsigned long long)a << 32) | (unsigned int)b;
+}
+
+size_t SLICProcessor::HierarchyMemory(int w, int h, int baseStep)
+{
+	if (baseStep < 2) baseStep = 2;
+	size_t pixels = (size_t)w * (size_t)h;
+	size_t regions = (size_t)((w + baseStep - 1) / baseStep) * (size_t)((h + baseStep - 1) / baseStep);
+	// Fine labels, region sums and merges are kept; the working sums, neighbour lists, border
+	// pairs and the merge heap (about 16 candidates per region) only while building
+	return pixels * sizeof(int) + regions * (2 * sizeof(SlicAccumulator) + sizeof(SlicMerge) + 16 * sizeof(SlicMergeCandidate) + 128);
+}
+
+void SLICProcessor::DropHierarchy()
+{
+	hierarchyRegions.clear();
+	hierarchyMerges.clear();
+	hierarchyStep = 0;
+}
+
+SLICResult SLICProcessor::BuildHierarchy(int baseStep, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit)
+{
+	if (baseStep < 2) baseStep = 2;
+	DropHierarchy();
+	SLICResult result = Execute(baseStep, m, callbacks, pCurrentProgress, progressUnit);
+	if (result != kSLICResultContinue) return result;
+
+	SLICCheckpoint checkpoint(callbacks, NULL);
+	if (!checkpoint.Poll()) return checkpoint.Result();
+	int regionCount = (int)clusters.size();
+	size_t totalPixels = (size_t)width * height;
+	auto labelAt = [&](size_t idx) { return narrowLabels ? LabelValue(labels16[idx]) : labels[idx]; };
+
+	// 1. Fine labels, exact sums of every region and the pairs of 4-neighbouring regions. A border
+	// repeats its pair over many pixels, so a pair equal to the last one of its direction in the
+	// row is skipped before sorting.
+	std::vector<unsigned long long> pairs;
+	{
+		SLICProfileScope profile("hierarchy regions");
+		SLICResizeBuffer(hierarchyLabels, totalPixels);
+		SlicAccumulator zero = { 0.0, 0.0, 0.0, 0, 0, 0 };
+		hierarchyRegions.assign(regionCount, zero);
+		checkpoint.Begin(0, height);
+		for (int y = 0; y < height; y++) {
+			if (!checkpoint.Step()) return checkpoint.Result();
+			size_t row = (size_t)y * width;
+			unsigned long long lastRight = ~0ULL, lastDown = ~0ULL;
+			for (int x = 0; x < width; x++) {
+				size_t idx = row + x;
+				int k = labelAt(idx);
+				hierarchyLabels[idx] = k;
+				if (k < 0) continue;
+				SlicColor c = LabAt(idx);
+				SlicAccumulator& r = hierarchyRegions[k];
+				r.l += c.l;
+				r.a += c.a;
+				r.b += c.b;
+				r.x += x;
+				r.y += y;
+				r.count++;
+				int right = (x + 1 < width) ? labelAt(idx + 1) : -1;
+				if (right >= 0 && right != k && SlicPairKey(k, right) != lastRight) {
+					lastRight = SlicPairKey(k, right);
+					pairs.push_back(lastRight);
+				}
+				int down = (y + 1 < height) ? labelAt(idx + width) : -1;
+				if (down >= 0 && down != k && SlicPairKey(k, down) != lastDown) {
+					lastDown = SlicPairKey(k, down);
+					pairs.push_back(lastDown);
+				}
+			}
+		}
+		std::sort(pairs.begin(), pairs.end());
+		pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+	}
+	if (!checkpoint.Poll()) return checkpoint.Result();
+
+	// 2. Greedy merging. The survivor is the lower index; neighbour lists may still name merged
+	// regions and are resolved through parent when their region merges next. A merge bumps
+	// the survivor's stamp, which voids every queued candidate that involves it.
+	SLICProfileScope profile("hierarchy merge");
+	std::vector<std::vector<int> > neighbors(regionCount);
+	for (unsigned long long key : pairs) {
+		int a = (int)(key >> 32), b = (int)(key & 0xFFFFFFFFULL);
+		neighbors[a].push_back(b);
+		neighbors[b].push_back(a);
+	}
+	std::vector<SlicAccumulator> merged(hierarchyRegions);
+	std::vector<int> parent(regionCount);
+	for (int k = 0; k < regionCount; k++) parent[k] = k;
+	std::vector<unsigned int> stamp(regionCount, 0);
+	auto find = [&](int k) {
+		while (parent[k] != k) k = parent[k] = parent[parent[k]];
+		return k;
+	};
+	double m2 = m * m;
+	auto candidate = [&](int a, int b) {
+		if (a > b) std::swap(a, b);
+		const SlicAccumulator& ra = merged[a];
+		const SlicAccumulator& rb = merged[b];
+		double na = (double)ra.count, nb = (double)rb.count, n = na + nb;
+		double dl = ra.l / na - rb.l / nb, da = ra.a / na - rb.a / nb, db = ra.b / na - rb.b / nb;
+		double dx = (double)ra.x / na - (double)rb.x / nb, dy = (double)ra.y / na - (double)rb.y / nb;
+		SlicMergeCandidate c = { na * nb / n * (dl * dl + da * da + db * db + m2 * (dx * dx + dy * dy) / n), a, b, stamp[a], stamp[b] };
+		return c;
+	};
+	std::vector<SlicMergeCandidate> heap;
+	heap.reserve(pairs.size() * 2);
+	for (unsigned long long key : pairs) heap.push_back(candidate((int)(key >> 32), (int)(key & 0xFFFFFFFFULL)));
+	pairs = std::vector<unsigned long long>();
+	std::make_heap(heap.begin(), heap.end(), SlicMergeLater);
+	hierarchyMerges.reserve(regionCount);
+
+	if (!checkpoint.Poll()) return checkpoint.Result();
+	checkpoint.Begin(0, regionCount);
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), SlicMergeLater);
+		SlicMergeCandidate c = heap.back();
+		heap.pop_back();
+		if (parent[c.a] != c.a || parent[c.b] != c.b || stamp[c.a] != c.stampA || stamp[c.b] != c.stampB) continue;
+		if (!checkpoint.Step()) return checkpoint.Result();
+
+		SlicAccumulator& into = merged[c.a];
+		const SlicAccumulator& from = merged[c.b];
+		into.l += from.l;
+		into.a += from.a;
+		into.b += from.b;
+		into.x += from.x;
+		into.y += from.y;
+		into.count += from.count;
+		parent[c.b] = c.a;
+		stamp[c.a]++;
+		SlicMerge merge = { c.a, c.b };
+		hierarchyMerges.push_back(merge);
+
+		std::vector<int>& list = neighbors[c.a];
+		list.insert(list.end(), neighbors[c.b].begin(), neighbors[c.b].end());
+		std::vector<int>().swap(neighbors[c.b]);
+		for (int& n : list) n = find(n);
+		std::sort(list.begin(), list.end());
+		list.erase(std::unique(list.begin(), list.end()), list.end());
+		list.erase(std::remove(list.begin(), list.end(), c.a), list.end());
+		for (int n : list) {
+			heap.push_back(candidate(c.a, n));
+			std::push_heap(heap.begin(), heap.end(), SlicMergeLater);
+		}
+	}
+	hierarchyStep = baseStep;
+	hierarchyM = m;
+	hierarchyEngine = engine;
+	return kSLICResultContinue;
+}
+
+SLICResult SLICProcessor::CutHierarchy(int step, bool refine, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit)
+{
+	if (step < 2) step = 2; // min step
+	int target = pCurrentProgress ? *pCurrentProgress + (maxIterations + 1) * progressUnit : 0;
+	int regionCount = (int)hierarchyRegions.size();
+	std::vector<int> region(regionCount); // cut id of every fine region, -1 = empty
+	{
+		SLICProfileScope profile("hierarchy cut");
+		long long opaque = 0;
+		long long present = 0;
+		for (const SlicAccumulator& r : hierarchyRegions) {
+			if (r.count == 0) continue;
+			opaque += r.count;
+			present++;
+		}
+		long long wanted = std::max(1LL, std::llround((double)opaque / ((double)step * step)));
+		size_t applied = (size_t)std::min((long long)hierarchyMerges.size(), std::max(0LL, present - wanted));
+
+		// Every merge goes into a lower index, so in index order the target of a merged region
+		// already holds its final id; ids are stored as -1 - id until all regions are resolved
+		for (int k = 0; k < regionCount; k++) region[k] = k;
+		for (size_t i = 0; i < applied; i++) region[hierarchyMerges[i].from] = hierarchyMerges[i].into;
+		int count = 0;
+		for (int k = 0; k < regionCount; k++) {
+			if (region[k] != k) region[k] = region[region[k]];
+			else if (hierarchyRegions[k].count > 0) region[k] = -1 - count++; // root: next id, encoded
+		}
+		SlicAccumulator zero = { 0.0, 0.0, 0.0, 0, 0, 0 };
+		std::vector<SlicAccumulator> regionSums(count, zero);
+		for (int k = 0; k < regionCount; k++) {
+			if (hierarchyRegions[k].count == 0) continue;
+			SlicAccumulator& r = regionSums[-1 - region[k]];
+			r.l += hierarchyRegions[k].l;
+			r.a += hierarchyRegions[k].a;
+			r.b += hierarchyRegions[k].b;
+			r.x += hierarchyRegions[k].x;
+			r.y += hierarchyRegions[k].y;
+			r.count += hierarchyRegions[k].count;
+		}
+		for (int k = 0; k < regionCount; k++) region[k] = (hierarchyRegions[k].count > 0) ? -1 - region[k] : -1;
+		clusters.resize(count);
+		for (int k = 0; k < count; k++) {
+			const SlicAccumulator& r = regionSums[k];
+			double n = (double)r.count;
+			SlicCluster c = { r.l / n, r.a / n, r.b / n, (double)r.x / n, (double)r.y / n, (int)r.count };
+			clusters[k] = c;
+		}
+		seedStep = step;
+	}
+
+	// Cut labels; onlyUnlabeled keeps the pixels an assignment already labeled. Returns the
+	// number of pixels written.
+	auto labelFromCut = [&](bool onlyUnlabeled) {
+		SLICProfileScope profile("hierarchy labels");
+		const int rows = 64;
+		int bandCount = (height + rows - 1) / rows;
+		std::atomic<long long> written(0);
+		auto labelBand = [&](int band) {
+			size_t start = (size_t)band * rows * width;
+			size_t end = std::min((size_t)(band + 1) * rows, (size_t)height) * width;
+			long long count = 0;
+			for (size_t idx = start; idx < end; idx++) {
+				int fine = hierarchyLabels[idx];
+				if (fine < 0) continue;
+				if (narrowLabels) {
+					if (onlyUnlabeled && labels16[idx] != kNoLabel16) continue;
+					labels16[idx] = (unsigned short)region[fine];
+				} else {
+					if (onlyUnlabeled && labels[idx] >= 0) continue;
+					labels[idx] = region[fine];
+				}
+				count++;
+			}
+			written += count;
+		};
+		if (threadPool != NULL && bandCount > 1) threadPool->ParallelFor(bandCount, labelBand);
+		else for (int band = 0; band < bandCount; band++) labelBand(band);
+		return written.load();
+	};
+
+	if (refine && engine != kSLICEngineSNIC) {
+		// One iteration from the region means. Its windows reach S around each center, which
+		// does not cover every cut region (they can be far larger than S x S), so the pixels it
+		// leaves unlabeled keep their cut label and the centers are recomputed over both.
+		int savedIterations = maxIterations;
+		maxIterations = 1;
+		SLICResult result = Run(step, hierarchyM, callbacks, pCurrentProgress, progressUnit);
+		maxIterations = savedIterations;
+		if (result != kSLICResultContinue) return result;
+		if (labelFromCut(true) > 0) {
+			SLICProfileScope profile("hierarchy update");
+			UpdateClusters(step, hierarchyM, false, NULL);
+			BuildPalette();
+		}
+	} else {
+		ResetAssignment();
+		labelFromCut(false);
+		iterationsRun = 0;
+		lastResidual = 0.0;
+		clusterAssignments = 0;
+		BuildPalette();
+	}
+	if (pCurrentProgress) {
+		*pCurrentProgress = target;
+		if (callbacks && callbacks->setProgressDone) callbacks->setProgressDone(callbacks->data, *pCurrentProgress);
+	}
+	return kSLICResultContinue;
+}
+
+long long SLICProcessor::UnlabeledPixels() const
+{
+	long long count = 0;
+	size_t totalPixels = (size_t)width * height;
+	for (size_t idx = 0; idx < totalPixels; idx++) {
+		if (!validPixels[idx]) continue;
+		if (narrowLabels ? labels16[idx] == kNoLabel16 : labels[idx] < 0) count++;
+	}
+	return count;
+}
+
+// --- Preview pyramid ---
+
+// Halves a Lab image: every output pixel averages the opaque pixels of its 2x2 block.
+// get(idx, l, a, b) returns false for transparent pixels. The output is NaN masked.
+template <class LabGetter>
+static void HalveLab(const LabGetter& get, int w, int h, float* dstL, float* dstA, float* dstB)
+{
+	int hw = (w + 1) / 2;
+	int hh = (h + 1) / 2;
+	for (int y = 0; y < hh; y++) {
+		for (int x = 0; x < hw; x++) {
+			float l = 0.0f, a = 0.0f, b = 0.0f;
+			int count = 0;
+			for (int sy = 2 * y; sy < std::min(h, 2 * y + 2); sy++) {
+				for (int sx = 2 * x; sx < std::min(w, 2 * x + 2); sx++) {
+					float pl, pa, pb;
+					if (!get((size_t)sy * w + sx, pl, pa, pb)) continue;
+					l += pl;
+					a += pa;
+					b += pb;
+					count++;
+				}
+			}
+			size_t dst = (size_t)y * hw + x;
+			dstL[dst] = (count > 0) ? l / count : std::numeric_limits<float>::quiet_NaN();
+			dstA[dst] = (count > 0) ? a / count : 0.0f;
+			dstB[dst] = (count > 0) ? b / count : 0.0f;
+		}
+	}
+}
+
+// Builds the given pyramid level (>= 1) of source as a float kernel image. The first level is
+// read straight from the source layout, so no full size copy is made.
+void SLICProcessor::InitializeDownsampled(const SLICProcessor& source, int level)
+{
+	kernel = kSLICKernelFloat;
+	int w = source.width;
+	int h = source.height;
+
+	auto getSource = [&](size_t idx, float& l, float& a, float& b) {
+		if (!source.validPixels[idx]) return false;
+		SlicColor c = source.LabAt(idx);
+		l = (float)c.l;
+		a = (float)c.a;
+		b = (float)c.b;
+		return true;
+	};
+	auto getPlanes = [&](size_t idx, float& l, float& a, float& b) {
+		if (std::isnan(planeL[idx])) return false;
+		l = planeL[idx];
+		a = planeA[idx];
+		b = planeB[idx];
+		return true;
+	};
+
+	// Deeper levels are halved in place: output pixel i only reads pixels at i and after, and
+	// the planes keep the capacity of the first level
+	for (int i = 0; i < level; i++) {
+		int hw = (w + 1) / 2;
+		int hh = (h + 1) / 2;
+		if (i == 0) {
+			SLICResizeBuffer(planeL, (size_t)hw * hh);
+			SLICResizeBuffer(planeA, (size_t)hw * hh);
+			SLICResizeBuffer(planeB, (size_t)hw * hh);
+			HalveLab(getSource, w, h, planeL.data(), planeA.data(), planeB.data());
+		} else {
+			HalveLab(getPlanes, w, h, planeL.data(), planeA.data(), planeB.data());
+			planeL.resize((size_t)hw * hh);
+			planeA.resize((size_t)hw * hh);
+			planeB.resize((size_t)hw * hh);
+		}
+		w = hw;
+		h = hh;
+	}
+
+	width = w;
+	height = h;
+	size_t totalPixels = (size_t)w * h;
+	validPixels.resize(totalPixels);
+	for (size_t i = 0; i < totalPixels; i++) validPixels[i] = !std::isnan(planeL[i]);
+	occupancy.Build(w, h, [&](int x, int y) { return (bool)validPixels[(size_t)y * w + x]; });
+	ResetAssignment();
+}
+
+// Deepest level that keeps at least 4 pixels per superpixel side and a 128 pixel image side
+int SLICProcessor::PreviewLevel(int step) const
+{
+	int level = 0;
+	while (level < 3 && (step >> (level + 1)) >= 4 && (std::min(width, height) >> (level + 1)) >= 128) {
+		level++;
+	}
+	return level;
+}
+
+SLICResult SLICProcessor::ExecutePreview(int step, double m, int level, const SLICCallbacks* callbacks)
+{
+	SLICProfileScope profile("preview", level);
+	if (step < 2) step = 2; // min step
+	if (level <= 0) {
+		SeedGrid(step);
+	} else {
+		// The coarse processor is kept, so its planes are reused by the next preview
+		if (!preview) preview.reset(new SLICProcessor);
+		SLICProcessor& coarse = *preview;
+		coarse.isa = isa;
+		coarse.threadPool = threadPool;
+		coarse.maxIterations = maxIterations;
+		coarse.convergenceThreshold = convergenceThreshold;
+		coarse.activeThreshold = activeThreshold;
+		coarse.assignMode = assignMode;
+		coarse.InitializeDownsampled(*this, level);
+
+		// Same m: the distance is normalized by the grid step, which shrinks with the image
+		int coarseStep = std::max(2, step >> level);
+		coarse.SeedGrid(coarseStep);
+		SLICResult result = coarse.Iterate(coarseStep, m, callbacks, NULL, 0);
+		if (result != kSLICResultContinue) return result;
+
+		// Coarse pixel x covers [x * f, x * f + f) at full size
+		double factor = (double)(1 << level);
+		double offset = (factor - 1.0) * 0.5;
+		clusters.swap(coarse.clusters);
+		for (size_t k = 0; k < clusters.size(); k++) {
+			clusters[k].x = std::min((double)(width - 1), clusters[k].x * factor + offset);
+			clusters[k].y = std::min((double)(height - 1), clusters[k].y * factor + offset);
+		}
+		seedStep = step;
+	}
+
+	ResetAssignment();
+	SLICCheckpoint checkpoint(callbacks, NULL);
+	{
+		SLICProfileScope assignProfile("preview assign");
+		if (!Assign(step, m, NULL, 0, &checkpoint)) return checkpoint.Result();
+	}
+	// The preview is written out before Refine, so it fills the unreached pixels as Execute does
+	LabelLeftovers(step, m);
+	BuildPalette();
+	return kSLICResultContinue;
+}
@@ -0,0 +1,366 @@
+//! SLIC superpixel core
+//! Host independent part of the SLIC filter. No TriglavPlugIn SDK types are used here so the
+//! algorithm can be built and profiled outside of CLIP STUDIO (see Tools/).
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#pragma once
+
+#include "SLICColor.h"
+#include "SLICAssign.h"
+#include "SLICAligned.h"
+#include "SLICOccupancy.h"
+#include "SLICPixel.h"
+#include "SLICThreadPool.h"
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// Result of a host poll. Values follow kTriglavPlugInFilterRunProcessResult* semantics.
+enum SLICResult
+{
+	kSLICResultContinue = 0,
+	kSLICResultRestart,
+	kSLICResultExit,
+	kSLICResultFailed // core only: a host read or write failed
+};
+
+// Host hooks passed to the processor. Every member may be NULL.
+struct SLICCallbacks
+{
+	void* data;
+	// Report progress (absolute value, same unit as the host progress total)
+	void (*setProgressDone)(void* data, int done);
+	// Poll the host between steps. Returns SLICResult.
+	int (*process)(void* data);
+};
+
+// Host progress steps per unit of ProgressTotal() (one iteration). Pass it as progressUnit so
+// the processors can report progress inside an iteration.
+const int kSLICProgressSteps = 100;
+// Longest stretch of work between two host polls inside a step
+const int kSLICPollIntervalMs = 30;
+
+// Cooperative cancellation inside long loops. Step() is called as work items finish, from any
+// thread of the pool; only the thread that created the checkpoint (the host's thread) polls the
+// host, at most once per kSLICPollIntervalMs, and reports progress interpolated over the items
+// of the current span. Once the host asks to stop, every later Step() returns false so the
+// loops drop the rest of their work.
+class SLICCheckpoint {
+public:
+	SLICCheckpoint(const SLICCallbacks* callbacks, int* pCurrentProgress);
+
+	// Starts a span of progressUnits over items work items, from the current progress
+	void Begin(int progressUnits, long long items);
+	// Moves the progress to the end of the span
+	void End();
+	// count items are done; false once the host asked to stop
+	bool Step(long long count = 1);
+	// Polls the host now; false once the host asked to stop
+	bool Poll();
+	bool Stopped() const { return result.load(std::memory_order_relaxed) != kSLICResultContinue; }
+	SLICResult Result() const { return (SLICResult)result.load(); }
+
+private:
+	void Report();
+
+	const SLICCallbacks* callbacks;
+	int* pCurrentProgress;
+	std::thread::id owner;
+	std::chrono::steady_clock::time_point lastPoll;
+	int base, span;
+	long long items;
+	std::atomic<long long> done;
+	std::atomic<int> result;
+};
+
+struct SlicColor {
+	double l, a, b;
+};
+
+struct SlicCluster {
+	double l, a, b;
+	double x, y;
+	int count;
+};
+
+// Per cluster sums of the update step. Coordinates are integers, so they are summed exactly.
+struct SlicAccumulator {
+	double l, a, b;
+	long long x, y;
+	long long count;
+};
+
+// One step of BuildHierarchy(): region from was merged into region into
+struct SlicMerge {
+	int into, from;
+};
+
+struct SlicBandAccumulator {
+	int base; // label of sums[0]
+	std::vector<SlicAccumulator> sums;
+};
+
+// Priority queue of the SNIC region growing. Entries are bucketed by the top bits of their
+// distance (1/512 relative resolution) and the lowest non empty bucket is found through two
+// levels of bitmaps; a bucket pops last in, first out. O(1) per entry, where a binary heap
+// over the whole frontier spends most of the SNIC time.
+class SLICSnicQueue {
+public:
+	SLICSnicQueue() : top(0), nodeCount(0), freeNode(-1) {}
+	void Reset();
+	bool Empty() const { return top == 0; }
+	void Push(float d, int k, size_t idx); // d >= 0
+	void Pop(int& k, size_t& idx);
+
+private:
+	struct Node {
+		size_t idx;
+		int k;
+		int next;
+	};
+	// Nodes live in fixed blocks, so a growing frontier never copies the whole pool (which
+	// would stall the loop between two host polls); blocks are kept across Reset
+	static const int kNodeBlockShift = 16;
+	Node& NodeAt(int n) { return nodes[n >> kNodeBlockShift][n & ((1 << kNodeBlockShift) - 1)]; }
+	std::vector<std::vector<Node> > nodes; // freed nodes are chained from freeNode
+	std::vector<int> heads; // per bucket, -1 = empty
+	std::vector<unsigned long long> bits, summary; // non empty buckets, non zero words of bits
+	unsigned long long top; // non zero words of summary
+	int nodeCount;
+	int freeNode;
+};
+
+// Shared by SLICProcessor and SLICStreamProcessor
+
+// Rows per band of the update reduction. Fixed per step, so sums merge in the same order for
+// any thread count and for in-core and streamed runs.
+inline int SLICReductionRows(int ns) { return (ns * 2 > 64) ? ns * 2 : 64; }
+// Moves every non empty cluster to the mean of its sums; returns the mean center movement
+double SLICApplyClusterSums(std::vector<SlicCluster>& clusters, const std::vector<SlicAccumulator>& sums, double spatialWeight);
+// One RGBX entry per cluster
+void SLICBuildPalette(const std::vector<SlicCluster>& clusters, SLICColorMode mode, std::vector<BYTE>& palette);
+
+// Cluster centers bucketed by S x S cell, for the opaque pixels no assignment reached. Such a
+// pixel takes the cluster with the smallest SLIC distance among the centers of the nearest ring
+// of cells that has any and the ring after it (ties to the lower index).
+class SLICLeftoverGrid {
+public:
+	SLICLeftoverGrid() : step(2), cellsX(0), cellsY(0) {}
+	void Build(const std::vector<SlicCluster>& clusters, int w, int h, int step);
+	// -1 when there are no clusters
+	int Nearest(const std::vector<SlicCluster>& clusters, int x, int y, const SlicColor& color, double spatialWeight) const;
+
+private:
+	int step, cellsX, cellsY;
+	std::vector<int> cellStart, cellClusters; // clusters of cell c are cellClusters[cellStart[c], cellStart[c + 1])
+};
+
+// Assignment kernel (set before Initialize, it decides the Lab layout)
+enum SLICKernel
+{
+	kSLICKernelReference = 0, // double AoS labData, original loop
+	kSLICKernelFloat,         // float SoA planes, SIMD row kernel
+	kSLICKernelCompact,       // 16 bit SoA planes, float distances, 16 bit labels while the cluster count fits
+	kSLICKernelInteger        // 16 bit fixed point SoA planes, int32 distances, integer SIMD row kernel
+};
+
+// Segmentation engine (set before Execute)
+enum SLICEngine
+{
+	kSLICEngineSLIC = 0, // iterative k-means over 2S windows
+	kSLICEngineSNIC      // single pass region growing from the same seeds with a priority queue
+};
+
+// Assignment order of the SLIC engine (set before Execute)
+enum SLICAssignMode
+{
+	kSLICAssignClusters = 0, // every cluster scans its 2S window into an image sized distance plane
+	kSLICAssignPixels        // blocks of S x S grid cells check only the clusters of the cells around them
+};
+
+// Per worker scratch of AssignBlock(): the row kernels and the block distances of the kernel
+struct SlicCellScratch {
+	SLICAssignRowProc assignRow;
+	SLICAssignRowIntProc assignRowInt;
+	std::vector<double> distances;
+	SLICFloatPlane distancesF;
+	SLICIntPlane distancesI;
+};
+
+// Physical memory that is currently free, 0 when the platform cannot tell.
+// The environment variable SLIC_MEMORY_LIMIT_MB lowers it.
+size_t SLICAvailableMemory();
+
+class SLICProcessor {
+public:
+	int width, height;
+	std::vector<SlicColor> labData;
+	SLICIntPlane labels;
+	SLICShortPlane labels16; // Used instead of labels when narrowLabels; 0xFFFF = unassigned
+	bool narrowLabels;
+	std::vector<double> distances;
+	std::vector<SlicCluster> clusters;
+	std::vector<BYTE> palette; // RGBX per cluster, filled by Execute for Render
+	std::vector<bool> validPixels; // Packed alpha mask, one bit per pixel
+	SLICOccupancy occupancy; // Tiles of validPixels
+	SLICFloatPlane planeL, planeA, planeB; // kSLICKernelFloat; L is NaN for transparent pixels
+	SLICShortPlane planeL16, planeA16, planeB16; // kSLICKernelCompact; L is 0xFFFF for transparent pixels
+	SLICFloatPlane distancesF; // kSLICKernelFloat and kSLICKernelCompact
+	SLICInt16Plane planeLi, planeAi, planeBi; // kSLICKernelInteger, x kSLICLabIntScale; L is kSLICLabIntTransparent for transparent pixels
+	SLICIntPlane distancesI; // kSLICKernelInteger
+	SLICPixelFormat pixelFormat; // layout of the buffer given to Initialize
+	bool luma; // gray source on a plane kernel: only the L plane exists, a and b are 0
+
+	// Set before Initialize
+	SLICColorMode colorMode;
+	SLICKernel kernel;
+	SLICIsa isa;
+	SLICThreadPool* threadPool; // Not owned; NULL runs single threaded
+
+	// Set before Execute. Iteration stops early once the mean center movement (Lab + weighted
+	// xy, same metric as the assignment) drops below convergenceThreshold; 0 disables it.
+	// SNIC runs a single pass and only uses maxIterations to divide its progress.
+	SLICEngine engine;
+	SLICAssignMode assignMode;
+	int maxIterations;
+	double convergenceThreshold;
+	// Active set SLIC: after the first iteration only clusters near one that moved more than
+	// this (same metric) are assigned again; 0 assigns every cluster every iteration
+	double activeThreshold;
+
+	// Results of the last Execute
+	int iterationsRun;
+	double lastResidual;
+	int seedStep; // grid step the current clusters were seeded with, 0 = none
+	long long clusterAssignments; // cluster windows assigned by the last Execute
+
+	SLICProcessor() : width(0), height(0), narrowLabels(false), pixelFormat(kSLICPixelRGBA), luma(false), colorMode(kSLICColorFast), kernel(kSLICKernelFloat), isa(kSLICIsaAuto), threadPool(NULL),
+		engine(kSLICEngineSLIC), assignMode(kSLICAssignClusters), maxIterations(10), convergenceThreshold(0.0), activeThreshold(0.0), iterationsRun(0), lastResidual(0.0), seedStep(0),
+		clusterAssignments(0), pixelsEvaluated(0), hierarchyStep(0), hierarchyM(0.0), hierarchyEngine(kSLICEngineSLIC) {}
+
+	// srcBuffer holds format pixels, rowBytes may include padding. Gray formats keep only L.
+	void Initialize(int w, int h, const BYTE* srcBuffer, int rowBytes, SLICPixelFormat format);
+
+	// Frees every per-image buffer; settings are kept. Without it the buffers are kept for the
+	// next Initialize, which only reallocates those that need to grow.
+	void Release();
+	// Bytes the per-image buffers hold, including capacity left over from a larger image
+	size_t ReservedBytes() const;
+
+	// Bytes the processor holds for a w x h image of the given format at the given step
+	// (Initialize + Execute, plus the pyramid when preview is set). The caller's source and
+	// destination bitmaps are not included.
+	static size_t EstimateMemory(int w, int h, int step, SLICKernel kernel, SLICAssignMode assignMode, SLICPixelFormat format, bool preview);
+
+	// Progress used by Initialize (1 unit) + Execute: one unit per iteration and one for
+	// rendering, kSLICProgressSteps each
+	int ProgressTotal() const { return (maxIterations + 2) * kSLICProgressSteps; }
+
+	// Runs clustering and builds the palette for Render.
+	// Progress moves through progressUnit over every iteration and by progressUnit before
+	// rendering; iterations skipped by convergence are added at once. The host is polled at the
+	// start of every iteration and at least every kSLICPollIntervalMs inside it.
+	SLICResult Execute(int step, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit);
+
+	// Same as Execute, but starts from the current clusters (a preview, or the previous run as a
+	// warm start) instead of the grid. Falls back to the grid when they were seeded for another step.
+	// SNIC always grows from the grid, so its result does not depend on the previous run.
+	SLICResult Refine(int step, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit);
+
+	// Temporal warm start: makes centers, the converged clusters of the previous frame of a
+	// sequence (same size, clustered at step), the start of the next Refine. Call after Initialize:
+	// centers on now transparent pixels are dropped and S x S cells with opaque pixels no window
+	// reaches get a grid seed, falling back to SeedGrid when that still leaves pixels out of reach.
+	void WarmStart(const std::vector<SlicCluster>& centers, int step);
+
+	// Superpixel hierarchy: clusters the image once at baseStep, then merges neighbouring
+	// superpixels two at a time, cheapest first, until one region per connected area is left.
+	// The cost is Ward's (increase of the squared error) over Lab and position, with the
+	// position weighted by m over the size of the merged region like the SLIC distance.
+	// Progress is that of Execute; the merging after it polls the host but leaves the progress.
+	// Kept until the next Initialize or Release.
+	SLICResult BuildHierarchy(int baseStep, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit);
+	// True when the kept hierarchy was built with these parameters and the current engine
+	bool HasHierarchy(int baseStep, double m) const { return hierarchyStep == baseStep && hierarchyM == m && hierarchyEngine == engine; }
+	// Labels the image with about one region per step x step opaque pixels, undoing the last
+	// merges of the hierarchy, and builds the palette for Render. refine follows with one SLIC
+	// iteration from the region means (ignored by SNIC); pixels it does not reach keep their
+	// cut label. Uses the progress of one Execute.
+	SLICResult CutHierarchy(int step, bool refine, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit);
+	// Bytes BuildHierarchy adds to EstimateMemory(w, h, baseStep, ...) while it runs
+	static size_t HierarchyMemory(int w, int h, int baseStep);
+
+	// Pyramid level (each level halves the size) the preview runs on; 0 = too small to be worth it
+	int PreviewLevel(int step) const;
+	// Clusters the image at the given pyramid level, scales the centers back up and labels the
+	// full size image with a single full resolution assignment, ready for Render. The host is
+	// polled between coarse iterations, progress is left untouched. Follow with Refine().
+	SLICResult ExecutePreview(int step, double m, int level, const SLICCallbacks* callbacks);
+
+	// Opaque pixels the last run left without a label (Render passes them through unchanged);
+	// 0 after every complete run
+	long long UnlabeledPixels() const;
+
+	// Writes the w x h block at (x0, y0) of the result straight into dst, which points at the
+	// block's first pixel and has the layout given to Initialize. Labeled pixels take their
+	// cluster's palette color; alpha and unlabeled pixels come from src, the buffer given to
+	// Initialize (may be the same memory as dst).
+	void Render(const BYTE* src, int srcRowBytes, BYTE* dst, int dstRowBytes, int x0, int y0, int w, int h) const;
+
+private:
+	SlicColor LabAt(size_t idx) const;
+	void InitializeDownsampled(const SLICProcessor& source, int level);
+	void SeedGrid(int step);
+	void ResetAssignment();
+	SLICResult Iterate(int ns, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit);
+	SLICResult Snic(int ns, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit);
+	template <class LabGetter, class Label> SLICResult Grow(int ns, double m, const LabGetter& get, Label* labelPlane, SLICCheckpoint& checkpoint, int progressUnits);
+	SLICResult Run(int step, double m, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit);
+	void LabelLeftovers(int step, double m);
+	void BuildPalette();
+	void DropHierarchy();
+	bool Assign(int ns, double m, const int* active, int activeCount, SLICCheckpoint* pCheckpoint); // false when stopped
+	int SelectActive(int ns, double m);
+	void ProfileAssignment(int ns, const int* active, int clusterCount); // profiler counters of the last Assign()
+	bool AssignPixels(int ns, double m, bool activeOnly, SLICCheckpoint* pCheckpoint); // false when stopped
+	long long AssignBlock(int blockX, int blockY, int ns, double m, SlicCellScratch& scratch);
+	void ReserveCellScratch(size_t blockPixels); // grows only
+	SlicWindow ClusterWindow(int k, int ns) const; // clipped to the opaque tiles
+	// Window kernels; dist points at the distance of pixel (w.x0, w.y0), rows are distStride apart
+	void AssignWindowReference(int k, const SlicWindow& w, double spatialWeight, double* dist, size_t distStride);
+	void AssignWindowFloat(int k, const SlicWindow& w, float spatialWeight, SLICAssignRowProc assignRow, float* dist, size_t distStride);
+	template <bool Luma, class Label> void AssignWindowCompact(int k, const SlicWindow& w, float spatialWeight, Label* labelPlane, float* dist, size_t distStride);
+	void AssignWindowInteger(int k, const SlicWindow& w, double spatialWeight, SLICAssignRowIntProc assignRow, int* dist, size_t distStride);
+	void ResetDistances(size_t start, size_t end); // pixels [start, end) of the kernel's distance plane
+	double UpdateClusters(int ns, double m, bool resetDistances, SLICCheckpoint* pCheckpoint); // returns the residual; clusters are kept when stopped
+
+	// Assign() scratch, kept to avoid reallocation per iteration
+	std::vector<int> tileOf, tileStart, tileFill, tileClusters, phaseTiles;
+	// AssignPixels() grid index: clusters of cell c are cellClusters[cellStart[c], cellStart[c + 1])
+	std::vector<int> cellStart, cellClusters;
+	std::vector<SlicCellScratch> cellScratch; // one per thread pool worker, sized by ReserveCellScratch()
+	long long pixelsEvaluated; // by the last AssignPixels(), for the profiler
+	// SelectActive() state: centers of the last assignment, clusters to assign next
+	std::vector<SlicCluster> assignedCenters;
+	std::vector<int> activeClusters, movedClusters;
+	std::vector<unsigned char> clearedTiles;
+	// ProfileAssignment() label snapshot, empty unless profiling
+	std::vector<int> profileLabels;
+	// UpdateClusters() scratch
+	std::vector<SlicBandAccumulator> bands;
+	std::vector<SlicAccumulator> sums;
+	// Grow() queue
+	SLICSnicQueue snicQueue;
+	// ExecutePreview() pyramid level, kept until Release()
+	std::unique_ptr<SLICProcessor> preview;
+	// BuildHierarchy() result: fine label per pixel (-1 = unlabeled), sums of every fine
+	// superpixel and the merges in order; hierarchyStep 0 = none
+	SLICIntPlane hierarchyLabels;
+	std::vector<SlicAccumulator> hierarchyRegions;
+	std::vector<SlicMerge> hierarchyMerges;
+	int hierarchyStep;
+	double hierarchyM;
+	SLICEngine hierarchyEngine;
+};
@@ -0,0 +1,49 @@
+//! Idle release timer
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICIdleTimer.h"
+
+SLICIdleTimer::~SLICIdleTimer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	if (thread.joinable()) thread.join();
+}
+
+void SLICIdleTimer::Arm(int delayMs, const std::function<void()>& newTask)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = newTask;
+		deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs);
+		armed = true;
+		if (!thread.joinable()) thread = std::thread(&SLICIdleTimer::TimerMain, this);
+	}
+	wake.notify_all();
+}
+
+void SLICIdleTimer::Cancel()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	armed = false;
+	task = std::function<void()>();
+}
+
+void SLICIdleTimer::TimerMain()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!quit) {
+		if (!armed) {
+			wake.wait(lock);
+		} else if (std::chrono::steady_clock::now() < deadline) {
+			wake.wait_until(lock, deadline);
+		} else {
+			armed = false;
+			std::function<void()> expired;
+			expired.swap(task);
+			expired();
+		}
+	}
+}
@@ -0,0 +1,35 @@
+//! Idle release timer
+//! Runs a task on a background thread once the plugin has been idle for a while; the filter
+//! uses it to free the buffers it keeps between FilterRun calls when the user stops filtering.
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+
+class SLICIdleTimer {
+public:
+	SLICIdleTimer() : armed(false), quit(false) {}
+	~SLICIdleTimer();
+
+	// Runs task on the timer thread delayMs from now unless Cancel() or another Arm() comes first.
+	// The thread is started by the first call.
+	void Arm(int delayMs, const std::function<void()>& task);
+	// Drops the pending task. A task that is already running is waited for, so the caller may
+	// use what it frees as soon as this returns.
+	void Cancel();
+
+private:
+	void TimerMain();
+
+	std::thread thread;
+	std::mutex mutex; // also held while the task runs
+	std::condition_variable wake;
+	std::function<void()> task;
+	std::chrono::steady_clock::time_point deadline;
+	bool armed;
+	bool quit;
+};
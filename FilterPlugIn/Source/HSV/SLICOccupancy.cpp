@@ -0,0 +1,35 @@
+//! Alpha occupancy index
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICOccupancy.h"
+
+void SLICOccupancy::Release()
+{
+	width = 0;
+	height = 0;
+	tilesX = 0;
+	tilesY = 0;
+	states = std::vector<unsigned char>();
+	bounds = std::vector<SlicWindow>();
+}
+
+bool SLICOccupancy::Clip(SlicWindow& w) const
+{
+	if (w.x0 >= w.x1 || w.y0 >= w.y1) return false;
+	SlicWindow u = { w.x1, w.x0, w.y1, w.y0 };
+	for (int ty = w.y0 >> kSLICOccupancyTileShift; ty <= (w.y1 - 1) >> kSLICOccupancyTileShift; ty++) {
+		for (int tx = w.x0 >> kSLICOccupancyTileShift; tx <= (w.x1 - 1) >> kSLICOccupancyTileShift; tx++) {
+			size_t t = (size_t)ty * tilesX + tx;
+			if (states[t] == kSLICTileEmpty) continue;
+			const SlicWindow& b = bounds[t];
+			u.x0 = std::min(u.x0, b.x0);
+			u.x1 = std::max(u.x1, b.x1);
+			u.y0 = std::min(u.y0, b.y0);
+			u.y1 = std::max(u.y1, b.y1);
+		}
+	}
+	w.x0 = std::max(w.x0, u.x0);
+	w.x1 = std::min(w.x1, u.x1);
+	w.y0 = std::max(w.y0, u.y0);
+	w.y1 = std::min(w.y1, u.y1);
+	return w.x0 < w.x1 && w.y0 < w.y1;
+}
@@ -0,0 +1,130 @@
+//! Alpha occupancy index
+//! Splits the image into square tiles and records in one pass over the alpha whether each tile
+//! is empty, full or mixed, with the bounding box of its opaque pixels. The processor uses it
+//! to skip transparent areas, so mostly transparent layers cost about their opaque area.
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+// Pixel rectangle [x0, x1) x [y0, y1)
+struct SlicWindow {
+	int x0, x1, y0, y1;
+};
+
+enum SLICTileState
+{
+	kSLICTileEmpty = 0, // no opaque pixel
+	kSLICTileFull,      // only opaque pixels
+	kSLICTileMixed
+};
+
+const int kSLICOccupancyTileShift = 5;
+const int kSLICOccupancyTile = 1 << kSLICOccupancyTileShift;
+
+class SLICOccupancy {
+public:
+	SLICOccupancy() : width(0), height(0), tilesX(0), tilesY(0) {}
+
+	// isOpaque(x, y) is called once per pixel, in raster order
+	template <class IsOpaque> void Build(int w, int h, const IsOpaque& isOpaque);
+	void Release();
+
+	int TilesX() const { return tilesX; }
+	int TilesY() const { return tilesY; }
+	SLICTileState State(int tx, int ty) const { return (SLICTileState)states[(size_t)ty * tilesX + tx]; }
+	// Opaque pixels of the tile; empty (x0 >= x1) for an empty tile
+	const SlicWindow& Bounds(int tx, int ty) const { return bounds[(size_t)ty * tilesX + tx]; }
+
+	// Shrinks w to the union of the bounding boxes of the tiles it touches. Every opaque pixel of
+	// w stays inside; false when there is none.
+	bool Clip(SlicWindow& w) const;
+
+	// Calls span(s0, s1, full) from left to right for the parts of row y inside [x0, x1) that may
+	// hold opaque pixels. Neighbouring spans of the same kind are merged; a full span holds
+	// only opaque pixels. Everything else in the row is transparent.
+	template <class Span> void ForEachSpan(int y, int x0, int x1, const Span& span) const;
+
+private:
+	int width, height;
+	int tilesX, tilesY;
+	std::vector<unsigned char> states;
+	std::vector<SlicWindow> bounds;
+};
+
+template <class IsOpaque>
+void SLICOccupancy::Build(int w, int h, const IsOpaque& isOpaque)
+{
+	width = w;
+	height = h;
+	tilesX = (w + kSLICOccupancyTile - 1) >> kSLICOccupancyTileShift;
+	tilesY = (h + kSLICOccupancyTile - 1) >> kSLICOccupancyTileShift;
+	SlicWindow none = { w, 0, h, 0 };
+	bounds.assign((size_t)tilesX * tilesY, none);
+	std::vector<int> opaqueCount((size_t)tilesX * tilesY, 0);
+
+	for (int y = 0; y < h; y++) {
+		SlicWindow* boundsRow = &bounds[(size_t)(y >> kSLICOccupancyTileShift) * tilesX];
+		int* countRow = &opaqueCount[(size_t)(y >> kSLICOccupancyTileShift) * tilesX];
+		for (int tx = 0; tx < tilesX; tx++) {
+			int x1 = std::min(w, (tx + 1) * kSLICOccupancyTile);
+			int first = -1, last = -1, count = 0;
+			for (int x = tx * kSLICOccupancyTile; x < x1; x++) {
+				if (!isOpaque(x, y)) continue;
+				if (first < 0) first = x;
+				last = x;
+				count++;
+			}
+			if (count == 0) continue;
+			SlicWindow& b = boundsRow[tx];
+			b.x0 = std::min(b.x0, first);
+			b.x1 = std::max(b.x1, last + 1);
+			b.y0 = std::min(b.y0, y);
+			b.y1 = y + 1;
+			countRow[tx] += count;
+		}
+	}
+
+	states.resize((size_t)tilesX * tilesY);
+	for (int ty = 0; ty < tilesY; ty++) {
+		for (int tx = 0; tx < tilesX; tx++) {
+			size_t t = (size_t)ty * tilesX + tx;
+			int tileW = std::min(w, (tx + 1) * kSLICOccupancyTile) - tx * kSLICOccupancyTile;
+			int tileH = std::min(h, (ty + 1) * kSLICOccupancyTile) - ty * kSLICOccupancyTile;
+			if (opaqueCount[t] == 0) {
+				states[t] = kSLICTileEmpty;
+				bounds[t].x0 = bounds[t].x1 = bounds[t].y0 = bounds[t].y1 = 0;
+			} else {
+				states[t] = (opaqueCount[t] == tileW * tileH) ? kSLICTileFull : kSLICTileMixed;
+			}
+		}
+	}
+}
+
+template <class Span>
+void SLICOccupancy::ForEachSpan(int y, int x0, int x1, const Span& span) const
+{
+	if (x0 >= x1) return;
+	int ty = y >> kSLICOccupancyTileShift;
+	int pending0 = 0, pending1 = 0;
+	bool pendingFull = false;
+	for (int tx = x0 >> kSLICOccupancyTileShift; tx <= (x1 - 1) >> kSLICOccupancyTileShift; tx++) {
+		size_t t = (size_t)ty * tilesX + tx;
+		const SlicWindow& b = bounds[t];
+		if (states[t] == kSLICTileEmpty || y < b.y0 || y >= b.y1) continue;
+		int s0 = std::max(x0, b.x0);
+		int s1 = std::min(x1, b.x1);
+		if (s0 >= s1) continue;
+		bool full = (states[t] == kSLICTileFull);
+		if (pending1 == s0 && pendingFull == full && pending1 > pending0) {
+			pending1 = s1;
+			continue;
+		}
+		if (pending1 > pending0) span(pending0, pending1, pendingFull);
+		pending0 = s0;
+		pending1 = s1;
+		pendingFull = full;
+	}
+	if (pending1 > pending0) span(pending0, pending1, pendingFull);
+}
@@ -0,0 +1,60 @@
+//! Source pixel layouts
+//! Channel layouts the processors read and render. Every layout has a traits struct with its
+//! channel indices as compile time constants; SLICDispatchPixelFormat() picks the instantiation
+//! once per call, so the per pixel loops carry no format branch.
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#pragma once
+
+enum SLICPixelFormat
+{
+	kSLICPixelRGBA = 0, // 8 bit R, G, B, alpha
+	kSLICPixelBGRA,     // 8 bit B, G, R, alpha (the host's channel order on Windows)
+	kSLICPixelRGB,      // 8 bit R, G, B, always opaque
+	kSLICPixelGrayAlpha // 8 bit gray, alpha; clustered on L alone
+};
+
+template <SLICPixelFormat F> struct SLICPixelLayout;
+
+template <> struct SLICPixelLayout<kSLICPixelRGBA> {
+	static const int bytes = 4, r = 0, g = 1, b = 2, alpha = 3;
+	static const bool gray = false;
+};
+
+template <> struct SLICPixelLayout<kSLICPixelBGRA> {
+	static const int bytes = 4, r = 2, g = 1, b = 0, alpha = 3;
+	static const bool gray = false;
+};
+
+template <> struct SLICPixelLayout<kSLICPixelRGB> {
+	static const int bytes = 3, r = 0, g = 1, b = 2, alpha = -1;
+	static const bool gray = false;
+};
+
+// r, g and b all name the gray channel
+template <> struct SLICPixelLayout<kSLICPixelGrayAlpha> {
+	static const int bytes = 2, r = 0, g = 0, b = 0, alpha = 1;
+	static const bool gray = true;
+};
+
+// Calls fn(SLICPixelLayout<format>())
+template <class Fn>
+inline void SLICDispatchPixelFormat(SLICPixelFormat format, const Fn& fn)
+{
+	switch (format) {
+	case kSLICPixelBGRA:      fn(SLICPixelLayout<kSLICPixelBGRA>()); break;
+	case kSLICPixelRGB:       fn(SLICPixelLayout<kSLICPixelRGB>()); break;
+	case kSLICPixelGrayAlpha: fn(SLICPixelLayout<kSLICPixelGrayAlpha>()); break;
+	default:                  fn(SLICPixelLayout<kSLICPixelRGBA>()); break;
+	}
+}
+
+inline int SLICPixelBytes(SLICPixelFormat format)
+{
+	switch (format) {
+	case kSLICPixelRGB:       return 3;
+	case kSLICPixelGrayAlpha: return 2;
+	default:                  return 4;
+	}
+}
+
+inline bool SLICPixelIsGray(SLICPixelFormat format) { return format == kSLICPixelGrayAlpha; }
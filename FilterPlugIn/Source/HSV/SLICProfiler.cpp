@@ -0,0 +1,234 @@
+//! SLIC profiler
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICProfiler.h"
+#include <chrono>
+#include <mutex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+// A slot is claimed with a ticket from head. sequence is 2 * ticket + 1 while the slot is
+// written and 2 * ticket + 2 once it is complete, so Dump() can skip slots that are torn or
+// were overwritten by a later lap.
+struct SlicProfileSlot
+{
+	std::atomic<unsigned long long> sequence;
+	SLICProfileEventKind kind;
+	int thread;
+	const char* name;
+	long long time;
+	long long duration;
+	long long value;
+	char text[96];
+};
+
+static const unsigned long long kSlotCount = 1 << 14;
+
+static std::atomic<SlicProfileSlot*> ring(NULL);
+static std::atomic<unsigned long long> head(0);
+static std::atomic<int> nextThread(0);
+static std::mutex configMutex; // dump path, ring allocation and Dump()
+static std::string dumpPath;
+
+static int ThreadIndex()
+{
+	thread_local int index = nextThread.fetch_add(1) + 1;
+	return index;
+}
+
+static SlicProfileSlot* Claim(unsigned long long& ticket)
+{
+	SlicProfileSlot* slots = ring.load(std::memory_order_acquire);
+	if (slots == NULL) return NULL;
+	ticket = head.fetch_add(1, std::memory_order_relaxed);
+	SlicProfileSlot* slot = &slots[ticket & (kSlotCount - 1)];
+	slot->sequence.store(2 * ticket + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot->thread = ThreadIndex();
+	return slot;
+}
+
+static void Publish(SlicProfileSlot* slot, unsigned long long ticket)
+{
+	slot->sequence.store(2 * ticket + 2, std::memory_order_release);
+}
+
+static void WriteJsonString(FILE* file, const char* text)
+{
+	fputc('"', file);
+	for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+		if (*p == '"' || *p == '\\') fprintf(file, "\\%c", *p);
+		else if (*p < 0x20) fprintf(file, "\\u%04x", *p);
+		else fputc(*p, file);
+	}
+	fputc('"', file);
+}
+
+std::atomic<bool> SLICProfiler::enabled(false);
+
+void SLICProfiler::SetEnabled(bool on)
+{
+	if (on && ring.load() == NULL) {
+		std::lock_guard<std::mutex> lock(configMutex);
+		if (ring.load() == NULL) {
+			SlicProfileSlot* slots = new SlicProfileSlot[kSlotCount];
+			for (unsigned long long i = 0; i < kSlotCount; i++) slots[i].sequence.store(0, std::memory_order_relaxed);
+			ring.store(slots, std::memory_order_release);
+		}
+	}
+	enabled.store(on);
+}
+
+void SLICProfiler::SetDumpPath(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(configMutex);
+	dumpPath = path;
+}
+
+std::string SLICProfiler::DumpPath()
+{
+	std::lock_guard<std::mutex> lock(configMutex);
+	return dumpPath;
+}
+
+bool SLICProfiler::ConfigureFromEnvironment()
+{
+	const char* path = getenv("SLIC_PROFILE");
+	if (path != NULL && path[0] != '\0') {
+		SetDumpPath(path);
+		SetEnabled(true);
+	}
+	return Enabled();
+}
+
+long long SLICProfiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SLICProfiler::Phase(const char* name, long long startNs, long long endNs, long long arg)
+{
+	if (!Enabled()) return;
+	unsigned long long ticket;
+	SlicProfileSlot* slot = Claim(ticket);
+	if (slot == NULL) return;
+	slot->kind = kSLICProfilePhase;
+	slot->name = name;
+	slot->time = startNs;
+	slot->duration = endNs - startNs;
+	slot->value = arg;
+	Publish(slot, ticket);
+}
+
+void SLICProfiler::Counter(const char* name, long long value)
+{
+	if (!Enabled()) return;
+	unsigned long long ticket;
+	SlicProfileSlot* slot = Claim(ticket);
+	if (slot == NULL) return;
+	slot->kind = kSLICProfileCounter;
+	slot->name = name;
+	slot->time = Now();
+	slot->duration = 0;
+	slot->value = value;
+	Publish(slot, ticket);
+}
+
+void SLICProfiler::Message(const std::string& text)
+{
+	if (!Enabled()) return;
+	unsigned long long ticket;
+	SlicProfileSlot* slot = Claim(ticket);
+	if (slot == NULL) return;
+	slot->kind = kSLICProfileMessage;
+	slot->name = "log";
+	slot->time = Now();
+	slot->duration = 0;
+	slot->value = -1;
+	size_t length = std::min(text.size(), sizeof(slot->text) - 1);
+	memcpy(slot->text, text.data(), length);
+	slot->text[length] = '\0';
+	Publish(slot, ticket);
+}
+
+// Reads the ring under configMutex
+static void CollectEvents(SlicProfileSlot* slots, std::vector<SLICProfileEvent>& events)
+{
+	events.clear();
+	unsigned long long end = head.load(std::memory_order_acquire);
+	unsigned long long begin = (end > kSlotCount) ? end - kSlotCount : 0;
+	for (unsigned long long ticket = begin; ticket < end; ticket++) {
+		const SlicProfileSlot& slot = slots[ticket & (kSlotCount - 1)];
+		unsigned long long sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence != 2 * ticket + 2) continue;
+		SLICProfileEvent event;
+		event.kind = slot.kind;
+		event.thread = slot.thread;
+		event.name = slot.name;
+		event.time = slot.time;
+		event.duration = slot.duration;
+		event.value = slot.value;
+		if (event.kind == kSLICProfileMessage) event.text.assign(slot.text, strnlen(slot.text, sizeof(slot.text)));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+		events.push_back(event);
+	}
+}
+
+void SLICProfiler::Collect(std::vector<SLICProfileEvent>& events)
+{
+	std::lock_guard<std::mutex> lock(configMutex);
+	SlicProfileSlot* slots = ring.load(std::memory_order_acquire);
+	if (slots == NULL) events.clear();
+	else CollectEvents(slots, events);
+}
+
+bool SLICProfiler::Dump()
+{
+	std::lock_guard<std::mutex> lock(configMutex);
+	SlicProfileSlot* slots = ring.load(std::memory_order_acquire);
+	if (!Enabled() || slots == NULL || dumpPath.empty()) return false;
+	std::vector<SLICProfileEvent> events;
+	CollectEvents(slots, events);
+	FILE* file = fopen(dumpPath.c_str(), "wb");
+	if (file == NULL) return false;
+
+	// Timestamps are written relative to the oldest event, in microseconds. Phases are recorded
+	// when they end, so the oldest start is not necessarily the first event.
+	long long origin = 0;
+	for (size_t i = 0; i < events.size(); i++) {
+		if (i == 0 || events[i].time < origin) origin = events[i].time;
+	}
+	fprintf(file, "{\"traceEvents\":[\n");
+	for (size_t i = 0; i < events.size(); i++) {
+		const SLICProfileEvent& event = events[i];
+		double ts = (double)(event.time - origin) / 1000.0;
+		if (i > 0) fprintf(file, ",\n");
+		fprintf(file, "{\"name\":");
+		WriteJsonString(file, event.name);
+		if (event.kind == kSLICProfilePhase) {
+			fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d", ts, (double)event.duration / 1000.0, event.thread);
+			if (event.value >= 0) fprintf(file, ",\"args\":{\"n\":%lld}", event.value);
+		} else if (event.kind == kSLICProfileCounter) {
+			fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%lld}", ts, event.thread, event.value);
+		} else {
+			fprintf(file, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"text\":", ts, event.thread);
+			WriteJsonString(file, event.text.c_str());
+			fprintf(file, "}");
+		}
+		fprintf(file, "}");
+	}
+	fprintf(file, "\n]}\n");
+	bool ok = (ferror(file) == 0);
+	if (fclose(file) != 0) ok = false;
+	return ok;
+}
+
+void SLICProfiler::Clear()
+{
+	std::lock_guard<std::mutex> lock(configMutex);
+	SlicProfileSlot* slots = ring.load(std::memory_order_acquire);
+	if (slots == NULL) return;
+	for (unsigned long long i = 0; i < kSlotCount; i++) slots[i].sequence.store(0, std::memory_order_relaxed);
+}
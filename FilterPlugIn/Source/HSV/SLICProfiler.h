@@ -0,0 +1,76 @@
+//! SLIC profiler
+//! Flight recorder for phase timings, counters and log messages. Events go into a fixed lock
+//! free ring buffer (the oldest are overwritten) and are only written out by Dump(), so recording
+//! costs a timestamp and a few stores and stays compiled in. Off by default; the environment
+//! variable SLIC_PROFILE=<path> switches it on and sets the dump path.
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+enum SLICProfileEventKind
+{
+	kSLICProfilePhase = 0,
+	kSLICProfileCounter,
+	kSLICProfileMessage
+};
+
+struct SLICProfileEvent
+{
+	SLICProfileEventKind kind;
+	int thread; // 1 based, in order of the first event of each thread
+	const char* name;
+	long long time; // ns, Now() clock; phase start
+	long long duration; // ns, phases only
+	long long value; // phase arg (< 0 = none) or counter value
+	std::string text; // messages only
+};
+
+class SLICProfiler {
+public:
+	// Cheap enough to test before every event
+	static bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+	// The ring buffer is allocated on the first enable and kept until exit
+	static void SetEnabled(bool on);
+	static void SetDumpPath(const std::string& path);
+	static std::string DumpPath();
+	// Applies SLIC_PROFILE; returns Enabled()
+	static bool ConfigureFromEnvironment();
+
+	// Monotonic nanoseconds
+	static long long Now();
+	// name must be a string literal (only the pointer is stored); arg < 0 = none
+	static void Phase(const char* name, long long startNs, long long endNs, long long arg);
+	static void Counter(const char* name, long long value);
+	// Copied, truncated to the slot size
+	static void Message(const std::string& text);
+
+	// Copies the events still in the ring, oldest first (in-process consumers such as slic_bench)
+	static void Collect(std::vector<SLICProfileEvent>& events);
+	// Writes the events still in the ring as Chrome trace JSON (chrome://tracing, Perfetto) to
+	// the dump path, replacing the file. Call while no processing is running. False when
+	// disabled, no path is set or the file cannot be written.
+	static bool Dump();
+	// Drops every recorded event
+	static void Clear();
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+// Records the enclosing block as a phase
+class SLICProfileScope {
+public:
+	explicit SLICProfileScope(const char* name, long long arg = -1)
+		: name(name), arg(arg), start(SLICProfiler::Enabled() ? SLICProfiler::Now() : -1) {}
+	~SLICProfileScope() { if (start >= 0) SLICProfiler::Phase(name, start, SLICProfiler::Now(), arg); }
+
+private:
+	SLICProfileScope(const SLICProfileScope&);
+	SLICProfileScope& operator=(const SLICProfileScope&);
+	const char* name;
+	long long arg;
+	long long start;
+};
@@ -0,0 +1,435 @@
+//! Streaming SLIC
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICStream.h"
+#include "SLICProfiler.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+int SLICStreamProcessor::BandRows(int step)
+{
+	if (step < 2) step = 2;
+	int reductionRows = SLICReductionRows(step);
+	return reductionRows * std::max(1, 256 / reductionRows);
+}
+
+size_t SLICStreamProcessor::EstimateMemory(int w, int h, int step, SLICPixelFormat format)
+{
+	if (step < 2) step = 2;
+	int bandRows = BandRows(step);
+	size_t clusterCount = (size_t)((w + step - 1) / step) * (size_t)((h + step - 1) / step);
+	size_t planes = SLICPixelIsGray(format) ? 1 : 3;
+	size_t bytes = (size_t)w * bandRows * (planes * sizeof(float) + sizeof(float) + sizeof(int));
+	// Clusters (current and assigned), sums, palette, band buckets, leftover grid
+	bytes += clusterCount * (2 * sizeof(SlicCluster) + 2 * sizeof(SlicAccumulator) + 4 + 6 * sizeof(int));
+	// Color converter caches
+	bytes += (size_t)(bandRows / SLICReductionRows(step)) * 4096 * 32;
+	return bytes;
+}
+
+// Reads and converts rows [y0, y1) into the band planes and clears their assignment
+bool SLICStreamProcessor::LoadBand(int y0, int y1)
+{
+	int rowBytes = 0;
+	bandSource = io->readRows(io->data, y0, y1 - y0, &rowBytes);
+	if (bandSource == NULL) return false;
+	bandSourceRowBytes = rowBytes;
+
+	SLICProfileScope profile("lab conversion", y0);
+	SLICDispatchPixelFormat(pixelFormat, [&](auto layout) { ConvertBand<decltype(layout)>(y0, y1); });
+	return true;
+}
+
+// Gray layouts fill the L plane only, from the gray level table
+template <class Layout>
+void SLICStreamProcessor::ConvertBand(int y0, int y1)
+{
+	int reductionRows = SLICReductionRows(seedStep);
+	int subBands = (y1 - y0 + reductionRows - 1) / reductionRows;
+	auto convertRows = [&](int sub) {
+		SLICColorConverter& converter = converters[sub];
+		int row1 = std::min(y1 - y0, (sub + 1) * reductionRows);
+		for (int row = sub * reductionRows; row < row1; row++) {
+			const BYTE* srcRow = bandSource + (size_t)row * bandSourceRowBytes;
+			size_t idx = (size_t)row * width;
+			for (int x = 0; x < width; x++, idx++) {
+				const BYTE* px = srcRow + (size_t)x * Layout::bytes;
+				bool opaque = true;
+				if constexpr (Layout::alpha >= 0) opaque = (px[Layout::alpha] != 0);
+				double l, a, b;
+				if constexpr (Layout::gray) {
+					l = grayL[px[0]];
+				} else {
+					converter.RGBToLab(px[Layout::r], px[Layout::g], px[Layout::b], l, a, b);
+					planeA[idx] = (float)a;
+					planeB[idx] = (float)b;
+				}
+				planeL[idx] = opaque ? (float)l : std::numeric_limits<float>::quiet_NaN();
+				distances[idx] = std::numeric_limits<float>::max();
+				labels[idx] = -1;
+			}
+		}
+	};
+	if (threadPool != NULL && subBands > 1) threadPool->ParallelFor(subBands, convertRows);
+	else for (int sub = 0; sub < subBands; sub++) convertRows(sub);
+}
+
+// Runs the row kernel for every cluster whose window reaches into the band, clipped to it. The
+// clusters are bucketed into 2S wide column tiles; tiles of the same parity are at least 2S
+// apart, so their windows never share a pixel and the two phases run in parallel.
+// The host may be polled between clusters (no progress); false when it asked to stop.
+bool SLICStreamProcessor::AssignBand(int y0, int y1, int ns, float spatialWeight, const std::vector<SlicCluster>& centers, SLICCheckpoint& checkpoint)
+{
+	bool gray = SLICPixelIsGray(pixelFormat);
+	SLICAssignRowProc assignRow = SLICGetAssignRowProc(isa, gray);
+	int clusterCount = (int)centers.size();
+
+	bandClusters.clear();
+	for (int k = 0; k < clusterCount; k++) {
+		int cy = (int)centers[k].y;
+		if (std::max(0, cy - ns) < y1 && std::min(height, cy + ns) > y0) bandClusters.push_back(k);
+	}
+
+	auto assignCluster = [&](int k) {
+		const SlicCluster& center = centers[k];
+		int cx = (int)center.x;
+		int cy = (int)center.y;
+		SLICAssignCluster c = { (float)center.l, (float)center.a, (float)center.b, (float)center.x, (float)center.y, spatialWeight, k };
+
+		int startX = std::max<int>(0, cx - ns);
+		int endX = std::min<int>(width, cx + ns);
+		int startY = std::max<int>(y0, cy - ns);
+		int endY = std::min<int>(y1, cy + ns);
+		if (startX >= endX) return;
+
+		for (int y = startY; y < endY; y++) {
+			size_t idx = (size_t)(y - y0) * width + startX;
+			float dy = (float)y - c.y;
+			assignRow(&planeL[idx], gray ? NULL : &planeA[idx], gray ? NULL : &planeB[idx], &distances[idx], &labels[idx], startX, endX - startX, (spatialWeight * dy) * dy, c);
+		}
+	};
+
+	if (threadPool == NULL || threadPool->ThreadCount() <= 1) {
+		for (size_t i = 0; i < bandClusters.size(); i++) {
+			assignCluster(bandClusters[i]);
+			if (!checkpoint.Step(0)) return false;
+		}
+		return true;
+	}
+
+	int tileSize = 2 * ns;
+	int tilesX = (width + tileSize - 1) / tileSize;
+	tileStart.assign(tilesX + 1, 0);
+	for (size_t i = 0; i < bandClusters.size(); i++) {
+		int tx = std::min(tilesX - 1, std::max(0, (int)centers[bandClusters[i]].x / tileSize));
+		tileStart[tx + 1]++;
+	}
+	for (int t = 0; t < tilesX; t++) tileStart[t + 1] += tileStart[t];
+	tileClusters.resize(bandClusters.size());
+	tileFill.assign(tileStart.begin(), tileStart.end() - 1);
+	for (size_t i = 0; i < bandClusters.size(); i++) {
+		int k = bandClusters[i];
+		int tx = std::min(tilesX - 1, std::max(0, (int)centers[k].x / tileSize));
+		tileClusters[tileFill[tx]++] = k;
+	}
+
+	for (int phase = 0; phase < 2; phase++) {
+		phaseTiles.clear();
+		for (int tx = phase; tx < tilesX; tx += 2) {
+			if (tileStart[tx] != tileStart[tx + 1]) phaseTiles.push_back(tx);
+		}
+		threadPool->ParallelFor((int)phaseTiles.size(), [&](int index) {
+			int t = phaseTiles[index];
+			for (int i = tileStart[t]; i < tileStart[t + 1]; i++) {
+				assignCluster(tileClusters[i]);
+				if (!checkpoint.Step(0)) return;
+			}
+		});
+		if (checkpoint.Stopped()) return false;
+	}
+	return true;
+}
+
+// Same reduction bands, label ranges and merge order as SLICProcessor::UpdateClusters, so a
+// cluster split across bands sums to the same value as in one piece
+void SLICStreamProcessor::AccumulateBand(int y0, int y1, int ns)
+{
+	int reductionRows = SLICReductionRows(ns);
+	int subBands = (y1 - y0 + reductionRows - 1) / reductionRows;
+	if ((int)reductionBands.size() < subBands) reductionBands.resize(subBands);
+	int clusterCount = (int)sums.size();
+
+	auto reduce = [&](auto isGray, int sub) {
+		constexpr bool Gray = decltype(isGray)::value;
+		int row0 = sub * reductionRows;
+		int row1 = std::min(y1 - y0, row0 + reductionRows);
+		const int* subLabels = labels.data() + (size_t)row0 * width;
+		size_t subPixels = (size_t)(row1 - row0) * width;
+
+		int kMin = clusterCount, kMax = -1;
+		for (size_t i = 0; i < subPixels; i++) {
+			int k = subLabels[i];
+			if (k < 0) continue;
+			kMin = std::min(kMin, k);
+			kMax = std::max(kMax, k);
+		}
+
+		SlicBandAccumulator& local = reductionBands[sub];
+		local.base = kMin;
+		SlicAccumulator zero = { 0.0, 0.0, 0.0, 0, 0, 0 };
+		local.sums.assign((kMax >= kMin) ? (size_t)(kMax - kMin + 1) : 0, zero);
+		for (int row = row0; row < row1 && kMax >= kMin; row++) {
+			size_t idx = (size_t)row * width;
+			for (int x = 0; x < width; x++, idx++) {
+				int k = labels[idx];
+				if (k < 0) continue;
+				SlicAccumulator& s = local.sums[k - kMin];
+				s.l += planeL[idx];
+				if constexpr (!Gray) {
+					s.a += planeA[idx];
+					s.b += planeB[idx];
+				}
+				s.x += x;
+				s.y += y0 + row;
+				s.count++;
+			}
+		}
+	};
+	auto reduceSub = [&](int sub) {
+		if (SLICPixelIsGray(pixelFormat)) reduce(std::true_type(), sub);
+		else                              reduce(std::false_type(), sub);
+	};
+	if (threadPool != NULL && subBands > 1) threadPool->ParallelFor(subBands, reduceSub);
+	else for (int sub = 0; sub < subBands; sub++) reduceSub(sub);
+
+	for (int sub = 0; sub < subBands; sub++) {
+		const SlicBandAccumulator& local = reductionBands[sub];
+		for (size_t j = 0; j < local.sums.size(); j++) {
+			SlicAccumulator& dst = sums[local.base + j];
+			const SlicAccumulator& src = local.sums[j];
+			dst.l += src.l;
+			dst.a += src.a;
+			dst.b += src.b;
+			dst.x += src.x;
+			dst.y += src.y;
+			dst.count += src.count;
+		}
+	}
+}
+
+// Labels the opaque pixels of the band no window reached, as SLICProcessor::LabelLeftovers does
+// with the whole image; returns the opaque pixels still without a label (only without clusters)
+long long SLICStreamProcessor::LabelBandLeftovers(int y0, int y1, double spatialWeight)
+{
+	bool gray = SLICPixelIsGray(pixelFormat);
+	const int rowsPerTask = 64;
+	int rows = y1 - y0;
+	int tasks = (rows + rowsPerTask - 1) / rowsPerTask;
+	taskUnlabeled.assign(tasks, 0);
+	auto labelTask = [&](int task) {
+		int row1 = std::min(rows, (task + 1) * rowsPerTask);
+		for (int row = task * rowsPerTask; row < row1; row++) {
+			size_t idx = (size_t)row * width;
+			for (int x = 0; x < width; x++, idx++) {
+				if (labels[idx] >= 0 || std::isnan(planeL[idx])) continue;
+				SlicColor color = { planeL[idx], gray ? 0.0f : planeA[idx], gray ? 0.0f : planeB[idx] };
+				labels[idx] = leftoverGrid.Nearest(clusters, x, y0 + row, color, spatialWeight);
+				if (labels[idx] < 0) taskUnlabeled[task]++;
+			}
+		}
+	};
+	if (threadPool != NULL && tasks > 1) threadPool->ParallelFor(tasks, labelTask);
+	else for (int task = 0; task < tasks; task++) labelTask(task);
+	long long unlabeled = 0;
+	for (int task = 0; task < tasks; task++) unlabeled += taskUnlabeled[task];
+	return unlabeled;
+}
+
+// Same pixel rules as SLICProcessor::Render
+template <class Layout>
+void SLICStreamProcessor::RenderBand(int y0, int y1, BYTE* dst, int dstRowBytes) const
+{
+	int clusterCount = (int)palette.size() / 4;
+	auto renderRows = [&](int row0, int row1) {
+		for (int row = row0; row < row1; row++) {
+			const int* labelRow = &labels[(size_t)row * width];
+			const BYTE* srcRow = bandSource + (size_t)row * bandSourceRowBytes;
+			BYTE* dstRow = dst + (size_t)row * dstRowBytes;
+			for (int x = 0; x < width; x++) {
+				int k = labelRow[x];
+				const BYTE* px = srcRow + x * Layout::bytes;
+				BYTE* out = dstRow + x * Layout::bytes;
+				if (k >= 0 && k < clusterCount) {
+					const BYTE* color = &palette[(size_t)k * 4];
+					if constexpr (Layout::gray) {
+						out[0] = color[1];
+					} else {
+						out[Layout::r] = color[0];
+						out[Layout::g] = color[1];
+						out[Layout::b] = color[2];
+					}
+				} else {
+					for (int c = 0; c < Layout::bytes; c++) out[c] = px[c];
+				}
+				if constexpr (Layout::alpha >= 0) out[Layout::alpha] = px[Layout::alpha];
+			}
+		}
+	};
+
+	const int renderRowsPerTask = 64;
+	int rows = y1 - y0;
+	int tasks = (rows + renderRowsPerTask - 1) / renderRowsPerTask;
+	auto renderTask = [&](int task) { renderRows(task * renderRowsPerTask, std::min(rows, (task + 1) * renderRowsPerTask)); };
+	if (threadPool != NULL && tasks > 1) threadPool->ParallelFor(tasks, renderTask);
+	else for (int task = 0; task < tasks; task++) renderTask(task);
+}
+
+// Same grid and transparent search as SLICProcessor::SeedGrid; each grid row reads the rows its
+// search window covers
+template <class Layout>
+bool SLICStreamProcessor::SeedGrid(int step)
+{
+	SLICProfileScope profile("seed");
+	clusters.clear();
+	SLICColorConverter& converter = converters[0];
+	int searchRange = step / 2;
+	for (int y = step / 2; y < height; y += step) {
+		int startY = std::max<int>(0, y - searchRange);
+		int endY = std::min<int>(height, y + searchRange);
+		int rowBytes = 0;
+		const BYTE* rows = io->readRows(io->data, startY, endY - startY, &rowBytes);
+		if (rows == NULL) return false;
+		auto alphaAt = [&](int px, int py) -> BYTE {
+			if constexpr (Layout::alpha < 0) return 255;
+			else return rows[(size_t)(py - startY) * rowBytes + (size_t)px * Layout::bytes + Layout::alpha];
+		};
+
+		for (int x = step / 2; x < width; x += step) {
+			int cx = x;
+			int cy = y;
+			if (alphaAt(cx, cy) == 0) {
+				bool found = false;
+				int startX = std::max<int>(0, x - searchRange);
+				int endX = std::min<int>(width, x + searchRange);
+				for (int ny = startY; ny < endY && !found; ny++) {
+					for (int nx = startX; nx < endX; nx++) {
+						if (alphaAt(nx, ny) != 0) {
+							cx = nx;
+							cy = ny;
+							found = true;
+							break;
+						}
+					}
+				}
+				if (!found) continue;
+			}
+
+			const BYTE* px = rows + (size_t)(cy - startY) * rowBytes + (size_t)cx * Layout::bytes;
+			double l, a = 0.0, b = 0.0;
+			if constexpr (Layout::gray) l = grayL[px[0]];
+			else converter.RGBToLab(px[Layout::r], px[Layout::g], px[Layout::b], l, a, b);
+			// Rounded through float like the in-core planes
+			clusters.push_back({ (double)(float)l, (double)(float)a, (double)(float)b, (double)cx, (double)cy, 0 });
+		}
+	}
+	return true;
+}
+
+SLICResult SLICStreamProcessor::Execute(int w, int h, int step, double m, const SLICStreamIO* pIO, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit)
+{
+	if (step < 2) step = 2; // min step
+	width = w;
+	height = h;
+	io = pIO;
+	seedStep = step;
+	int ns = step;
+	int bandRows = BandRows(step);
+	size_t bandPixels = (size_t)w * bandRows;
+	bool gray = SLICPixelIsGray(pixelFormat);
+	planeL.resize(bandPixels);
+	planeA.resize(gray ? 0 : bandPixels);
+	planeB.resize(gray ? 0 : bandPixels);
+	distances.resize(bandPixels);
+	labels.resize(bandPixels);
+	converters.assign(bandRows / SLICReductionRows(ns), SLICColorConverter(colorMode));
+	if (gray) {
+		for (int v = 0; v < 256; v++) {
+			double a, b;
+			converters[0].RGBToLab((BYTE)v, (BYTE)v, (BYTE)v, grayL[v], a, b);
+		}
+	}
+	float spatialWeight = (float)(m * m / (ns * ns));
+	iterationsRun = 0;
+	lastResidual = 0.0;
+	unlabeledPixels = 0;
+
+	// Every pass is one span of progress stepped per band
+	SLICCheckpoint checkpoint(callbacks, pCurrentProgress);
+	int bandCount = (h + bandRows - 1) / bandRows;
+
+	// 1. Initialize Centers
+	if (!checkpoint.Poll()) return checkpoint.Result();
+	checkpoint.Begin(progressUnit, 1);
+	bool seeded = false;
+	SLICDispatchPixelFormat(pixelFormat, [&](auto layout) { seeded = SeedGrid<decltype(layout)>(step); });
+	if (!seeded) return kSLICResultFailed;
+	checkpoint.End();
+
+	// 2. Iterations, one read of the image each
+	for (int iter = 0; iter < maxIterations; iter++) {
+		if (!checkpoint.Poll()) return checkpoint.Result();
+		checkpoint.Begin(progressUnit, bandCount);
+		assignedCenters = clusters;
+		SlicAccumulator zero = { 0.0, 0.0, 0.0, 0, 0, 0 };
+		sums.assign(clusters.size(), zero);
+		for (int y0 = 0; y0 < h; y0 += bandRows) {
+			int y1 = std::min(h, y0 + bandRows);
+			if (!LoadBand(y0, y1)) return kSLICResultFailed;
+			{
+				SLICProfileScope profile("assign", iter);
+				if (!AssignBand(y0, y1, ns, spatialWeight, assignedCenters, checkpoint)) return checkpoint.Result();
+			}
+			SLICProfileScope profile("update", iter);
+			AccumulateBand(y0, y1, ns);
+			if (!checkpoint.Step()) return checkpoint.Result();
+		}
+		checkpoint.End();
+		lastResidual = SLICApplyClusterSums(clusters, sums, m * m / (ns * ns));
+		iterationsRun = iter + 1;
+		if (convergenceThreshold > 0.0 && lastResidual < convergenceThreshold) {
+			break;
+		}
+	}
+	// Skip the progress of iterations saved by early termination
+	if (pCurrentProgress) *pCurrentProgress += (maxIterations - iterationsRun) * progressUnit;
+
+	// 3. Render Output: labels of the last pass with the updated colors, as in-core; the pixels
+	// the pass does not reach take the nearest updated center
+	if (!checkpoint.Poll()) return checkpoint.Result();
+	checkpoint.Begin(progressUnit, bandCount);
+	SLICBuildPalette(clusters, colorMode, palette);
+	leftoverGrid.Build(clusters, w, h, step);
+	for (int y0 = 0; y0 < h; y0 += bandRows) {
+		if (y0 > 0 && !checkpoint.Step()) return checkpoint.Result();
+		int y1 = std::min(h, y0 + bandRows);
+		if (!LoadBand(y0, y1)) return kSLICResultFailed;
+		{
+			SLICProfileScope profile("assign", maxIterations);
+			if (!AssignBand(y0, y1, ns, spatialWeight, assignedCenters, checkpoint)) return checkpoint.Result();
+		}
+		unlabeledPixels += LabelBandLeftovers(y0, y1, m * m / ((double)step * step));
+		if (io->labelRows != NULL) io->labelRows(io->data, y0, y1 - y0, labels.data());
+
+		int dstRowBytes = 0;
+		BYTE* dst = io->beginWriteRows(io->data, y0, y1 - y0, &dstRowBytes);
+		if (dst == NULL) return kSLICResultFailed;
+		{
+			SLICProfileScope profile("render", y0);
+			SLICDispatchPixelFormat(pixelFormat, [&](auto layout) { RenderBand<decltype(layout)>(y0, y1, dst, dstRowBytes); });
+		}
+		if (!io->endWriteRows(io->data, y0, y1 - y0)) return kSLICResultFailed;
+	}
+	checkpoint.End();
+	return kSLICResultContinue;
+}
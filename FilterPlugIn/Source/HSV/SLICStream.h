@@ -0,0 +1,88 @@
+//! Streaming SLIC
+//! Out-of-core variant of the float kernel. The image is pulled through the host in horizontal
+//! bands on every pass and only the cluster state covers the whole image, so memory depends on
+//! the width and the band height, not on the image height.
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#pragma once
+
+#include "SLICCore.h"
+
+// Band access supplied by the caller. Rows are counted from the top of the processed image.
+struct SLICStreamIO
+{
+	void* data;
+	// Returns rows [y, y + rows) of the source (pixelFormat), valid until the next call; NULL on failure
+	const BYTE* (*readRows)(void* data, int y, int rows, int* pRowBytes);
+	// Returns the memory rows [y, y + rows) of the result (pixelFormat) are rendered into; NULL on failure
+	BYTE* (*beginWriteRows)(void* data, int y, int rows, int* pRowBytes);
+	// Called once the rows from beginWriteRows are filled
+	bool (*endWriteRows)(void* data, int y, int rows);
+	// Optional (NULL to skip): the final labels of rows [y, y + rows), width per row (-1 = transparent),
+	// valid during the call, before the rows are rendered
+	void (*labelRows)(void* data, int y, int rows, const int* labels);
+};
+
+// Every pass reads the image band by band: seeding, one pass per iteration and a final pass that
+// renders each band and hands it to endWriteRows. A band only sees the clusters whose 2S window
+// reaches into it; clusters that straddle a band boundary collect their sums from both bands,
+// merged in the same order as the in-core update. Opaque pixels no window reaches in the final
+// pass take the nearest cluster of SLICLeftoverGrid, as in-core. The result equals the in-core
+// float kernel with assign=clusters, except that a pixel no window reaches in an earlier
+// iteration drops out of that iteration's sums instead of keeping its label from the one before.
+class SLICStreamProcessor {
+public:
+	int width, height;
+	std::vector<SlicCluster> clusters;
+
+	SLICColorMode colorMode;
+	SLICIsa isa;
+	SLICThreadPool* threadPool; // Not owned; NULL runs single threaded
+	SLICPixelFormat pixelFormat; // of the rows the IO reads and writes; gray keeps only the L plane
+	int maxIterations;
+	double convergenceThreshold;
+
+	// Results of the last Execute
+	int iterationsRun;
+	double lastResidual;
+	long long unlabeledPixels; // opaque pixels rendered without a label; 0 after every complete run
+
+	SLICStreamProcessor() : width(0), height(0), colorMode(kSLICColorFast), isa(kSLICIsaAuto), threadPool(NULL), pixelFormat(kSLICPixelRGBA),
+		maxIterations(10), convergenceThreshold(0.0), iterationsRun(0), lastResidual(0.0), unlabeledPixels(0), io(NULL), seedStep(2) {}
+
+	// Rows per band; a multiple of the update reduction rows, at least 2S
+	static int BandRows(int step);
+	// Bytes held for a w x h image (band planes and cluster state, not the caller's band buffers)
+	static size_t EstimateMemory(int w, int h, int step, SLICPixelFormat format);
+
+	// Seeding (1 unit) + one unit per iteration + rendering (1 unit), kSLICProgressSteps each
+	int ProgressTotal() const { return (maxIterations + 2) * kSLICProgressSteps; }
+
+	// Same parameters and progress layout as SLICProcessor::Execute. Progress moves per band; the
+	// host is polled at the start of every pass and at least every kSLICPollIntervalMs inside it. Returns kSLICResultFailed when a read or write callback fails.
+	SLICResult Execute(int w, int h, int step, double m, const SLICStreamIO* pIO, const SLICCallbacks* callbacks, int* pCurrentProgress, int progressUnit);
+
+private:
+	bool LoadBand(int y0, int y1);
+	template <class Layout> void ConvertBand(int y0, int y1);
+	bool AssignBand(int y0, int y1, int ns, float spatialWeight, const std::vector<SlicCluster>& centers, SLICCheckpoint& checkpoint);
+	void AccumulateBand(int y0, int y1, int ns);
+	long long LabelBandLeftovers(int y0, int y1, double spatialWeight);
+	template <class Layout> void RenderBand(int y0, int y1, BYTE* dst, int dstRowBytes) const;
+	template <class Layout> bool SeedGrid(int step);
+
+	const SLICStreamIO* io;
+	int seedStep;
+	const BYTE* bandSource;
+	int bandSourceRowBytes;
+	SLICFloatPlane planeL, planeA, planeB, distances; // band sized, L is NaN for transparent pixels; no A and B when gray
+	double grayL[256]; // L of the gray levels, for gray formats
+	SLICIntPlane labels;
+	std::vector<SLICColorConverter> converters; // one per reduction band of a band
+	std::vector<SlicBandAccumulator> reductionBands;
+	std::vector<SlicAccumulator> sums;
+	std::vector<SlicCluster> assignedCenters; // centers the last pass assigned with
+	std::vector<BYTE> palette;
+	SLICLeftoverGrid leftoverGrid; // of the final centers, for the render pass
+	std::vector<long long> taskUnlabeled;
+	std::vector<int> bandClusters, tileStart, tileFill, tileClusters, phaseTiles;
+};
@@ -0,0 +1,106 @@
+//! Persistent worker pool for the SLIC processor
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICThreadPool.h"
+
+SLICThreadPool::SLICThreadPool(int threadCount)
+	: pTask(NULL), taskCount(0), nextIndex(0), finishedWorkers(0), generation(0), quit(false)
+{
+	Start(threadCount);
+}
+
+SLICThreadPool::~SLICThreadPool()
+{
+	Stop();
+}
+
+int SLICThreadPool::DefaultThreadCount()
+{
+	unsigned int n = std::thread::hardware_concurrency();
+	return (n == 0) ? 1 : (int)n;
+}
+
+void SLICThreadPool::SetThreadCount(int threadCount)
+{
+	if (threadCount <= 0) threadCount = DefaultThreadCount();
+	if (threadCount == ThreadCount()) return;
+	Stop();
+	Start(threadCount);
+}
+
+void SLICThreadPool::Start(int threadCount)
+{
+	if (threadCount <= 0) threadCount = DefaultThreadCount();
+	quit = false;
+	for (int i = 1; i < threadCount; i++) {
+		workers.push_back(std::thread(&SLICThreadPool::WorkerMain, this, generation, i));
+	}
+}
+
+void SLICThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+	workers.clear();
+}
+
+void SLICThreadPool::RunTasks(int worker)
+{
+	for (;;) {
+		int index = nextIndex.fetch_add(1);
+		if (index >= taskCount) break;
+		(*pTask)(index, worker);
+	}
+}
+
+// Every worker checks in for every job, so a job's state is never reset while a late
+// worker could still read it.
+void SLICThreadPool::WorkerMain(unsigned int seen, int worker)
+{
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+		}
+		RunTasks(worker);
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			last = (++finishedWorkers == (int)workers.size());
+		}
+		if (last) done.notify_one();
+	}
+}
+
+void SLICThreadPool::ParallelFor(int count, const std::function<void(int)>& task)
+{
+	ParallelForWorkers(count, [&](int index, int) { task(index); });
+}
+
+void SLICThreadPool::ParallelForWorkers(int count, const std::function<void(int, int)>& task)
+{
+	if (count <= 0) return;
+	if (workers.empty() || count == 1) {
+		for (int i = 0; i < count; i++) task(i, 0);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pTask = &task;
+		taskCount = count;
+		nextIndex.store(0);
+		finishedWorkers = 0;
+		generation++;
+	}
+	wake.notify_all();
+	RunTasks(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [&] { return finishedWorkers == (int)workers.size(); });
+	pTask = NULL;
+}
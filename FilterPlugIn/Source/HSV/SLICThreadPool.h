@@ -0,0 +1,49 @@
+//! Persistent worker pool for the SLIC processor
+//! Workers are created once and sleep between jobs, so FilterRun calls and restarts do not
+//! pay thread creation. The calling thread takes part in every job.
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+class SLICThreadPool {
+public:
+	// threadCount counts the caller; 0 = std::thread::hardware_concurrency()
+	explicit SLICThreadPool(int threadCount = 0);
+	~SLICThreadPool();
+
+	int ThreadCount() const { return (int)workers.size() + 1; }
+	// Joins and respawns the workers when the count changes
+	void SetThreadCount(int threadCount);
+
+	// Runs task(index) for every index in [0, count) and returns when all are done.
+	// Indices are handed out dynamically; task must be safe to run concurrently.
+	void ParallelFor(int count, const std::function<void(int)>& task);
+	// Same, with the thread running the task as worker in [0, ThreadCount()), 0 = the caller;
+	// tasks with the same worker never run at the same time
+	void ParallelForWorkers(int count, const std::function<void(int index, int worker)>& task);
+
+	static int DefaultThreadCount();
+
+private:
+	void Start(int threadCount);
+	void Stop();
+	void WorkerMain(unsigned int seen, int worker);
+	void RunTasks(int worker);
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(int, int)>* pTask;
+	int taskCount;
+	std::atomic<int> nextIndex;
+	int finishedWorkers;
+	unsigned int generation;
+	bool quit;
+};
@@ -0,0 +1,288 @@
+//! Minimal image I/O for the SLIC command line tools
+#include "SLICImageIO.h"
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+#if SLIC_HAVE_PNG
+#include <png.h>
+#endif
+
+static std::string LowerExtension(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos) return std::string();
+	std::string ext = path.substr(dot + 1);
+	for (size_t i = 0; i < ext.size(); i++) ext[i] = (char)std::tolower((unsigned char)ext[i]);
+	return ext;
+}
+
+// --- PNM (P6 / P7) ---
+
+// Reads the next whitespace separated header token, skipping '#' comments
+static bool ReadToken(FILE* fp, std::string& token)
+{
+	token.clear();
+	int c = fgetc(fp);
+	while (c != EOF) {
+		if (c == '#') {
+			while (c != EOF && c != '\n') c = fgetc(fp);
+		} else if (!std::isspace(c)) {
+			break;
+		}
+		c = fgetc(fp);
+	}
+	while (c != EOF && !std::isspace(c)) {
+		token.push_back((char)c);
+		c = fgetc(fp);
+	}
+	return !token.empty();
+}
+
+static bool LoadPNM(const std::string& path, SLICImage& image, std::string& error)
+{
+	FILE* fp = fopen(path.c_str(), "rb");
+	if (fp == NULL) { error = "cannot open " + path; return false; }
+
+	std::string magic;
+	ReadToken(fp, magic);
+	int width = 0, height = 0, maxVal = 0, depth = 0;
+	bool ok = true;
+
+	if (magic == "P6") {
+		std::string tw, th, tm;
+		ok = ReadToken(fp, tw) && ReadToken(fp, th) && ReadToken(fp, tm);
+		if (ok) { width = atoi(tw.c_str()); height = atoi(th.c_str()); maxVal = atoi(tm.c_str()); depth = 3; }
+	} else if (magic == "P7") {
+		std::string key, value;
+		while (ok && ReadToken(fp, key) && key != "ENDHDR") {
+			ok = ReadToken(fp, value);
+			if (key == "WIDTH") width = atoi(value.c_str());
+			else if (key == "HEIGHT") height = atoi(value.c_str());
+			else if (key == "DEPTH") depth = atoi(value.c_str());
+			else if (key == "MAXVAL") maxVal = atoi(value.c_str());
+		}
+	} else {
+		ok = false;
+	}
+
+	if (!ok || width <= 0 || height <= 0 || maxVal != 255 || (depth != 3 && depth != 4)) {
+		fclose(fp);
+		error = "unsupported PNM header in " + path + " (need 8bit P6 or P7 RGB/RGB_ALPHA)";
+		return false;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.rgba.resize((size_t)width * height * 4);
+	std::vector<BYTE> row((size_t)width * depth);
+	for (int y = 0; y < height && ok; y++) {
+		if (fread(row.data(), 1, row.size(), fp) != row.size()) { ok = false; break; }
+		BYTE* dst = image.rgba.data() + (size_t)y * image.RowBytes();
+		for (int x = 0; x < width; x++) {
+			dst[x * 4 + 0] = row[x * depth + 0];
+			dst[x * 4 + 1] = row[x * depth + 1];
+			dst[x * 4 + 2] = row[x * depth + 2];
+			dst[x * 4 + 3] = (depth == 4) ? row[x * depth + 3] : 255;
+		}
+	}
+	fclose(fp);
+	if (!ok) error = "truncated pixel data in " + path;
+	return ok;
+}
+
+static bool SavePNM(const std::string& path, const SLICImage& image, bool withAlpha, std::string& error)
+{
+	FILE* fp = fopen(path.c_str(), "wb");
+	if (fp == NULL) { error = "cannot create " + path; return false; }
+
+	int depth = withAlpha ? 4 : 3;
+	if (withAlpha) {
+		fprintf(fp, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", image.width, image.height);
+	} else {
+		fprintf(fp, "P6\n%d %d\n255\n", image.width, image.height);
+	}
+
+	bool ok = true;
+	std::vector<BYTE> row((size_t)image.width * depth);
+	for (int y = 0; y < image.height && ok; y++) {
+		const BYTE* src = image.rgba.data() + (size_t)y * image.RowBytes();
+		for (int x = 0; x < image.width; x++) {
+			for (int c = 0; c < depth; c++) row[x * depth + c] = src[x * 4 + c];
+		}
+		ok = fwrite(row.data(), 1, row.size(), fp) == row.size();
+	}
+	if (fclose(fp) != 0) ok = false;
+	if (!ok) error = "write failed for " + path;
+	return ok;
+}
+
+// --- PNG ---
+
+#if SLIC_HAVE_PNG
+static bool LoadPNG(const std::string& path, SLICImage& image, std::string& error)
+{
+	png_image png;
+	memset(&png, 0, sizeof(png));
+	png.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_file(&png, path.c_str())) {
+		error = path + ": " + png.message;
+		return false;
+	}
+	png.format = PNG_FORMAT_RGBA;
+	image.width = (int)png.width;
+	image.height = (int)png.height;
+	image.rgba.resize(PNG_IMAGE_SIZE(png));
+	if (!png_image_finish_read(&png, NULL, image.rgba.data(), image.RowBytes(), NULL)) {
+		error = path + ": " + png.message;
+		png_image_free(&png);
+		return false;
+	}
+	return true;
+}
+
+static bool SavePNG(const std::string& path, const SLICImage& image, std::string& error)
+{
+	png_image png;
+	memset(&png, 0, sizeof(png));
+	png.version = PNG_IMAGE_VERSION;
+	png.width = (png_uint_32)image.width;
+	png.height = (png_uint_32)image.height;
+	png.format = PNG_FORMAT_RGBA;
+	if (!png_image_write_to_file(&png, path.c_str(), 0, image.rgba.data(), image.RowBytes(), NULL)) {
+		error = path + ": " + png.message;
+		return false;
+	}
+	return true;
+}
+#endif
+
+bool LoadImageFile(const std::string& path, SLICImage& image, std::string& error)
+{
+	std::string ext = LowerExtension(path);
+	if (ext == "ppm" || ext == "pam" || ext == "pnm") return LoadPNM(path, image, error);
+#if SLIC_HAVE_PNG
+	if (ext == "png") return LoadPNG(path, image, error);
+#endif
+	error = "unsupported input format: " + path;
+	return false;
+}
+
+bool SaveImageFile(const std::string& path, const SLICImage& image, std::string& error)
+{
+	std::string ext = LowerExtension(path);
+	if (ext == "ppm") return SavePNM(path, image, false, error);
+	if (ext == "pam") return SavePNM(path, image, true, error);
+#if SLIC_HAVE_PNG
+	if (ext == "png") return SavePNG(path, image, error);
+#endif
+	error = "unsupported output format: " + path;
+	return false;
+}
+
+// --- Pixel formats ---
+
+void PackPixels(const SLICImage& image, SLICPixelFormat format, std::vector<BYTE>& pixels)
+{
+	size_t count = (size_t)image.width * image.height;
+	pixels.resize(count * SLICPixelBytes(format));
+	SLICDispatchPixelFormat(format, [&](auto layout) {
+		typedef decltype(layout) Layout;
+		for (size_t i = 0; i < count; i++) {
+			const BYTE* src = &image.rgba[i * 4];
+			BYTE* dst = &pixels[i * Layout::bytes];
+			if constexpr (Layout::gray) {
+				dst[0] = (BYTE)((src[0] * 77 + src[1] * 150 + src[2] * 29 + 128) >> 8);
+			} else {
+				dst[Layout::r] = src[0];
+				dst[Layout::g] = src[1];
+				dst[Layout::b] = src[2];
+			}
+			if constexpr (Layout::alpha >= 0) dst[Layout::alpha] = src[3];
+		}
+	});
+}
+
+void UnpackPixels(const std::vector<BYTE>& pixels, SLICPixelFormat format, SLICImage& image)
+{
+	size_t count = (size_t)image.width * image.height;
+	image.rgba.resize(count * 4);
+	SLICDispatchPixelFormat(format, [&](auto layout) {
+		typedef decltype(layout) Layout;
+		for (size_t i = 0; i < count; i++) {
+			const BYTE* src = &pixels[i * Layout::bytes];
+			BYTE* dst = &image.rgba[i * 4];
+			dst[0] = src[Layout::r];
+			dst[1] = src[Layout::g];
+			dst[2] = src[Layout::b];
+			if constexpr (Layout::alpha >= 0) dst[3] = src[Layout::alpha];
+			else dst[3] = 255;
+		}
+	});
+}
+
+bool ParsePixelFormat(const std::string& name, SLICPixelFormat& format)
+{
+	if (name == "rgba") format = kSLICPixelRGBA;
+	else if (name == "bgra") format = kSLICPixelBGRA;
+	else if (name == "rgb") format = kSLICPixelRGB;
+	else if (name == "gray") format = kSLICPixelGrayAlpha;
+	else return false;
+	return true;
+}
+
+const char* PixelFormatName(SLICPixelFormat format)
+{
+	switch (format) {
+	case kSLICPixelBGRA: return "bgra";
+	case kSLICPixelRGB: return "rgb";
+	case kSLICPixelGrayAlpha: return "gray";
+	default: return "rgba";
+	}
+}
+
+bool ParseKernel(const std::string& name, SLICKernel& kernel)
+{
+	if (name == "reference") kernel = kSLICKernelReference;
+	else if (name == "float") kernel = kSLICKernelFloat;
+	else if (name == "compact") kernel = kSLICKernelCompact;
+	else if (name == "integer") kernel = kSLICKernelInteger;
+	else return false;
+	return true;
+}
+
+bool ParseEngine(const std::string& name, SLICEngine& engine)
+{
+	if (name == "slic") engine = kSLICEngineSLIC;
+	else if (name == "snic") engine = kSLICEngineSNIC;
+	else return false;
+	return true;
+}
+
+bool ParseAssignMode(const std::string& name, SLICAssignMode& mode)
+{
+	if (name == "clusters") mode = kSLICAssignClusters;
+	else if (name == "pixels") mode = kSLICAssignPixels;
+	else return false;
+	return true;
+}
+
+bool ParseIsa(const std::string& name, SLICIsa& isa)
+{
+	const SLICIsa all[] = { kSLICIsaAuto, kSLICIsaScalar, kSLICIsaSSE2, kSLICIsaAVX2, kSLICIsaAVX512 };
+	for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+		if (name == SLICIsaName(all[i])) { isa = all[i]; return true; }
+	}
+	return false;
+}
+
+const char* KernelName(SLICKernel kernel)
+{
+	switch (kernel) {
+	case kSLICKernelFloat: return "float";
+	case kSLICKernelCompact: return "compact";
+	case kSLICKernelInteger: return "integer";
+	default: return "reference";
+	}
+}
@@ -0,0 +1,36 @@
+//! Minimal image I/O for the SLIC command line tools
+//! Supports PNG (when built with libpng), binary PPM (P6) and PAM (P7, RGB / RGB_ALPHA).
+#pragma once
+
+#include "SLICCore.h"
+#include <string>
+#include <vector>
+
+// 8bit RGBA, tightly packed (rowBytes = width * 4)
+struct SLICImage
+{
+	int width;
+	int height;
+	std::vector<BYTE> rgba;
+
+	SLICImage() : width(0), height(0) {}
+	int RowBytes() const { return width * 4; }
+};
+
+// The format is chosen from the file extension (.png / .ppm / .pam).
+bool LoadImageFile(const std::string& path, SLICImage& image, std::string& error);
+bool SaveImageFile(const std::string& path, const SLICImage& image, std::string& error);
+
+// Repacks the image into format, tightly packed (gray takes the Rec. 601 luma of the color),
+// and back (gray fills R, G and B)
+void PackPixels(const SLICImage& image, SLICPixelFormat format, std::vector<BYTE>& pixels);
+void UnpackPixels(const std::vector<BYTE>& pixels, SLICPixelFormat format, SLICImage& image);
+bool ParsePixelFormat(const std::string& name, SLICPixelFormat& format);
+const char* PixelFormatName(SLICPixelFormat format);
+
+// Command line names of the processor options; the parsers leave the value untouched and return false on an unknown name
+bool ParseKernel(const std::string& name, SLICKernel& kernel);
+bool ParseEngine(const std::string& name, SLICEngine& engine);
+bool ParseAssignMode(const std::string& name, SLICAssignMode& mode);
+bool ParseIsa(const std::string& name, SLICIsa& isa);
+const char* KernelName(SLICKernel kernel);
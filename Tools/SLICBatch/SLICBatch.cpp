@@ -0,0 +1,346 @@
+//! SLIC batch driver
+//! Runs the host independent SLIC core over a list of images or the frames of an animation,
+//! e.g.
+//!   slic_batch --output-dir out --warm-start frames/*.png
+//! Decoding, Lab conversion, clustering and encoding run on their own threads with bounded
+//! queues between them, so the files and the color conversion of the next frames overlap the
+//! clustering of the current one; the pipeline is tuned for frames per second, not latency.
+//! With --warm-start every frame starts from the converged centers of the previous one, which
+//! needs fewer iterations and keeps the superpixels stable from frame to frame.
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICCore.h"
+#include "SLICImageIO.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: slic_batch [options] --output-dir DIR <input ...>\n"
+		"  input/output: .png, .ppm (P6) or .pam (P7 RGB_ALPHA); outputs keep the input file names\n"
+		"options:\n"
+		"  --output-dir DIR   directory the results are written to (must exist)\n"
+		"  --format EXT       write png, ppm or pam instead of the input's format\n"
+		"  --list FILE        read more inputs from FILE, one path per line\n"
+		"  --warm-start       start every frame from the previous frame's converged centers\n"
+		"                     (frames of one sequence, in order; a size change seeds the grid again)\n"
+		"  --queue N          frames buffered between two stages (default 2)\n"
+		"  --cell-size N      superpixel cell size in pixels (5-200, default 30)\n"
+		"  --compactness M    shape regularity (0.1-100, default 20)\n"
+		"  --exact-color      bit exact Lab conversion (default: fast tables)\n"
+		"  --engine E         slic (default, fastest) or snic (slower, always grows from the grid)\n"
+		"  --assign O         slic assignment order: clusters (default) or pixels\n"
+		"  --kernel K         float (default), integer, compact or reference\n"
+		"  --pixel F          layout the frames are processed in: rgba (default), bgra, rgb or gray\n"
+		"  --max-iterations N maximum clustering iterations (default 10)\n"
+		"  --convergence E    stop when the mean center movement drops below E (default 0.5, 0 = off)\n"
+		"  --active-threshold E  after the first iteration only reassign clusters near one that moved more than E (default 0 = all)\n"
+		"  --threads N        clustering worker threads, 0 = all cores (default)\n"
+		"  --quiet            do not print a line per frame\n");
+}
+
+// Blocking FIFO with a capacity. Pop() returns false once the queue is closed and drained.
+template <class T>
+class BatchQueue {
+public:
+	explicit BatchQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+	void Push(const T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [&] { return items.size() < capacity; });
+		items.push_back(item);
+		notEmpty.notify_one();
+	}
+
+	bool Pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [&] { return !items.empty() || closed; });
+		if (items.empty()) return false;
+		item = items.front();
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		notEmpty.notify_all();
+	}
+
+private:
+	size_t capacity;
+	bool closed;
+	std::deque<T> items;
+	std::mutex mutex;
+	std::condition_variable notEmpty, notFull;
+};
+
+struct BatchFrame
+{
+	int index;
+	std::string inputPath, outputPath;
+	SLICImage image; // size of the frame; the pixels are in packed between decode and encode
+	std::vector<BYTE> packed;
+	SLICProcessor* pProcessor; // between conversion and clustering
+	std::string error; // empty while the frame is fine
+	int iterations;
+	long long unlabeled; // opaque pixels the clustering left unlabeled, written as the source
+	bool warm;
+};
+
+struct BatchSettings
+{
+	int cellSize;
+	double compactness;
+	SLICPixelFormat pixelFormat;
+	bool warmStart;
+	bool quiet;
+};
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string OutputPath(const std::string& dir, const std::string& input, const std::string& format)
+{
+	size_t slash = input.find_last_of("/\\");
+	std::string name = (slash == std::string::npos) ? input : input.substr(slash + 1);
+	if (!format.empty()) {
+		size_t dot = name.find_last_of('.');
+		name = ((dot == std::string::npos) ? name : name.substr(0, dot)) + "." + format;
+	}
+	if (dir.empty()) return name;
+	char last = dir[dir.size() - 1];
+	return (last == '/' || last == '\\') ? dir + name : dir + "/" + name;
+}
+
+static bool ReadList(const std::string& path, std::vector<std::string>& inputs)
+{
+	std::ifstream file(path.c_str());
+	if (!file) return false;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+		if (!line.empty()) inputs.push_back(line);
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BatchSettings settings = { 30, 20.0, kSLICPixelRGBA, false, false };
+	SLICColorMode colorMode = kSLICColorFast;
+	SLICKernel kernel = kSLICKernelFloat;
+	SLICEngine engine = kSLICEngineSLIC;
+	SLICAssignMode assignMode = kSLICAssignClusters;
+	int threads = 0;
+	int maxIterations = 10;
+	double convergence = 0.5;
+	double activeThreshold = 0.0;
+	int queueFrames = 2;
+	std::string outputDir, format;
+	std::vector<std::string> inputs;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--output-dir" && i + 1 < argc) {
+			outputDir = argv[++i];
+		} else if (arg == "--format" && i + 1 < argc) {
+			format = argv[++i];
+			if (format != "png" && format != "ppm" && format != "pam") { fprintf(stderr, "unknown format: %s\n", format.c_str()); return 2; }
+		} else if (arg == "--list" && i + 1 < argc) {
+			std::string path = argv[++i];
+			if (!ReadList(path, inputs)) { fprintf(stderr, "cannot read %s\n", path.c_str()); return 1; }
+		} else if (arg == "--warm-start") {
+			settings.warmStart = true;
+		} else if (arg == "--queue" && i + 1 < argc) {
+			queueFrames = atoi(argv[++i]);
+		} else if (arg == "--cell-size" && i + 1 < argc) {
+			settings.cellSize = atoi(argv[++i]);
+		} else if (arg == "--compactness" && i + 1 < argc) {
+			settings.compactness = atof(argv[++i]);
+		} else if (arg == "--exact-color") {
+			colorMode = kSLICColorExact;
+		} else if (arg == "--engine" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParseEngine(value, engine)) { fprintf(stderr, "unknown engine: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--assign" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParseAssignMode(value, assignMode)) { fprintf(stderr, "unknown assignment order: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--kernel" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParseKernel(value, kernel)) { fprintf(stderr, "unknown kernel: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--pixel" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParsePixelFormat(value, settings.pixelFormat)) { fprintf(stderr, "unknown pixel format: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--max-iterations" && i + 1 < argc) {
+			maxIterations = atoi(argv[++i]);
+		} else if (arg == "--convergence" && i + 1 < argc) {
+			convergence = atof(argv[++i]);
+		} else if (arg == "--active-threshold" && i + 1 < argc) {
+			activeThreshold = atof(argv[++i]);
+		} else if (arg == "--threads" && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (arg == "--quiet") {
+			settings.quiet = true;
+		} else if (arg == "-h" || arg == "--help") {
+			PrintUsage();
+			return 0;
+		} else if (!arg.empty() && arg[0] == '-') {
+			fprintf(stderr, "unknown option: %s\n", arg.c_str());
+			PrintUsage();
+			return 2;
+		} else {
+			inputs.push_back(arg);
+		}
+	}
+	if (inputs.empty() || outputDir.empty()) {
+		PrintUsage();
+		return 2;
+	}
+	if (settings.cellSize < 5 || settings.cellSize > 200 || settings.compactness < 0.1 || settings.compactness > 100.0 || maxIterations < 1 || convergence < 0.0 || activeThreshold < 0.0 || queueFrames < 1) {
+		fprintf(stderr, "parameter out of range (cell size 5-200, compactness 0.1-100, iterations >= 1, convergence >= 0, active threshold >= 0, queue >= 1)\n");
+		return 2;
+	}
+
+	SLICThreadPool threadPool(threads);
+	// One processor is converted while the other is clustered
+	const int kProcessorCount = 2;
+	std::vector<SLICProcessor> processors(kProcessorCount);
+	BatchQueue<SLICProcessor*> freeProcessors(kProcessorCount);
+	for (SLICProcessor& processor : processors) {
+		processor.threadPool = &threadPool;
+		processor.maxIterations = maxIterations;
+		processor.convergenceThreshold = convergence;
+		processor.activeThreshold = activeThreshold;
+		processor.colorMode = colorMode;
+		processor.kernel = kernel;
+		processor.engine = engine;
+		processor.assignMode = assignMode;
+		freeProcessors.Push(&processor);
+	}
+
+	BatchQueue<BatchFrame*> decoded(queueFrames), converted(queueFrames), clustered(queueFrames);
+	// Busy time of every stage; each is written by its own thread only
+	double decodeSeconds = 0.0, convertSeconds = 0.0, clusterSeconds = 0.0, encodeSeconds = 0.0;
+	int failedFrames = 0;
+	long long totalIterations = 0;
+	int warmFrames = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::thread decodeThread([&] {
+		for (size_t i = 0; i < inputs.size(); i++) {
+			std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+			BatchFrame* pFrame = new BatchFrame();
+			pFrame->index = (int)i;
+			pFrame->inputPath = inputs[i];
+			pFrame->outputPath = OutputPath(outputDir, inputs[i], format);
+			pFrame->pProcessor = NULL;
+			pFrame->iterations = 0;
+			pFrame->unlabeled = 0;
+			pFrame->warm = false;
+			if (LoadImageFile(pFrame->inputPath, pFrame->image, pFrame->error)) {
+				PackPixels(pFrame->image, settings.pixelFormat, pFrame->packed);
+				pFrame->image.rgba = std::vector<BYTE>();
+			}
+			decodeSeconds += SecondsSince(t);
+			decoded.Push(pFrame);
+		}
+		decoded.Close();
+	});
+
+	std::thread convertThread([&] {
+		BatchFrame* pFrame;
+		while (decoded.Pop(pFrame)) {
+			if (pFrame->error.empty()) {
+				freeProcessors.Pop(pFrame->pProcessor);
+				std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+				int width = pFrame->image.width;
+				pFrame->pProcessor->Initialize(width, pFrame->image.height, pFrame->packed.data(), width * SLICPixelBytes(settings.pixelFormat), settings.pixelFormat);
+				convertSeconds += SecondsSince(t);
+			}
+			converted.Push(pFrame);
+		}
+		converted.Close();
+	});
+
+	std::thread encodeThread([&] {
+		BatchFrame* pFrame;
+		while (clustered.Pop(pFrame)) {
+			std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+			if (pFrame->error.empty()) {
+				UnpackPixels(pFrame->packed, settings.pixelFormat, pFrame->image);
+				SaveImageFile(pFrame->outputPath, pFrame->image, pFrame->error);
+				if (pFrame->error.empty() && pFrame->unlabeled > 0) pFrame->error = std::to_string(pFrame->unlabeled) + " opaque pixels left unlabeled";
+			}
+			encodeSeconds += SecondsSince(t);
+			if (!pFrame->error.empty()) {
+				fprintf(stderr, "frame %d: %s\n", pFrame->index, pFrame->error.c_str());
+				failedFrames++;
+			} else if (!settings.quiet) {
+				fprintf(stderr, "frame %d: %s, %d iterations%s\n", pFrame->index, pFrame->outputPath.c_str(), pFrame->iterations, pFrame->warm ? " (warm start)" : "");
+			}
+			delete pFrame;
+		}
+	});
+
+	// Clustering runs on this thread, the only one that uses the pool
+	std::vector<SlicCluster> previousCenters;
+	int previousWidth = 0, previousHeight = 0;
+	BatchFrame* pFrame;
+	while (converted.Pop(pFrame)) {
+		if (pFrame->error.empty()) {
+			std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+			SLICProcessor& processor = *pFrame->pProcessor;
+			int width = pFrame->image.width;
+			int height = pFrame->image.height;
+			int rowBytes = width * SLICPixelBytes(settings.pixelFormat);
+			pFrame->warm = settings.warmStart && engine == kSLICEngineSLIC && !previousCenters.empty() && width == previousWidth && height == previousHeight;
+			int currentProgress = 0;
+			if (pFrame->warm) {
+				processor.WarmStart(previousCenters, settings.cellSize);
+				processor.Refine(settings.cellSize, settings.compactness, NULL, &currentProgress, kSLICProgressSteps);
+			} else {
+				processor.Execute(settings.cellSize, settings.compactness, NULL, &currentProgress, kSLICProgressSteps);
+			}
+			processor.Render(pFrame->packed.data(), rowBytes, pFrame->packed.data(), rowBytes, 0, 0, width, height);
+			pFrame->iterations = processor.iterationsRun;
+			pFrame->unlabeled = processor.UnlabeledPixels();
+			totalIterations += processor.iterationsRun;
+			if (pFrame->warm) warmFrames++;
+			if (settings.warmStart) {
+				previousCenters = processor.clusters;
+				previousWidth = width;
+				previousHeight = height;
+			}
+			freeProcessors.Push(pFrame->pProcessor);
+			pFrame->pProcessor = NULL;
+			clusterSeconds += SecondsSince(t);
+		}
+		clustered.Push(pFrame);
+	}
+	clustered.Close();
+	decodeThread.join();
+	convertThread.join();
+	encodeThread.join();
+
+	double elapsed = SecondsSince(start);
+	int frames = (int)inputs.size();
+	int doneFrames = frames - failedFrames;
+	fprintf(stderr, "%d frames (%d failed) in %.2f s, %.2f frames/s, %.2f iterations per frame, %d warm started, %d threads\n", frames, failedFrames, elapsed, (elapsed > 0.0) ? doneFrames / elapsed : 0.0, (doneFrames > 0) ? (double)totalIterations / doneFrames : 0.0, warmFrames, threadPool.ThreadCount());
+	fprintf(stderr, "stage busy time: decode %.2f s, lab conversion %.2f s, clustering %.2f s, encode %.2f s\n", decodeSeconds, convertSeconds, clusterSeconds, encodeSeconds);
+	return (failedFrames > 0) ? 1 : 0;
+}
@@ -0,0 +1,447 @@
+//! SLIC benchmark
+//! Times every stage of the filter separately over synthetic and real images, sizes, cell sizes
+//! and compactness values and writes the results as JSON, so versions can be compared run by
+//! run. The core stages are read back from the profiler phases the processor already records.
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICCore.h"
+#include "SLICImageIO.h"
+#include "SLICProfiler.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: slic_bench [options] [image ...]\n"
+		"  Runs the synthetic images (noise, flat) and every given image at each size.\n"
+		"options:\n"
+		"  --sizes LIST        image widths, comma separated (default 1024,2048,4096; 1K-16K)\n"
+		"  --cell-sizes LIST   cell sizes (default 5,30,200)\n"
+		"  --compactness LIST  compactness values (default 0.1,20,100)\n"
+		"  --kernel K          float (default), integer, compact or reference\n"
+		"  --assign O          assignment order: clusters (default) or pixels\n"
+		"  --isa I             float and integer kernel instruction set: auto, scalar, sse2, avx2, avx512\n"
+		"  --pixel F           source layout: rgba (default), bgra, rgb or gray\n"
+		"  --exact-color       bit exact Lab conversion (default: fast tables)\n"
+		"  --iterations N      iterations per run, no early stop (default 10)\n"
+		"  --repeat N          runs per case, the fastest time of each stage is kept (default 3)\n"
+		"  --threads N         worker threads, 0 = all cores (default)\n"
+		"  --no-synthetic      only run the given images\n"
+		"  --label TEXT        stored in the JSON to tell versions apart\n"
+		"  --output PATH       JSON output (default stdout)\n");
+}
+
+static bool ParseList(const std::string& value, std::vector<double>& list)
+{
+	list.clear();
+	size_t pos = 0;
+	while (pos <= value.size()) {
+		size_t comma = value.find(',', pos);
+		if (comma == std::string::npos) comma = value.size();
+		std::string item = value.substr(pos, comma - pos);
+		char* end = NULL;
+		double v = strtod(item.c_str(), &end);
+		if (item.empty() || *end != '\0') return false;
+		list.push_back(v);
+		pos = comma + 1;
+	}
+	return !list.empty();
+}
+
+// --- Inputs ---
+
+struct BenchSource
+{
+	std::string name;
+	SLICImage image; // synthetic sources are generated per size, real ones are tiled
+	bool synthetic;
+};
+
+static unsigned int NextRandom(unsigned int& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// "noise": smooth color gradients with per pixel noise, like a photo.
+// "flat": flat colored rectangles on a transparent background, like an illustration layer.
+static void MakeSynthetic(const std::string& name, int w, int h, SLICImage& image)
+{
+	image.width = w;
+	image.height = h;
+	image.rgba.assign((size_t)w * h * 4, 0);
+	unsigned int state = 0x2545F491u;
+	if (name == "noise") {
+		for (int y = 0; y < h; y++) {
+			BYTE* row = image.rgba.data() + (size_t)y * w * 4;
+			for (int x = 0; x < w; x++) {
+				int n = (int)(NextRandom(state) % 25) - 12;
+				row[x * 4 + 0] = (BYTE)std::min(255, std::max(0, (int)(255.0 * x / w) + n));
+				row[x * 4 + 1] = (BYTE)std::min(255, std::max(0, (int)(255.0 * y / h) + n));
+				row[x * 4 + 2] = (BYTE)std::min(255, std::max(0, (int)(128.0 + 100.0 * ((x ^ y) & 255) / 255.0) + n));
+				row[x * 4 + 3] = 255;
+			}
+		}
+	} else {
+		int border = std::max(1, w / 32);
+		for (int r = 0; r < 64; r++) {
+			int x0 = border + (int)(NextRandom(state) % (unsigned int)std::max(1, w - 2 * border));
+			int y0 = border + (int)(NextRandom(state) % (unsigned int)std::max(1, h - 2 * border));
+			int x1 = std::min(w - border, x0 + w / 8 + (int)(NextRandom(state) % (unsigned int)(w / 4 + 1)));
+			int y1 = std::min(h - border, y0 + h / 8 + (int)(NextRandom(state) % (unsigned int)(h / 4 + 1)));
+			unsigned int color = NextRandom(state);
+			for (int y = y0; y < y1; y++) {
+				BYTE* row = image.rgba.data() + (size_t)y * w * 4;
+				for (int x = x0; x < x1; x++) {
+					row[x * 4 + 0] = (BYTE)color;
+					row[x * 4 + 1] = (BYTE)(color >> 8);
+					row[x * 4 + 2] = (BYTE)(color >> 16);
+					row[x * 4 + 3] = 255;
+				}
+			}
+		}
+	}
+}
+
+// Mirrored tiling keeps the texture of a real image at its own scale at any size
+static void TileImage(const SLICImage& source, int w, int h, SLICImage& image)
+{
+	image.width = w;
+	image.height = h;
+	image.rgba.resize((size_t)w * h * 4);
+	for (int y = 0; y < h; y++) {
+		int sy = y % (2 * source.height);
+		if (sy >= source.height) sy = 2 * source.height - 1 - sy;
+		const BYTE* srcRow = source.rgba.data() + (size_t)sy * source.RowBytes();
+		BYTE* row = image.rgba.data() + (size_t)y * image.RowBytes();
+		for (int x = 0; x < w; x++) {
+			int sx = x % (2 * source.width);
+			if (sx >= source.width) sx = 2 * source.width - 1 - sx;
+			memcpy(row + x * 4, srcRow + sx * 4, 4);
+		}
+	}
+}
+
+// --- JSON ---
+
+static void WriteJsonString(FILE* file, const std::string& text)
+{
+	fputc('"', file);
+	for (size_t i = 0; i < text.size(); i++) {
+		unsigned char c = (unsigned char)text[i];
+		if (c == '"' || c == '\\') fprintf(file, "\\%c", c);
+		else if (c < 0x20) fprintf(file, "\\u%04x", c);
+		else fputc(c, file);
+	}
+	fputc('"', file);
+}
+
+// seconds is the fastest of the repeats, calls the number of times the stage ran per run
+struct BenchStage
+{
+	double seconds;
+	int calls;
+};
+
+static void WriteStage(FILE* file, const char* indent, const std::string& name, const BenchStage& stage, size_t pixels, bool last)
+{
+	fprintf(file, "%s", indent);
+	WriteJsonString(file, name);
+	double pixelsPerSecond = (stage.seconds > 0.0) ? (double)pixels * stage.calls / stage.seconds : 0.0;
+	fprintf(file, ": {\"seconds\": %.6f, \"calls\": %d, \"pixelsPerSecond\": %.0f}%s\n", stage.seconds, stage.calls, pixelsPerSecond, last ? "" : ",");
+}
+
+// Keeps the fastest time of each stage over the repeats
+static void KeepFastest(std::map<std::string, BenchStage>& best, const std::string& name, double seconds, int calls)
+{
+	std::map<std::string, BenchStage>::iterator it = best.find(name);
+	if (it == best.end()) {
+		BenchStage stage = { seconds, calls };
+		best[name] = stage;
+	} else if (seconds < it->second.seconds) {
+		it->second.seconds = seconds;
+		it->second.calls = calls;
+	}
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The reference conversions and the converter over the first pixels of the image (the per
+// pixel cost does not depend on the size, the converter cache depends on the content)
+static const size_t kColorSamplePixels = (size_t)1 << 22;
+
+static void BenchColor(FILE* file, const SLICImage& image, SLICColorMode colorMode, int repeat)
+{
+	size_t pixels = std::min(kColorSamplePixels, (size_t)image.width * image.height);
+	std::vector<double> lab(pixels * 3);
+	std::map<std::string, BenchStage> best;
+	unsigned int sink = 0;
+	for (int r = 0; r < repeat; r++) {
+		const BYTE* px = image.rgba.data();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < pixels; i++) RGB2LAB(px[i * 4], px[i * 4 + 1], px[i * 4 + 2], lab[i * 3], lab[i * 3 + 1], lab[i * 3 + 2]);
+		KeepFastest(best, "RGB2LAB", SecondsSince(start), 1);
+
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < pixels; i++) {
+			BYTE cr, cg, cb;
+			LAB2RGB(lab[i * 3], lab[i * 3 + 1], lab[i * 3 + 2], cr, cg, cb);
+			sink += cr + cg + cb;
+		}
+		KeepFastest(best, "LAB2RGB", SecondsSince(start), 1);
+
+		SLICColorConverter converter(colorMode);
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < pixels; i++) converter.RGBToLab(px[i * 4], px[i * 4 + 1], px[i * 4 + 2], lab[i * 3], lab[i * 3 + 1], lab[i * 3 + 2]);
+		KeepFastest(best, "SLICColorConverter::RGBToLab", SecondsSince(start), 1);
+
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < pixels; i++) {
+			BYTE cr, cg, cb;
+			converter.LabToRGB(lab[i * 3], lab[i * 3 + 1], lab[i * 3 + 2], cr, cg, cb);
+			sink += cr + cg + cb;
+		}
+		KeepFastest(best, "SLICColorConverter::LabToRGB", SecondsSince(start), 1);
+	}
+	if (sink == 1) fprintf(stderr, " "); // keeps the LabToRGB loops
+
+	fprintf(file, "      \"color\": {\"samplePixels\": %zu, \"stages\": {\n", pixels);
+	size_t index = 0;
+	for (std::map<std::string, BenchStage>::const_iterator it = best.begin(); it != best.end(); ++it, ++index) {
+		WriteStage(file, "        ", it->first, it->second, pixels, index + 1 == best.size());
+	}
+	fprintf(file, "      }},\n");
+}
+
+struct BenchSettings
+{
+	SLICKernel kernel;
+	SLICAssignMode assignMode;
+	SLICPixelFormat pixelFormat;
+	SLICIsa isa;
+	SLICColorMode colorMode;
+	int iterations;
+	int repeat;
+	SLICThreadPool* threadPool;
+};
+
+// One Initialize + Execute + Render per repeat; the stage times come from the profiler phases
+static void BenchRun(FILE* file, const std::string& name, const SLICImage& image, int cellSize, double compactness, const BenchSettings& settings, bool& first)
+{
+	size_t pixels = (size_t)image.width * image.height;
+	size_t estimate = SLICProcessor::EstimateMemory(image.width, image.height, cellSize, settings.kernel, settings.assignMode, settings.pixelFormat, false);
+	int pixelBytes = SLICPixelBytes(settings.pixelFormat);
+	size_t available = SLICAvailableMemory();
+
+	fprintf(file, "%s        {\"cellSize\": %d, \"compactness\": %g, \"estimatedBytesPerPixel\": %.2f", first ? "" : ",\n", cellSize, compactness, (double)estimate / pixels);
+	first = false;
+	// The destination buffer of the render is the second image
+	if (available != 0 && estimate + pixels * pixelBytes > available) {
+		fprintf(stderr, "%s %dx%d cell %d: skipped, needs %.0f MB\n", name.c_str(), image.width, image.height, cellSize, (estimate + pixels * pixelBytes) / (1024.0 * 1024.0));
+		fprintf(file, ", \"skipped\": \"memory\"}");
+		return;
+	}
+
+	std::map<std::string, BenchStage> best;
+	std::vector<BYTE> src, dst(pixels * pixelBytes);
+	PackPixels(image, settings.pixelFormat, src);
+	std::vector<SLICProfileEvent> events;
+	size_t clusters = 0;
+	long long pixelsEvaluated = 0;
+	for (int r = 0; r < settings.repeat; r++) {
+		SLICProcessor processor;
+		processor.threadPool = settings.threadPool;
+		processor.kernel = settings.kernel;
+		processor.assignMode = settings.assignMode;
+		processor.isa = settings.isa;
+		processor.colorMode = settings.colorMode;
+		processor.maxIterations = settings.iterations;
+		processor.convergenceThreshold = 0.0; // same work for every version
+
+		SLICProfiler::Clear();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		processor.Initialize(image.width, image.height, src.data(), image.width * pixelBytes, settings.pixelFormat);
+		processor.Execute(cellSize, compactness, NULL, NULL, 0);
+		processor.Render(src.data(), image.width * pixelBytes, dst.data(), image.width * pixelBytes, 0, 0, image.width, image.height);
+		double total = SecondsSince(start);
+		clusters = processor.clusters.size();
+
+		// Sum the phases of this run by name; only the phases of the calling thread are stages
+		SLICProfiler::Collect(events);
+		std::map<std::string, BenchStage> run;
+		pixelsEvaluated = 0;
+		for (size_t i = 0; i < events.size(); i++) {
+			const SLICProfileEvent& event = events[i];
+			if (event.kind == kSLICProfileCounter && strcmp(event.name, "pixels evaluated") == 0) pixelsEvaluated += event.value;
+			if (event.kind != kSLICProfilePhase) continue;
+			BenchStage& stage = run[event.name];
+			stage.seconds += event.duration * 1e-9;
+			stage.calls++;
+		}
+		for (std::map<std::string, BenchStage>::const_iterator it = run.begin(); it != run.end(); ++it) KeepFastest(best, it->first, it->second.seconds, it->second.calls);
+		KeepFastest(best, "total", total, 1);
+		fprintf(stderr, "%s %dx%d cell %d m %g: %.1f ms\n", name.c_str(), image.width, image.height, cellSize, compactness, total * 1000.0);
+	}
+
+	fprintf(file, ", \"clusters\": %zu, \"pixelsEvaluated\": %lld, \"stages\": {\n", clusters, pixelsEvaluated);
+	size_t index = 0;
+	for (std::map<std::string, BenchStage>::const_iterator it = best.begin(); it != best.end(); ++it, ++index) {
+		WriteStage(file, "          ", it->first, it->second, pixels, index + 1 == best.size());
+	}
+	fprintf(file, "        }}");
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<double> sizes, cellSizes, compactnessValues;
+	ParseList("1024,2048,4096", sizes);
+	ParseList("5,30,200", cellSizes);
+	ParseList("0.1,20,100", compactnessValues);
+	BenchSettings settings = { kSLICKernelFloat, kSLICAssignClusters, kSLICPixelRGBA, kSLICIsaAuto, kSLICColorFast, 10, 3, NULL };
+	int threads = 0;
+	bool synthetic = true;
+	std::string label, outputPath;
+	std::vector<std::string> imagePaths;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--sizes" && i + 1 < argc) {
+			if (!ParseList(argv[++i], sizes)) { fprintf(stderr, "bad size list: %s\n", argv[i]); return 2; }
+		} else if (arg == "--cell-sizes" && i + 1 < argc) {
+			if (!ParseList(argv[++i], cellSizes)) { fprintf(stderr, "bad cell size list: %s\n", argv[i]); return 2; }
+		} else if (arg == "--compactness" && i + 1 < argc) {
+			if (!ParseList(argv[++i], compactnessValues)) { fprintf(stderr, "bad compactness list: %s\n", argv[i]); return 2; }
+		} else if (arg == "--assign" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParseAssignMode(value, settings.assignMode)) { fprintf(stderr, "unknown assignment order: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--kernel" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParseKernel(value, settings.kernel)) { fprintf(stderr, "unknown kernel: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--isa" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParseIsa(value, settings.isa)) { fprintf(stderr, "unknown isa: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--pixel" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParsePixelFormat(value, settings.pixelFormat)) { fprintf(stderr, "unknown pixel format: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--exact-color") {
+			settings.colorMode = kSLICColorExact;
+		} else if (arg == "--iterations" && i + 1 < argc) {
+			settings.iterations = atoi(argv[++i]);
+		} else if (arg == "--repeat" && i + 1 < argc) {
+			settings.repeat = atoi(argv[++i]);
+		} else if (arg == "--threads" && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (arg == "--no-synthetic") {
+			synthetic = false;
+		} else if (arg == "--label" && i + 1 < argc) {
+			label = argv[++i];
+		} else if (arg == "--output" && i + 1 < argc) {
+			outputPath = argv[++i];
+		} else if (arg == "-h" || arg == "--help") {
+			PrintUsage();
+			return 0;
+		} else if (!arg.empty() && arg[0] == '-') {
+			fprintf(stderr, "unknown option: %s\n", arg.c_str());
+			PrintUsage();
+			return 2;
+		} else {
+			imagePaths.push_back(arg);
+		}
+	}
+	for (size_t i = 0; i < sizes.size(); i++) {
+		if (sizes[i] < 16 || sizes[i] > 16384) { fprintf(stderr, "sizes must be 16-16384\n"); return 2; }
+	}
+	for (size_t i = 0; i < cellSizes.size(); i++) {
+		if (cellSizes[i] < 5 || cellSizes[i] > 200) { fprintf(stderr, "cell sizes must be 5-200\n"); return 2; }
+	}
+	for (size_t i = 0; i < compactnessValues.size(); i++) {
+		if (compactnessValues[i] < 0.1 || compactnessValues[i] > 100.0) { fprintf(stderr, "compactness must be 0.1-100\n"); return 2; }
+	}
+	if (settings.iterations < 1 || settings.repeat < 1) {
+		fprintf(stderr, "iterations and repeat must be >= 1\n");
+		return 2;
+	}
+
+	std::vector<BenchSource> sources;
+	if (synthetic) {
+		BenchSource noise = { "noise", SLICImage(), true };
+		BenchSource flat = { "flat", SLICImage(), true };
+		sources.push_back(noise);
+		sources.push_back(flat);
+	}
+	for (size_t i = 0; i < imagePaths.size(); i++) {
+		BenchSource source = { imagePaths[i], SLICImage(), false };
+		std::string error;
+		if (!LoadImageFile(imagePaths[i], source.image, error)) {
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		sources.push_back(source);
+	}
+	if (sources.empty()) {
+		PrintUsage();
+		return 2;
+	}
+
+	FILE* file = outputPath.empty() ? stdout : fopen(outputPath.c_str(), "wb");
+	if (file == NULL) {
+		fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+		return 1;
+	}
+
+	SLICThreadPool threadPool(threads);
+	settings.threadPool = &threadPool;
+	SLICProfiler::SetEnabled(true);
+
+	fprintf(file, "{\n  \"label\": ");
+	WriteJsonString(file, label);
+	fprintf(file, ",\n  \"kernel\": \"%s\", \"assign\": \"%s\", \"pixel\": \"%s\", \"isa\": \"%s\", \"colorMode\": \"%s\", \"threads\": %d, \"iterations\": %d, \"repeat\": %d,\n",
+		KernelName(settings.kernel), (settings.assignMode == kSLICAssignPixels) ? "pixels" : "clusters", PixelFormatName(settings.pixelFormat), SLICIsaName(SLICResolveIsa(settings.isa)), (settings.colorMode == kSLICColorExact) ? "exact" : "fast", threadPool.ThreadCount(), settings.iterations, settings.repeat);
+
+	// Images are made one at a time so only one is held at 16K
+	fprintf(file, "  \"images\": [\n");
+	bool firstImage = true;
+	for (size_t s = 0; s < sizes.size(); s++) {
+		int width = (int)sizes[s];
+		for (size_t i = 0; i < sources.size(); i++) {
+			// Square synthetic images; real ones keep their aspect ratio
+			int height = sources[i].synthetic ? width : std::max(1, (int)((double)width * sources[i].image.height / sources[i].image.width + 0.5));
+			SLICImage image;
+			if (sources[i].synthetic) MakeSynthetic(sources[i].name, width, height, image);
+			else TileImage(sources[i].image, width, height, image);
+
+			fprintf(file, "%s    {\"image\": ", firstImage ? "" : ",\n");
+			firstImage = false;
+			WriteJsonString(file, sources[i].name);
+			fprintf(file, ", \"width\": %d, \"height\": %d,\n", width, height);
+			BenchColor(file, image, settings.colorMode, settings.repeat);
+			fprintf(file, "      \"runs\": [\n");
+			bool firstRun = true;
+			for (size_t c = 0; c < cellSizes.size(); c++) {
+				for (size_t m = 0; m < compactnessValues.size(); m++) {
+					BenchRun(file, sources[i].name, image, (int)cellSizes[c], compactnessValues[m], settings, firstRun);
+				}
+			}
+			fprintf(file, "\n      ]}");
+		}
+	}
+	fprintf(file, "\n  ]\n}\n");
+	bool ok = (ferror(file) == 0);
+	if (file != stdout && fclose(file) != 0) ok = false;
+	if (!ok) {
+		fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,303 @@
+//! SLIC command line driver
+//! Runs the host independent SLIC core on an image file, e.g.
+//!   slic_cli --cell-size 30 --compactness 20 input.png output.png
+#include "SLICCore.h"
+#include "SLICStream.h"
+#include "SLICImageIO.h"
+#include "SLICProfiler.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: slic_cli [options] <input> <output>\n"
+		"  input/output: .png, .ppm (P6) or .pam (P7 RGB_ALPHA)\n"
+		"options:\n"
+		"  --cell-size N      superpixel cell size in pixels (5-200, default 30)\n"
+		"  --compactness M    shape regularity (0.1-100, default 20)\n"
+		"  --exact-color      bit exact Lab conversion (default: fast tables)\n"
+		"  --engine E         slic (default, iterative, fastest) or snic (single pass region growing,\n"
+		"                     slower than slic)\n"
+		"  --assign O         slic assignment order: clusters (default, 2S windows into a distance plane)\n"
+		"                     or pixels (S x S grid cells against the 3 x 3 nearby cells' clusters)\n"
+		"  --kernel K         assignment kernel: float (default), integer (16 bit fixed point),\n"
+		"                     compact (16 bit, less memory) or reference\n"
+		"  --isa I            float and integer kernel instruction set: auto, scalar, sse2, avx2, avx512\n"
+		"  --pixel F          layout the image is processed in: rgba (default), bgra, rgb or gray\n"
+		"                     (gray + alpha, clustered on L only)\n"
+		"  --max-iterations N maximum clustering iterations (default 10)\n"
+		"  --convergence E    stop when the mean center movement drops below E (default 0.5, 0 = off)\n"
+		"  --active-threshold E  after the first iteration only reassign clusters near one that moved more than E (default 0 = all)\n"
+		"  --preview          cluster a downsampled pyramid level first and refine from it\n"
+		"  --hierarchy        cluster at cell size 5, merge the superpixels into a hierarchy and cut it\n"
+		"                     at the cell size, followed by one slic iteration\n"
+		"  --hierarchy-raw    same, without the slic iteration after the cut\n"
+		"  --stream           process the image in bands (bounded memory, float kernel)\n"
+		"  --threads N        worker threads, 0 = all cores (default), 1 = single threaded\n"
+		"  --profile PATH     write a Chrome trace of phase timings and counters to PATH (also SLIC_PROFILE=PATH)\n"
+		"  --quiet            do not print progress\n");
+}
+
+static void WriteProfile(bool quiet)
+{
+	if (!SLICProfiler::Enabled()) return;
+	std::string path = SLICProfiler::DumpPath();
+	if (!SLICProfiler::Dump()) fprintf(stderr, "cannot write profile %s\n", path.c_str());
+	else if (!quiet) fprintf(stderr, "profile written to %s\n", path.c_str());
+}
+
+struct CliProgress
+{
+	int total;
+	bool quiet;
+	std::chrono::steady_clock::time_point lastPoll;
+	double longestPollGapMs; // what a host would wait for a cancel to be seen
+};
+
+static void CliSetProgressDone(void* data, int done)
+{
+	CliProgress* pProgress = static_cast<CliProgress*>(data);
+	if (!pProgress->quiet) fprintf(stderr, "\rprogress %d/%d", done, pProgress->total);
+}
+
+static int CliProcess(void* data)
+{
+	CliProgress* pProgress = static_cast<CliProgress*>(data);
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	pProgress->longestPollGapMs = std::max(pProgress->longestPollGapMs, std::chrono::duration<double, std::milli>(now - pProgress->lastPoll).count());
+	pProgress->lastPoll = now;
+	return kSLICResultContinue;
+}
+
+// The image repacked in the --pixel layout
+struct CliPixels
+{
+	std::vector<BYTE> data;
+	int rowBytes;
+};
+
+// Band access over the in memory image; the bands are rendered in place, which is safe because
+// a band is read in full before it is written
+static const BYTE* CliReadRows(void* data, int y, int, int* pRowBytes)
+{
+	CliPixels* pPixels = static_cast<CliPixels*>(data);
+	*pRowBytes = pPixels->rowBytes;
+	return pPixels->data.data() + (size_t)y * pPixels->rowBytes;
+}
+
+static BYTE* CliBeginWriteRows(void* data, int y, int, int* pRowBytes)
+{
+	CliPixels* pPixels = static_cast<CliPixels*>(data);
+	*pRowBytes = pPixels->rowBytes;
+	return pPixels->data.data() + (size_t)y * pPixels->rowBytes;
+}
+
+static bool CliEndWriteRows(void*, int, int)
+{
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	int cellSize = 30;
+	double compactness = 20.0;
+	bool quiet = false;
+	SLICColorMode colorMode = kSLICColorFast;
+	SLICKernel kernel = kSLICKernelFloat;
+	SLICEngine engine = kSLICEngineSLIC;
+	SLICAssignMode assignMode = kSLICAssignClusters;
+	SLICIsa isa = kSLICIsaAuto;
+	SLICPixelFormat pixelFormat = kSLICPixelRGBA;
+	int threads = 0;
+	int maxIterations = 10;
+	double convergence = 0.5;
+	double activeThreshold = 0.0;
+	bool preview = false;
+	bool stream = false;
+	int hierarchy = 0; // 1 = cut and refine, 2 = cut only
+	std::string inputPath, outputPath;
+	SLICProfiler::ConfigureFromEnvironment();
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--cell-size" && i + 1 < argc) {
+			cellSize = atoi(argv[++i]);
+		} else if (arg == "--compactness" && i + 1 < argc) {
+			compactness = atof(argv[++i]);
+		} else if (arg == "--exact-color") {
+			colorMode = kSLICColorExact;
+		} else if (arg == "--engine" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParseEngine(value, engine)) { fprintf(stderr, "unknown engine: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--assign" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParseAssignMode(value, assignMode)) { fprintf(stderr, "unknown assignment order: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--kernel" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParseKernel(value, kernel)) { fprintf(stderr, "unknown kernel: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--isa" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParseIsa(value, isa)) { fprintf(stderr, "unknown isa: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--pixel" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (!ParsePixelFormat(value, pixelFormat)) { fprintf(stderr, "unknown pixel format: %s\n", value.c_str()); return 2; }
+		} else if (arg == "--max-iterations" && i + 1 < argc) {
+			maxIterations = atoi(argv[++i]);
+		} else if (arg == "--convergence" && i + 1 < argc) {
+			convergence = atof(argv[++i]);
+		} else if (arg == "--active-threshold" && i + 1 < argc) {
+			activeThreshold = atof(argv[++i]);
+		} else if (arg == "--preview") {
+			preview = true;
+		} else if (arg == "--hierarchy") {
+			hierarchy = 1;
+		} else if (arg == "--hierarchy-raw") {
+			hierarchy = 2;
+		} else if (arg == "--stream") {
+			stream = true;
+		} else if (arg == "--threads" && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (arg == "--profile" && i + 1 < argc) {
+			SLICProfiler::SetDumpPath(argv[++i]);
+			SLICProfiler::SetEnabled(true);
+		} else if (arg == "--quiet") {
+			quiet = true;
+		} else if (arg == "-h" || arg == "--help") {
+			PrintUsage();
+			return 0;
+		} else if (!arg.empty() && arg[0] == '-') {
+			fprintf(stderr, "unknown option: %s\n", arg.c_str());
+			PrintUsage();
+			return 2;
+		} else if (inputPath.empty()) {
+			inputPath = arg;
+		} else if (outputPath.empty()) {
+			outputPath = arg;
+		} else {
+			PrintUsage();
+			return 2;
+		}
+	}
+	if (inputPath.empty() || outputPath.empty()) {
+		PrintUsage();
+		return 2;
+	}
+	if (cellSize < 5 || cellSize > 200 || compactness < 0.1 || compactness > 100.0 || maxIterations < 1 || convergence < 0.0 || activeThreshold < 0.0) {
+		fprintf(stderr, "parameter out of range (cell size 5-200, compactness 0.1-100, iterations >= 1, convergence >= 0, active threshold >= 0)\n");
+		return 2;
+	}
+	if (stream && engine != kSLICEngineSLIC) {
+		fprintf(stderr, "--stream only runs the slic engine\n");
+		return 2;
+	}
+	if (stream && hierarchy) {
+		fprintf(stderr, "--hierarchy does not run with --stream\n");
+		return 2;
+	}
+
+	std::string error;
+	SLICImage image;
+	if (!LoadImageFile(inputPath, image, error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	CliPixels pixels;
+	PackPixels(image, pixelFormat, pixels.data);
+	pixels.rowBytes = image.width * SLICPixelBytes(pixelFormat);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	SLICThreadPool threadPool(threads);
+	if (stream) {
+		SLICStreamProcessor streamProcessor;
+		streamProcessor.threadPool = &threadPool;
+		streamProcessor.maxIterations = maxIterations;
+		streamProcessor.convergenceThreshold = convergence;
+		streamProcessor.colorMode = colorMode;
+		streamProcessor.isa = isa;
+		streamProcessor.pixelFormat = pixelFormat;
+
+		CliProgress progress = { streamProcessor.ProgressTotal(), quiet, start, 0.0 };
+		SLICCallbacks callbacks = { &progress, CliSetProgressDone, CliProcess };
+		SLICStreamIO io = { &pixels, CliReadRows, CliBeginWriteRows, CliEndWriteRows, NULL };
+		int currentProgress = 0;
+		streamProcessor.Execute(image.width, image.height, cellSize, compactness, &io, &callbacks, &currentProgress, kSLICProgressSteps);
+		double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (!quiet) {
+			fprintf(stderr, "\n%dx%d, %zu clusters, kernel stream (%s, %d rows per band), %d threads, %d iterations (residual %.4f), %.1f ms\n", image.width, image.height, streamProcessor.clusters.size(), SLICIsaName(SLICResolveIsa(isa)), SLICStreamProcessor::BandRows(cellSize), threadPool.ThreadCount(), streamProcessor.iterationsRun, streamProcessor.lastResidual, elapsedMs);
+			fprintf(stderr, "estimated memory %.1f MB\n", SLICStreamProcessor::EstimateMemory(image.width, image.height, cellSize, pixelFormat) / (1024.0 * 1024.0));
+			fprintf(stderr, "longest gap between host polls %.1f ms\n", progress.longestPollGapMs);
+		}
+		WriteProfile(quiet);
+		if (streamProcessor.unlabeledPixels > 0) fprintf(stderr, "%lld opaque pixels left unlabeled\n", streamProcessor.unlabeledPixels);
+		UnpackPixels(pixels.data, pixelFormat, image);
+		if (!SaveImageFile(outputPath, image, error)) {
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		return (streamProcessor.unlabeledPixels > 0) ? 1 : 0;
+	}
+
+	SLICProcessor processor;
+	processor.threadPool = &threadPool;
+	processor.maxIterations = maxIterations;
+	processor.convergenceThreshold = convergence;
+	processor.activeThreshold = activeThreshold;
+	processor.colorMode = colorMode;
+	processor.kernel = kernel;
+	processor.engine = engine;
+	processor.assignMode = assignMode;
+	processor.isa = isa;
+
+	// Same progress layout as the filter: 1 (initialize) + iterations + 1 (render), once more for
+	// the hierarchy cut
+	CliProgress progress = { processor.ProgressTotal() + (hierarchy ? (maxIterations + 1) * kSLICProgressSteps : 0), quiet, start, 0.0 };
+	SLICCallbacks callbacks = { &progress, CliSetProgressDone, CliProcess };
+
+	processor.Initialize(image.width, image.height, pixels.data.data(), pixels.rowBytes, pixelFormat);
+	int currentProgress = kSLICProgressSteps;
+	CliSetProgressDone(&progress, currentProgress);
+	progress.lastPoll = std::chrono::steady_clock::now(); // the clustering polls, Initialize does not
+	// SNIC is a single pass already; the preview only applies to SLIC
+	int previewLevel = (preview && engine == kSLICEngineSLIC && !hierarchy) ? processor.PreviewLevel(cellSize) : 0;
+	double previewMs = 0.0;
+	double buildMs = 0.0;
+	if (hierarchy) {
+		processor.BuildHierarchy(5, compactness, &callbacks, &currentProgress, kSLICProgressSteps);
+		buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		processor.CutHierarchy(cellSize, hierarchy == 1, &callbacks, &currentProgress, kSLICProgressSteps);
+	} else if (previewLevel > 0) {
+		processor.ExecutePreview(cellSize, compactness, previewLevel, &callbacks);
+		previewMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		processor.Refine(cellSize, compactness, &callbacks, &currentProgress, kSLICProgressSteps);
+	} else {
+		processor.Execute(cellSize, compactness, &callbacks, &currentProgress, kSLICProgressSteps);
+	}
+	// In place: every pixel is read before it is written
+	processor.Render(pixels.data.data(), pixels.rowBytes, pixels.data.data(), pixels.rowBytes, 0, 0, image.width, image.height);
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (!quiet) {
+		const char* kernelName = (kernel == kSLICKernelFloat) ? SLICIsaName(SLICResolveIsa(isa)) : KernelName(kernel);
+		fprintf(stderr, "\n%dx%d, %zu clusters, %s, kernel %s, %d threads, %d iterations (residual %.4f), %.1f ms\n", image.width, image.height, processor.clusters.size(), (engine == kSLICEngineSNIC) ? "snic" : (assignMode == kSLICAssignPixels) ? "slic pixel order" : "slic", kernelName, threadPool.ThreadCount(), processor.iterationsRun, processor.lastResidual, elapsedMs);
+		fprintf(stderr, "estimated memory %.1f MB\n", SLICProcessor::EstimateMemory(image.width, image.height, cellSize, kernel, assignMode, pixelFormat, previewLevel > 0) / (1024.0 * 1024.0));
+		fprintf(stderr, "longest gap between host polls while clustering %.1f ms\n", progress.longestPollGapMs);
+		if (engine == kSLICEngineSLIC) fprintf(stderr, "%lld cluster windows assigned (%.2f per cluster)\n", processor.clusterAssignments, processor.clusters.empty() ? 0.0 : (double)processor.clusterAssignments / processor.clusters.size());
+		if (previewLevel > 0) fprintf(stderr, "preview at 1/%d scale after %.1f ms\n", 1 << previewLevel, previewMs);
+		if (hierarchy) fprintf(stderr, "hierarchy built after %.1f ms (estimated %.1f MB more), cut in %.1f ms\n", buildMs, SLICProcessor::HierarchyMemory(image.width, image.height, 5) / (1024.0 * 1024.0), elapsedMs - buildMs);
+	}
+	WriteProfile(quiet);
+	// Every opaque pixel must get a superpixel color; unlabeled ones would keep the source
+	long long unlabeled = processor.UnlabeledPixels();
+	if (unlabeled > 0) fprintf(stderr, "%lld opaque pixels left unlabeled\n", unlabeled);
+
+	UnpackPixels(pixels.data, pixelFormat, image);
+	if (!SaveImageFile(outputPath, image, error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	return (unlabeled > 0) ? 1 : 0;
+}
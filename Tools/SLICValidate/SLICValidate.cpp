@@ -0,0 +1,599 @@
+//! SLIC validation
+//! Runs a reference and a candidate configuration of the processor over a corpus of images and
+//! compares the candidate against the reference: label agreement, boundary recall,
+//! undersegmentation error, color difference of the rendered result and speedup. Thresholds
+//! turn it into a gate: the exit status is 1 when any image falls below one of them, or when
+//! either run leaves an opaque pixel unlabeled.
+//! MIT License, Copyright (c) 2026/2/14  Akihiro.Watanabe, (Mitobe Hikane) -- see PISLICMain.cpp
+#include "SLICCore.h"
+#include "SLICStream.h"
+#include "SLICImageIO.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: slic_validate [options] <image> [image ...]\n"
+		"options:\n"
+		"  --reference SPEC        reference configuration (default kernel=reference,color=exact,threads=1)\n"
+		"  --candidate SPEC        candidate configuration (default: the filter defaults, kernel=float,color=fast,\n"
+		"                          assign=pixels,convergence=0.5,active=0.5)\n"
+		"      SPEC is a comma separated list of kernel=reference|float|integer|compact, color=exact|fast,\n"
+		"      isa=auto|scalar|sse2|avx2|avx512, engine=slic|snic, assign=clusters|pixels, threads=N,\n"
+		"      convergence=E, active=E, preview=0|1, hierarchy=0|1|raw (build at cell size 5 and cut, 1 refines\n"
+		"      the cut), warm=D (warm start from the centers of the image shifted by D pixels), stream=0|1 (bands\n"
+		"      through SLICStreamProcessor; needs kernel=float, assign=clusters, active=0); keys not given\n"
+		"      keep the defaults above (threads=0, isa=auto, engine=slic, assign=clusters, convergence=0,\n"
+		"      active=0 for the reference)\n"
+		"  --cell-size N           superpixel cell size (5-200, default 30)\n"
+		"  --compactness M         shape regularity (0.1-100, default 20)\n"
+		"  --max-iterations N      maximum iterations for both (default 10)\n"
+		"  --repeat N              timed runs per configuration, the fastest counts (default 1)\n"
+		"  --boundary-tolerance R  boundary recall match distance in pixels (default 2)\n"
+		"  --synthetic WxH         also validate a generated image (color gradients, discs, transparent band)\n"
+		"thresholds (a failing image fails the run):\n"
+		"  --min-agreement F       label agreement, 0-1\n"
+		"  --min-boundary-recall F boundary recall, 0-1\n"
+		"  --max-undersegmentation F  undersegmentation error, 0-1\n"
+		"  --max-delta-e E         mean CIE76 color difference of the rendered result\n"
+		"  --min-speedup S         reference time / candidate time\n");
+}
+
+// --- Configurations ---
+
+struct ValidateConfig
+{
+	SLICKernel kernel;
+	SLICColorMode colorMode;
+	SLICIsa isa;
+	SLICEngine engine;
+	SLICAssignMode assignMode;
+	int threads;
+	double convergence;
+	double activeThreshold;
+	bool preview;
+	int hierarchy; // 1 = cut and refine, 2 = cut only
+	int warmShift; // > 0: WarmStart from the centers of a run on the image shifted by this many pixels
+	bool stream; // SLICStreamProcessor instead of SLICProcessor
+};
+
+static ValidateConfig DefaultConfig()
+{
+	ValidateConfig config = { kSLICKernelFloat, kSLICColorFast, kSLICIsaAuto, kSLICEngineSLIC, kSLICAssignClusters, 0, 0.5, 0.0, false, 0, 0, false };
+	return config;
+}
+
+// Applies "key=value,key=value" on top of config; false with a message on a bad entry
+static bool ParseConfig(const std::string& spec, ValidateConfig& config, std::string& error)
+{
+	size_t pos = 0;
+	while (pos < spec.size()) {
+		size_t comma = spec.find(',', pos);
+		if (comma == std::string::npos) comma = spec.size();
+		std::string item = spec.substr(pos, comma - pos);
+		pos = comma + 1;
+		size_t eq = item.find('=');
+		if (eq == std::string::npos) { error = "expected key=value: " + item; return false; }
+		std::string key = item.substr(0, eq);
+		std::string value = item.substr(eq + 1);
+		if (key == "kernel") {
+			if (!ParseKernel(value, config.kernel)) { error = "unknown kernel: " + value; return false; }
+		} else if (key == "color") {
+			if (value == "exact") config.colorMode = kSLICColorExact;
+			else if (value == "fast") config.colorMode = kSLICColorFast;
+			else { error = "unknown color mode: " + value; return false; }
+		} else if (key == "isa") {
+			if (!ParseIsa(value, config.isa)) { error = "unknown isa: " + value; return false; }
+		} else if (key == "engine") {
+			if (!ParseEngine(value, config.engine)) { error = "unknown engine: " + value; return false; }
+		} else if (key == "assign") {
+			if (!ParseAssignMode(value, config.assignMode)) { error = "unknown assignment order: " + value; return false; }
+		} else if (key == "threads") {
+			config.threads = atoi(value.c_str());
+		} else if (key == "convergence") {
+			config.convergence = atof(value.c_str());
+		} else if (key == "active") {
+			config.activeThreshold = atof(value.c_str());
+		} else if (key == "preview") {
+			config.preview = (value == "1");
+		} else if (key == "hierarchy") {
+			if (value == "0") config.hierarchy = 0;
+			else if (value == "1") config.hierarchy = 1;
+			else if (value == "raw") config.hierarchy = 2;
+			else { error = "unknown hierarchy mode: " + value; return false; }
+		} else if (key == "warm") {
+			config.warmShift = atoi(value.c_str());
+		} else if (key == "stream") {
+			config.stream = (value == "1");
+		} else {
+			error = "unknown key: " + key;
+			return false;
+		}
+	}
+	if (config.convergence < 0.0 || config.activeThreshold < 0.0) { error = "convergence and active must be >= 0"; return false; }
+	if (config.warmShift < 0) { error = "warm must be >= 0"; return false; }
+	if ((config.preview ? 1 : 0) + (config.hierarchy ? 1 : 0) + (config.warmShift ? 1 : 0) > 1) { error = "preview, hierarchy and warm do not combine"; return false; }
+	if (config.warmShift > 0 && config.engine == kSLICEngineSNIC) { error = "warm start needs engine=slic"; return false; }
+	if (config.stream && (config.engine != kSLICEngineSLIC || config.kernel != kSLICKernelFloat || config.assignMode != kSLICAssignClusters || config.activeThreshold > 0.0 ||
+		config.preview || config.hierarchy || config.warmShift)) {
+		error = "stream runs engine=slic, kernel=float, assign=clusters, active=0 only";
+		return false;
+	}
+	return true;
+}
+
+static std::string DescribeConfig(const ValidateConfig& config, const SLICThreadPool& threadPool, int cellSize)
+{
+	char text[320];
+	const char* kernelName = (config.kernel == kSLICKernelFloat) ? SLICIsaName(SLICResolveIsa(config.isa)) : KernelName(config.kernel);
+	char mode[64] = "";
+	if (config.preview) snprintf(mode, sizeof(mode), ", preview");
+	else if (config.hierarchy) snprintf(mode, sizeof(mode), ", hierarchy%s", (config.hierarchy == 2) ? " raw" : "");
+	else if (config.warmShift) snprintf(mode, sizeof(mode), ", warm start shifted by %d", config.warmShift);
+	else if (config.stream) snprintf(mode, sizeof(mode), ", streamed in %d row bands", SLICStreamProcessor::BandRows(cellSize));
+	snprintf(text, sizeof(text), "%s%s, kernel %s, %s color, %d threads, convergence %g, active %g%s", (config.engine == kSLICEngineSNIC) ? "snic" : "slic",
+		(config.engine == kSLICEngineSLIC && config.assignMode == kSLICAssignPixels) ? " (pixel order)" : "", kernelName,
+		(config.colorMode == kSLICColorExact) ? "exact" : "fast", threadPool.ThreadCount(), config.convergence, config.activeThreshold, mode);
+	return text;
+}
+
+// Result of one configuration on one image
+struct ValidateRun
+{
+	std::vector<int> labels; // -1 = unlabeled (transparent)
+	std::vector<BYTE> rgba; // rendered
+	double seconds; // fastest Initialize + Execute + Render (the warm start run on the shifted image is not timed)
+	long long unlabeled; // opaque pixels left without a label
+	int rowBytes; // of rgba
+};
+
+static void SetupProcessor(SLICProcessor& processor, const ValidateConfig& config, SLICThreadPool& threadPool, int maxIterations)
+{
+	processor.threadPool = &threadPool;
+	processor.kernel = config.kernel;
+	processor.colorMode = config.colorMode;
+	processor.isa = config.isa;
+	processor.engine = config.engine;
+	processor.assignMode = config.assignMode;
+	processor.maxIterations = maxIterations;
+	processor.convergenceThreshold = config.convergence;
+	processor.activeThreshold = config.activeThreshold;
+}
+
+// image moved right and down by shift pixels, edges repeated: the previous frame of a warm start
+static void ShiftImage(const SLICImage& image, int shift, SLICImage& shifted)
+{
+	shifted.width = image.width;
+	shifted.height = image.height;
+	shifted.rgba.resize(image.rgba.size());
+	for (int y = 0; y < image.height; y++) {
+		int sy = std::max(0, y - shift);
+		for (int x = 0; x < image.width; x++) {
+			int sx = std::max(0, x - shift);
+			memcpy(&shifted.rgba[((size_t)y * image.width + x) * 4], &image.rgba[((size_t)sy * image.width + sx) * 4], 4);
+		}
+	}
+}
+
+// Band access over run.rgba, rendered in place; the labels are collected into run.labels
+static const BYTE* ValidateReadRows(void* data, int y, int, int* pRowBytes)
+{
+	ValidateRun* pRun = static_cast<ValidateRun*>(data);
+	*pRowBytes = pRun->rowBytes;
+	return pRun->rgba.data() + (size_t)y * pRun->rowBytes;
+}
+
+static BYTE* ValidateBeginWriteRows(void* data, int y, int, int* pRowBytes)
+{
+	ValidateRun* pRun = static_cast<ValidateRun*>(data);
+	*pRowBytes = pRun->rowBytes;
+	return pRun->rgba.data() + (size_t)y * pRun->rowBytes;
+}
+
+static bool ValidateEndWriteRows(void*, int, int)
+{
+	return true;
+}
+
+static void ValidateLabelRows(void* data, int y, int rows, const int* labels)
+{
+	ValidateRun* pRun = static_cast<ValidateRun*>(data);
+	size_t width = (size_t)pRun->rowBytes / 4;
+	std::copy(labels, labels + (size_t)rows * width, pRun->labels.begin() + (size_t)y * width);
+}
+
+static void RunStream(const ValidateConfig& config, SLICThreadPool& threadPool, const SLICImage& image, int cellSize, double compactness, int maxIterations, int repeat, ValidateRun& run)
+{
+	run.seconds = 0.0;
+	run.rowBytes = image.RowBytes();
+	run.labels.resize((size_t)image.width * image.height);
+	for (int r = 0; r < repeat; r++) {
+		SLICStreamProcessor processor;
+		processor.threadPool = &threadPool;
+		processor.colorMode = config.colorMode;
+		processor.isa = config.isa;
+		processor.maxIterations = maxIterations;
+		processor.convergenceThreshold = config.convergence;
+		processor.pixelFormat = kSLICPixelRGBA;
+		run.rgba = image.rgba;
+		SLICStreamIO io = { &run, ValidateReadRows, ValidateBeginWriteRows, ValidateEndWriteRows, ValidateLabelRows };
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		processor.Execute(image.width, image.height, cellSize, compactness, &io, NULL, NULL, 0);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 || seconds < run.seconds) run.seconds = seconds;
+		run.unlabeled = processor.unlabeledPixels;
+	}
+}
+
+static void RunConfig(const ValidateConfig& config, SLICThreadPool& threadPool, const SLICImage& image, int cellSize, double compactness, int maxIterations, int repeat, ValidateRun& run)
+{
+	if (config.stream) {
+		RunStream(config, threadPool, image, cellSize, compactness, maxIterations, repeat, run);
+		return;
+	}
+	size_t pixels = (size_t)image.width * image.height;
+	run.seconds = 0.0;
+	run.unlabeled = 0;
+	run.rowBytes = image.RowBytes();
+	run.rgba.resize(pixels * 4);
+	std::vector<SlicCluster> warmCenters;
+	if (config.warmShift > 0) {
+		SLICImage previous;
+		ShiftImage(image, config.warmShift, previous);
+		SLICProcessor processor;
+		SetupProcessor(processor, config, threadPool, maxIterations);
+		processor.Initialize(previous.width, previous.height, previous.rgba.data(), previous.RowBytes(), kSLICPixelRGBA);
+		processor.Execute(cellSize, compactness, NULL, NULL, 0);
+		warmCenters = processor.clusters;
+	}
+	for (int r = 0; r < repeat; r++) {
+		SLICProcessor processor;
+		SetupProcessor(processor, config, threadPool, maxIterations);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		processor.Initialize(image.width, image.height, image.rgba.data(), image.RowBytes(), kSLICPixelRGBA);
+		int previewLevel = (config.preview && config.engine == kSLICEngineSLIC) ? processor.PreviewLevel(cellSize) : 0;
+		if (config.hierarchy) {
+			processor.BuildHierarchy(5, compactness, NULL, NULL, 0);
+			processor.CutHierarchy(cellSize, config.hierarchy == 1, NULL, NULL, 0);
+		} else if (config.warmShift > 0) {
+			processor.WarmStart(warmCenters, cellSize);
+			processor.Refine(cellSize, compactness, NULL, NULL, 0);
+		} else if (previewLevel > 0) {
+			processor.ExecutePreview(cellSize, compactness, previewLevel, NULL);
+			processor.Refine(cellSize, compactness, NULL, NULL, 0);
+		} else {
+			processor.Execute(cellSize, compactness, NULL, NULL, 0);
+		}
+		processor.Render(image.rgba.data(), image.RowBytes(), run.rgba.data(), image.RowBytes(), 0, 0, image.width, image.height);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 || seconds < run.seconds) run.seconds = seconds;
+
+		if (r == repeat - 1) {
+			run.unlabeled = processor.UnlabeledPixels();
+			run.labels.resize(pixels);
+			for (size_t i = 0; i < pixels; i++) {
+				if (processor.narrowLabels) run.labels[i] = (processor.labels16[i] == 0xFFFF) ? -1 : (int)processor.labels16[i];
+				else                        run.labels[i] = processor.labels[i];
+			}
+		}
+	}
+}
+
+// --- Synthetic input ---
+
+static const char* kSyntheticPrefix = "synthetic:";
+
+// Deterministic test image: a color gradient with discs of flat color and a little noise, a
+// transparent diagonal band with a few small opaque islands in it and a half transparent corner
+static void GenerateImage(int w, int h, SLICImage& image)
+{
+	image.width = w;
+	image.height = h;
+	image.rgba.resize((size_t)w * h * 4);
+	unsigned int seed = 12345u;
+	int radius = std::max(4, std::min(w, h) / 10);
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			seed = seed * 1664525u + 1013904223u;
+			int noise = (int)(seed >> 28) - 8;
+			int r = x * 255 / std::max(1, w - 1);
+			int g = y * 255 / std::max(1, h - 1);
+			int b = 128;
+			// discs on a 4x3 grid, colors from the cell index
+			int cx = (x * 4 / w) * w / 4 + w / 8;
+			int cy = (y * 3 / h) * h / 3 + h / 6;
+			int cell = (x * 4 / w) + (y * 3 / h) * 4;
+			if ((x - cx) * (x - cx) + (y - cy) * (y - cy) < radius * radius) {
+				r = (cell * 67) & 0xFF;
+				g = (cell * 151 + 40) & 0xFF;
+				b = (cell * 29 + 200) & 0xFF;
+			}
+			int alpha = 255;
+			int band = x * h - y * w; // zero on the diagonal
+			if (std::abs(band) < w * h / 8) {
+				// islands every 40 pixels along the band
+				bool island = ((x % 40) < 3) && ((y % 40) < 3);
+				alpha = island ? 255 : 0;
+			} else if (x > w * 7 / 8 && y > h * 7 / 8) {
+				alpha = 128;
+			}
+			BYTE* p = &image.rgba[((size_t)y * w + x) * 4];
+			p[0] = (BYTE)std::min(255, std::max(0, r + noise));
+			p[1] = (BYTE)std::min(255, std::max(0, g + noise));
+			p[2] = (BYTE)std::min(255, std::max(0, b + noise));
+			p[3] = (BYTE)alpha;
+		}
+	}
+}
+
+// A file, or "synthetic:WxH" from --synthetic
+static bool LoadSource(const std::string& name, SLICImage& image, std::string& error)
+{
+	if (name.compare(0, strlen(kSyntheticPrefix), kSyntheticPrefix) == 0) {
+		int w = 0, h = 0;
+		if (sscanf(name.c_str() + strlen(kSyntheticPrefix), "%dx%d", &w, &h) != 2 || w < 16 || h < 16 || w > 16384 || h > 16384) {
+			error = "bad synthetic image size: " + name.substr(strlen(kSyntheticPrefix));
+			return false;
+		}
+		GenerateImage(w, h, image);
+		return true;
+	}
+	return LoadImageFile(name, image, error);
+}
+
+// --- Metrics ---
+
+struct ValidateMetrics
+{
+	double agreement; // pixels whose candidate label is the best overlap of their reference segment
+	double boundaryRecall; // reference boundary pixels with a candidate boundary within the tolerance
+	double undersegmentation; // corrected undersegmentation error (Neubert & Protzel)
+	double meanDeltaE, maxDeltaE; // CIE76 between the rendered results, opaque pixels
+	double speedup;
+	long long unlabeled; // opaque pixels the reference or the candidate left unlabeled; fails the image when non-zero
+};
+
+static bool IsBoundary(const std::vector<int>& labels, int w, int h, int x, int y)
+{
+	size_t idx = (size_t)y * w + x;
+	int label = labels[idx];
+	if (label < 0) return false;
+	if (x + 1 < w && labels[idx + 1] != label) return true;
+	if (y + 1 < h && labels[idx + w] != label) return true;
+	return false;
+}
+
+static ValidateMetrics Compare(const SLICImage& image, const ValidateRun& reference, const ValidateRun& candidate, int tolerance)
+{
+	int w = image.width;
+	int h = image.height;
+	size_t pixels = (size_t)w * h;
+	ValidateMetrics metrics;
+
+	// Overlap table of (reference, candidate) label pairs
+	std::unordered_map<unsigned long long, long long> overlap;
+	std::unordered_map<int, long long> candidateSize;
+	long long labeled = 0;
+	for (size_t i = 0; i < pixels; i++) {
+		int r = reference.labels[i];
+		int c = candidate.labels[i];
+		if (r < 0 || c < 0) continue;
+		overlap[((unsigned long long)(unsigned int)r << 32) | (unsigned int)c]++;
+		candidateSize[c]++;
+		labeled++;
+	}
+	std::unordered_map<int, long long> bestOverlap;
+	double undersegmentation = 0.0;
+	for (std::unordered_map<unsigned long long, long long>::const_iterator it = overlap.begin(); it != overlap.end(); ++it) {
+		int r = (int)(it->first >> 32);
+		int c = (int)(it->first & 0xFFFFFFFFu);
+		long long& best = bestOverlap[r];
+		best = std::max(best, it->second);
+		undersegmentation += (double)std::min(it->second, candidateSize[c] - it->second);
+	}
+	long long agreed = 0;
+	for (std::unordered_map<int, long long>::const_iterator it = bestOverlap.begin(); it != bestOverlap.end(); ++it) agreed += it->second;
+	metrics.agreement = (labeled > 0) ? (double)agreed / labeled : 1.0;
+	metrics.undersegmentation = (labeled > 0) ? undersegmentation / labeled : 0.0;
+
+	long long boundaries = 0, recalled = 0;
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			if (!IsBoundary(reference.labels, w, h, x, y)) continue;
+			boundaries++;
+			bool found = false;
+			for (int ny = std::max(0, y - tolerance); ny <= std::min(h - 1, y + tolerance) && !found; ny++) {
+				for (int nx = std::max(0, x - tolerance); nx <= std::min(w - 1, x + tolerance); nx++) {
+					if (IsBoundary(candidate.labels, w, h, nx, ny)) { found = true; break; }
+				}
+			}
+			if (found) recalled++;
+		}
+	}
+	metrics.boundaryRecall = (boundaries > 0) ? (double)recalled / boundaries : 1.0;
+
+	double sumDeltaE = 0.0;
+	long long opaque = 0;
+	metrics.maxDeltaE = 0.0;
+	for (size_t i = 0; i < pixels; i++) {
+		const BYTE* a = &reference.rgba[i * 4];
+		const BYTE* b = &candidate.rgba[i * 4];
+		if (image.rgba[i * 4 + 3] == 0) continue;
+		double l1, a1, b1, l2, a2, b2;
+		RGB2LAB(a[0], a[1], a[2], l1, a1, b1);
+		RGB2LAB(b[0], b[1], b[2], l2, a2, b2);
+		double deltaE = std::sqrt((l1 - l2) * (l1 - l2) + (a1 - a2) * (a1 - a2) + (b1 - b2) * (b1 - b2));
+		sumDeltaE += deltaE;
+		metrics.maxDeltaE = std::max(metrics.maxDeltaE, deltaE);
+		opaque++;
+	}
+	metrics.meanDeltaE = (opaque > 0) ? sumDeltaE / opaque : 0.0;
+	metrics.speedup = (candidate.seconds > 0.0) ? reference.seconds / candidate.seconds : 0.0;
+	metrics.unlabeled = reference.unlabeled + candidate.unlabeled;
+	return metrics;
+}
+
+// --- Thresholds ---
+
+struct ValidateThresholds
+{
+	double minAgreement, minBoundaryRecall, maxUndersegmentation, maxDeltaE, minSpeedup; // < 0 = unset
+};
+
+// Appends the failed checks to failures; true when every set threshold holds and every opaque pixel is labeled
+static bool Check(const ValidateMetrics& metrics, const ValidateThresholds& thresholds, std::string& failures)
+{
+	char text[128];
+	if (metrics.unlabeled > 0) {
+		snprintf(text, sizeof(text), " %lld opaque pixels unlabeled;", metrics.unlabeled);
+		failures += text;
+	}
+	if (thresholds.minAgreement >= 0.0 && metrics.agreement < thresholds.minAgreement) {
+		snprintf(text, sizeof(text), " agreement %.4f < %.4f;", metrics.agreement, thresholds.minAgreement);
+		failures += text;
+	}
+	if (thresholds.minBoundaryRecall >= 0.0 && metrics.boundaryRecall < thresholds.minBoundaryRecall) {
+		snprintf(text, sizeof(text), " boundary recall %.4f < %.4f;", metrics.boundaryRecall, thresholds.minBoundaryRecall);
+		failures += text;
+	}
+	if (thresholds.maxUndersegmentation >= 0.0 && metrics.undersegmentation > thresholds.maxUndersegmentation) {
+		snprintf(text, sizeof(text), " undersegmentation %.4f > %.4f;", metrics.undersegmentation, thresholds.maxUndersegmentation);
+		failures += text;
+	}
+	if (thresholds.maxDeltaE >= 0.0 && metrics.meanDeltaE > thresholds.maxDeltaE) {
+		snprintf(text, sizeof(text), " mean dE %.3f > %.3f;", metrics.meanDeltaE, thresholds.maxDeltaE);
+		failures += text;
+	}
+	if (thresholds.minSpeedup >= 0.0 && metrics.speedup < thresholds.minSpeedup) {
+		snprintf(text, sizeof(text), " speedup %.2f < %.2f;", metrics.speedup, thresholds.minSpeedup);
+		failures += text;
+	}
+	return failures.empty();
+}
+
+int main(int argc, char** argv)
+{
+	ValidateConfig referenceConfig = DefaultConfig();
+	referenceConfig.kernel = kSLICKernelReference;
+	referenceConfig.colorMode = kSLICColorExact;
+	referenceConfig.threads = 1;
+	referenceConfig.convergence = 0.0;
+	ValidateConfig candidateConfig = DefaultConfig();
+	candidateConfig.activeThreshold = 0.5; // as the filter's default
+	candidateConfig.assignMode = kSLICAssignPixels;
+	int cellSize = 30;
+	double compactness = 20.0;
+	int maxIterations = 10;
+	int repeat = 1;
+	int tolerance = 2;
+	ValidateThresholds thresholds = { -1.0, -1.0, -1.0, -1.0, -1.0 };
+	std::vector<std::string> imagePaths;
+	std::string error;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--reference" && i + 1 < argc) {
+			if (!ParseConfig(argv[++i], referenceConfig, error)) { fprintf(stderr, "--reference: %s\n", error.c_str()); return 2; }
+		} else if (arg == "--candidate" && i + 1 < argc) {
+			if (!ParseConfig(argv[++i], candidateConfig, error)) { fprintf(stderr, "--candidate: %s\n", error.c_str()); return 2; }
+		} else if (arg == "--cell-size" && i + 1 < argc) {
+			cellSize = atoi(argv[++i]);
+		} else if (arg == "--compactness" && i + 1 < argc) {
+			compactness = atof(argv[++i]);
+		} else if (arg == "--max-iterations" && i + 1 < argc) {
+			maxIterations = atoi(argv[++i]);
+		} else if (arg == "--repeat" && i + 1 < argc) {
+			repeat = atoi(argv[++i]);
+		} else if (arg == "--boundary-tolerance" && i + 1 < argc) {
+			tolerance = atoi(argv[++i]);
+		} else if (arg == "--synthetic" && i + 1 < argc) {
+			imagePaths.push_back(std::string(kSyntheticPrefix) + argv[++i]);
+		} else if (arg == "--min-agreement" && i + 1 < argc) {
+			thresholds.minAgreement = atof(argv[++i]);
+		} else if (arg == "--min-boundary-recall" && i + 1 < argc) {
+			thresholds.minBoundaryRecall = atof(argv[++i]);
+		} else if (arg == "--max-undersegmentation" && i + 1 < argc) {
+			thresholds.maxUndersegmentation = atof(argv[++i]);
+		} else if (arg == "--max-delta-e" && i + 1 < argc) {
+			thresholds.maxDeltaE = atof(argv[++i]);
+		} else if (arg == "--min-speedup" && i + 1 < argc) {
+			thresholds.minSpeedup = atof(argv[++i]);
+		} else if (arg == "-h" || arg == "--help") {
+			PrintUsage();
+			return 0;
+		} else if (!arg.empty() && arg[0] == '-') {
+			fprintf(stderr, "unknown option: %s\n", arg.c_str());
+			PrintUsage();
+			return 2;
+		} else {
+			imagePaths.push_back(arg);
+		}
+	}
+	if (imagePaths.empty()) {
+		PrintUsage();
+		return 2;
+	}
+	if (cellSize < 5 || cellSize > 200 || compactness < 0.1 || compactness > 100.0 || maxIterations < 1 || repeat < 1 || tolerance < 0) {
+		fprintf(stderr, "parameter out of range (cell size 5-200, compactness 0.1-100, iterations >= 1, repeat >= 1, tolerance >= 0)\n");
+		return 2;
+	}
+
+	SLICThreadPool referencePool(referenceConfig.threads);
+	SLICThreadPool candidatePool(candidateConfig.threads);
+	printf("reference: %s\n", DescribeConfig(referenceConfig, referencePool, cellSize).c_str());
+	printf("candidate: %s\n", DescribeConfig(candidateConfig, candidatePool, cellSize).c_str());
+	printf("cell size %d, compactness %g, max iterations %d, boundary tolerance %d\n\n", cellSize, compactness, maxIterations, tolerance);
+	printf("%-32s %9s %9s %9s %8s %8s %8s %9s  %s\n", "image", "agree", "b.recall", "underseg", "mean dE", "max dE", "speedup", "unlabeled", "result");
+
+	ValidateMetrics total = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0 };
+	double referenceSeconds = 0.0, candidateSeconds = 0.0;
+	int failed = 0;
+	for (size_t n = 0; n < imagePaths.size(); n++) {
+		SLICImage image;
+		if (!LoadSource(imagePaths[n], image, error)) {
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		ValidateRun reference, candidate;
+		RunConfig(referenceConfig, referencePool, image, cellSize, compactness, maxIterations, repeat, reference);
+		RunConfig(candidateConfig, candidatePool, image, cellSize, compactness, maxIterations, repeat, candidate);
+		ValidateMetrics metrics = Compare(image, reference, candidate, tolerance);
+
+		std::string failures;
+		bool ok = Check(metrics, thresholds, failures);
+		if (!ok) failed++;
+		printf("%-32s %9.4f %9.4f %9.4f %8.3f %8.2f %8.2f %9lld  %s%s\n", imagePaths[n].c_str(), metrics.agreement, metrics.boundaryRecall, metrics.undersegmentation,
+			metrics.meanDeltaE, metrics.maxDeltaE, metrics.speedup, metrics.unlabeled, ok ? "ok" : "FAIL:", failures.c_str());
+		fflush(stdout);
+
+		total.agreement += metrics.agreement;
+		total.boundaryRecall += metrics.boundaryRecall;
+		total.undersegmentation += metrics.undersegmentation;
+		total.meanDeltaE += metrics.meanDeltaE;
+		total.maxDeltaE = std::max(total.maxDeltaE, metrics.maxDeltaE);
+		total.unlabeled += metrics.unlabeled;
+		referenceSeconds += reference.seconds;
+		candidateSeconds += candidate.seconds;
+	}
+
+	// Means over the images; the speedup is over the total time
+	double count = (double)imagePaths.size();
+	printf("%-32s %9.4f %9.4f %9.4f %8.3f %8.2f %8.2f %9lld\n", "mean", total.agreement / count, total.boundaryRecall / count, total.undersegmentation / count,
+		total.meanDeltaE / count, total.maxDeltaE, (candidateSeconds > 0.0) ? referenceSeconds / candidateSeconds : 0.0, total.unlabeled);
+	printf("reference %.1f ms, candidate %.1f ms\n", referenceSeconds * 1000.0, candidateSeconds * 1000.0);
+	if (failed > 0) {
+		printf("%d of %zu images below the thresholds or with unlabeled pixels\n", failed, imagePaths.size());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,603 @@
+//! Stub TriglavPlugIn host
+//! Loads an image, then drives the real TriglavPluginCall entry point of PISLICMain.cpp through
+//! ModuleInitialize -> FilterInitialize -> FilterRun -> FilterTerminate -> ModuleTerminate, with
+//! in-memory offscreens, bitmaps, strings and properties. Only the procs the SLIC filter uses are
+//! implemented; the rest stay NULL. Needs the TriglavPlugIn SDK headers (TRIGLAV_SDK_DIR).
+//!   slic_stubhost [--cell-size N] [--compactness M] [--layer rgba|bgra|gray] [--restart-compactness M2] [--runs N] input.png output.png
+//! --restart-cell-sizes N1,N2,... moves the cell size slider after each finished pass, timing every pass.
+#include "TriglavPlugInSDK/TriglavPlugInSDK.h"
+#include "SLICImageIO.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+
+// Must match kItemKeyCellSize / kItemKeyCompactness in PISLICMain.cpp
+static const TriglavPlugInInt kStubItemKeyCellSize = 1;
+static const TriglavPlugInInt kStubItemKeyCompactness = 2;
+static const TriglavPlugInInt kStubItemKeyEngine = 6;
+static const TriglavPlugInInt kStubItemKeyActiveSet = 7;
+static const TriglavPlugInInt kStubItemKeyHierarchy = 8;
+
+void TRIGLAV_PLUGIN_API TriglavPluginCall(TriglavPlugInInt* result, TriglavPlugInPtr* data, TriglavPlugInInt selector, TriglavPlugInServer* pluginServer, TriglavPlugInPtr reserved);
+
+// --- Stub objects ---
+
+struct StubString { std::string text; TriglavPlugInInt stringID; };
+
+struct StubPropertyItem
+{
+	TriglavPlugInInt valueType;
+	TriglavPlugInInt integerValue;
+	TriglavPlugInDouble decimalValue;
+};
+
+struct StubProperty { std::map<TriglavPlugInInt, StubPropertyItem> items; int refCount; };
+
+struct StubBitmap
+{
+	TriglavPlugInInt width, height, depth;
+	std::vector<BYTE> pixels;
+};
+
+// Pixels are kept in the layer's layout: gray + alpha for a gray layer, RGBA in the channel
+// order getRGBChannelIndexProc reports for a color layer
+struct StubOffscreen
+{
+	TriglavPlugInRect extent;
+	SLICImage image; // size of the layer; the pixels are in packed
+	SLICPixelFormat format;
+	std::vector<BYTE> packed;
+	int readCount; // getBitmapProc calls
+};
+
+struct StubHost
+{
+	StubOffscreen source;
+	StubOffscreen destination;
+	TriglavPlugInRect selectArea;
+	StubProperty* pProperty;
+	TriglavPlugInPropertyCallBackProc propertyCallBack;
+	TriglavPlugInPtr propertyCallBackData;
+	TriglavPlugInInt progressTotal;
+	TriglavPlugInInt progressDone;
+	TriglavPlugInInt processCalls;
+	TriglavPlugInInt restartAtCall;
+	TriglavPlugInDouble restartCompactness;
+	std::vector<TriglavPlugInInt> restartCellSizes; // still to apply, one per finished pass
+	std::chrono::steady_clock::time_point passStart;
+	TriglavPlugInInt updateCount;
+};
+
+static StubHost* Host(TriglavPlugInHostObject hostObject) { return reinterpret_cast<StubHost*>(hostObject); }
+template <class T> static T* Stub(void* object) { return reinterpret_cast<T*>(object); }
+
+// --- Module initialize record ---
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubGetHostVersion(TriglavPlugInInt* hostVersion, TriglavPlugInHostObject)
+{
+	*hostVersion = kTriglavPlugInNeedHostVersion;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubSetModuleID(TriglavPlugInHostObject, TriglavPlugInStringObject moduleID)
+{
+	fprintf(stderr, "module id: %s\n", Stub<StubString>(moduleID)->text.c_str());
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubSetModuleKind(TriglavPlugInHostObject, TriglavPlugInInt)
+{
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+// --- Filter initialize record ---
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubSetName(TriglavPlugInHostObject, TriglavPlugInStringObject, TriglavPlugInChar)
+{
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubSetCanPreview(TriglavPlugInHostObject, TriglavPlugInBool)
+{
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubSetTargetKinds(TriglavPlugInHostObject, const TriglavPlugInInt*, TriglavPlugInInt)
+{
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubSetProperty(TriglavPlugInHostObject hostObject, TriglavPlugInPropertyObject propertyObject)
+{
+	StubProperty* pProperty = Stub<StubProperty>(propertyObject);
+	pProperty->refCount++;
+	Host(hostObject)->pProperty = pProperty;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubSetPropertyCallBack(TriglavPlugInHostObject hostObject, TriglavPlugInPropertyCallBackProc proc, TriglavPlugInPtr data)
+{
+	Host(hostObject)->propertyCallBack = proc;
+	Host(hostObject)->propertyCallBackData = data;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+// --- Filter run record ---
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubGetProperty(TriglavPlugInPropertyObject* propertyObject, TriglavPlugInHostObject hostObject)
+{
+	*propertyObject = reinterpret_cast<TriglavPlugInPropertyObject>(Host(hostObject)->pProperty);
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubGetSourceOffscreen(TriglavPlugInOffscreenObject* offscreenObject, TriglavPlugInHostObject hostObject)
+{
+	*offscreenObject = reinterpret_cast<TriglavPlugInOffscreenObject>(&Host(hostObject)->source);
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubGetDestinationOffscreen(TriglavPlugInOffscreenObject* offscreenObject, TriglavPlugInHostObject hostObject)
+{
+	*offscreenObject = reinterpret_cast<TriglavPlugInOffscreenObject>(&Host(hostObject)->destination);
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubGetSelectAreaRect(TriglavPlugInRect* rect, TriglavPlugInHostObject hostObject)
+{
+	*rect = Host(hostObject)->selectArea;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubUpdateDestinationOffscreenRect(TriglavPlugInHostObject hostObject, const TriglavPlugInRect*)
+{
+	Host(hostObject)->updateCount++;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubSetProgressTotal(TriglavPlugInHostObject hostObject, TriglavPlugInInt total)
+{
+	Host(hostObject)->progressTotal = total;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubSetProgressDone(TriglavPlugInHostObject hostObject, TriglavPlugInInt done)
+{
+	StubHost* pHost = Host(hostObject);
+	pHost->progressDone = done;
+	fprintf(stderr, "\rprogress %d/%d", done, pHost->progressTotal);
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+// Simulates a slider change at the requested poll: the property is modified, the filter's
+// property callback is notified and the run is told to restart.
+static void StubChangeProperty(StubHost* pHost, TriglavPlugInInt itemKey)
+{
+	if (pHost->propertyCallBack == NULL) return;
+	TriglavPlugInInt callBackResult = 0;
+	pHost->propertyCallBack(&callBackResult, reinterpret_cast<TriglavPlugInPropertyObject>(pHost->pProperty), itemKey, kTriglavPlugInPropertyCallBackNotifyValueChanged, pHost->propertyCallBackData);
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubProcess(TriglavPlugInInt* result, TriglavPlugInHostObject hostObject, TriglavPlugInInt processState)
+{
+	StubHost* pHost = Host(hostObject);
+	*result = kTriglavPlugInFilterRunProcessResultContinue;
+	if (processState == kTriglavPlugInFilterRunProcessStateStart) pHost->passStart = std::chrono::steady_clock::now();
+	if (processState == kTriglavPlugInFilterRunProcessStateEnd) {
+		*result = kTriglavPlugInFilterRunProcessResultExit;
+		if (!pHost->restartCellSizes.empty()) {
+			// The pass finished and its result is shown; the user moves the cell size slider
+			double passMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pHost->passStart).count();
+			TriglavPlugInInt cellSize = pHost->restartCellSizes.front();
+			pHost->restartCellSizes.erase(pHost->restartCellSizes.begin());
+			fprintf(stderr, "\nstub: pass took %.1f ms, cell size -> %d, restarting\n", passMs, cellSize);
+			pHost->pProperty->items[kStubItemKeyCellSize].integerValue = cellSize;
+			StubChangeProperty(pHost, kStubItemKeyCellSize);
+			*result = kTriglavPlugInFilterRunProcessResultRestart;
+		}
+		return kTriglavPlugInAPIResultSuccess;
+	}
+	pHost->processCalls++;
+	if (pHost->restartAtCall > 0 && pHost->processCalls == pHost->restartAtCall) {
+		fprintf(stderr, "\nstub: compactness -> %g, restarting\n", pHost->restartCompactness);
+		pHost->pProperty->items[kStubItemKeyCompactness].decimalValue = pHost->restartCompactness;
+		StubChangeProperty(pHost, kStubItemKeyCompactness);
+		*result = kTriglavPlugInFilterRunProcessResultRestart;
+	}
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+// --- String service ---
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubStringCreateWithAscii(TriglavPlugInStringObject* stringObject, const TriglavPlugInChar* text, TriglavPlugInInt length)
+{
+	StubString* pString = new StubString;
+	pString->text.assign(reinterpret_cast<const char*>(text), (size_t)length);
+	pString->stringID = 0;
+	*stringObject = reinterpret_cast<TriglavPlugInStringObject>(pString);
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubStringCreateWithID(TriglavPlugInStringObject* stringObject, TriglavPlugInInt stringID, TriglavPlugInHostObject)
+{
+	StubString* pString = new StubString;
+	pString->text = "string#" + std::to_string(stringID);
+	pString->stringID = stringID;
+	*stringObject = reinterpret_cast<TriglavPlugInStringObject>(pString);
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubStringRelease(TriglavPlugInStringObject stringObject)
+{
+	delete Stub<StubString>(stringObject);
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+// --- Property service ---
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubPropertyCreate(TriglavPlugInPropertyObject* propertyObject)
+{
+	StubProperty* pProperty = new StubProperty;
+	pProperty->refCount = 1;
+	*propertyObject = reinterpret_cast<TriglavPlugInPropertyObject>(pProperty);
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubPropertyRelease(TriglavPlugInPropertyObject propertyObject)
+{
+	StubProperty* pProperty = Stub<StubProperty>(propertyObject);
+	if (--pProperty->refCount == 0) delete pProperty;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubPropertyAddItem(TriglavPlugInPropertyObject propertyObject, TriglavPlugInInt itemKey, TriglavPlugInInt valueType, TriglavPlugInInt, TriglavPlugInInt, TriglavPlugInStringObject, TriglavPlugInChar)
+{
+	StubPropertyItem item = { valueType, 0, 0.0 };
+	Stub<StubProperty>(propertyObject)->items[itemKey] = item;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubPropertySetInteger(TriglavPlugInPropertyObject propertyObject, TriglavPlugInInt itemKey, TriglavPlugInInt value)
+{
+	Stub<StubProperty>(propertyObject)->items[itemKey].integerValue = value;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubPropertySetIntegerIgnored(TriglavPlugInPropertyObject, TriglavPlugInInt, TriglavPlugInInt)
+{
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubPropertyGetInteger(TriglavPlugInInt* value, TriglavPlugInPropertyObject propertyObject, TriglavPlugInInt itemKey)
+{
+	*value = Stub<StubProperty>(propertyObject)->items[itemKey].integerValue;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubPropertySetDecimal(TriglavPlugInPropertyObject propertyObject, TriglavPlugInInt itemKey, TriglavPlugInDouble value)
+{
+	Stub<StubProperty>(propertyObject)->items[itemKey].decimalValue = value;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubPropertySetDecimalIgnored(TriglavPlugInPropertyObject, TriglavPlugInInt, TriglavPlugInDouble)
+{
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubPropertyGetDecimal(TriglavPlugInDouble* value, TriglavPlugInPropertyObject propertyObject, TriglavPlugInInt itemKey)
+{
+	*value = Stub<StubProperty>(propertyObject)->items[itemKey].decimalValue;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubPropertyAddEnumerationItem(TriglavPlugInPropertyObject, TriglavPlugInInt, TriglavPlugInInt, TriglavPlugInStringObject, TriglavPlugInChar)
+{
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+// --- Bitmap service ---
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubBitmapCreate(TriglavPlugInBitmapObject* bitmapObject, TriglavPlugInInt width, TriglavPlugInInt height, TriglavPlugInInt depth, TriglavPlugInInt)
+{
+	StubBitmap* pBitmap = new StubBitmap;
+	pBitmap->width = width;
+	pBitmap->height = height;
+	pBitmap->depth = depth;
+	pBitmap->pixels.assign((size_t)width * height * depth, 0);
+	*bitmapObject = reinterpret_cast<TriglavPlugInBitmapObject>(pBitmap);
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubBitmapRelease(TriglavPlugInBitmapObject bitmapObject)
+{
+	delete Stub<StubBitmap>(bitmapObject);
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubBitmapGetAddress(TriglavPlugInPtr* address, TriglavPlugInBitmapObject bitmapObject, const TriglavPlugInPoint* pos)
+{
+	StubBitmap* pBitmap = Stub<StubBitmap>(bitmapObject);
+	*address = pBitmap->pixels.data() + ((size_t)pos->y * pBitmap->width + pos->x) * pBitmap->depth;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubBitmapGetRowBytes(TriglavPlugInInt* rowBytes, TriglavPlugInBitmapObject bitmapObject)
+{
+	*rowBytes = Stub<StubBitmap>(bitmapObject)->width * Stub<StubBitmap>(bitmapObject)->depth;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubBitmapGetPixelBytes(TriglavPlugInInt* pixelBytes, TriglavPlugInBitmapObject bitmapObject)
+{
+	*pixelBytes = Stub<StubBitmap>(bitmapObject)->depth;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+// --- Offscreen service ---
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubOffscreenGetExtentRect(TriglavPlugInRect* rect, TriglavPlugInOffscreenObject offscreenObject)
+{
+	*rect = Stub<StubOffscreen>(offscreenObject)->extent;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+// The bitmap must have the depth of the layer's pixels
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubOffscreenGetBitmap(TriglavPlugInBitmapObject bitmapObject, const TriglavPlugInPoint* bitmapPos, TriglavPlugInOffscreenObject offscreenObject, const TriglavPlugInPoint* offscreenPos, TriglavPlugInInt width, TriglavPlugInInt height, TriglavPlugInInt)
+{
+	StubBitmap* pBitmap = Stub<StubBitmap>(bitmapObject);
+	StubOffscreen* pOffscreen = Stub<StubOffscreen>(offscreenObject);
+	int depth = SLICPixelBytes(pOffscreen->format);
+	if (pBitmap->depth != depth) return kTriglavPlugInAPIResultFailed;
+	pOffscreen->readCount++;
+	for (TriglavPlugInInt y = 0; y < height; y++) {
+		const BYTE* src = pOffscreen->packed.data() + ((size_t)(offscreenPos->y - pOffscreen->extent.top + y) * pOffscreen->image.width + (offscreenPos->x - pOffscreen->extent.left)) * depth;
+		BYTE* dst = pBitmap->pixels.data() + ((size_t)(bitmapPos->y + y) * pBitmap->width + bitmapPos->x) * depth;
+		memcpy(dst, src, (size_t)width * depth);
+	}
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubOffscreenSetBitmap(TriglavPlugInOffscreenObject offscreenObject, const TriglavPlugInPoint* offscreenPos, TriglavPlugInBitmapObject bitmapObject, const TriglavPlugInPoint* bitmapPos, TriglavPlugInInt width, TriglavPlugInInt height, TriglavPlugInInt)
+{
+	StubBitmap* pBitmap = Stub<StubBitmap>(bitmapObject);
+	StubOffscreen* pOffscreen = Stub<StubOffscreen>(offscreenObject);
+	int depth = SLICPixelBytes(pOffscreen->format);
+	if (pBitmap->depth != depth) return kTriglavPlugInAPIResultFailed;
+	for (TriglavPlugInInt y = 0; y < height; y++) {
+		BYTE* dst = pOffscreen->packed.data() + ((size_t)(offscreenPos->y - pOffscreen->extent.top + y) * pOffscreen->image.width + (offscreenPos->x - pOffscreen->extent.left)) * depth;
+		const BYTE* src = pBitmap->pixels.data() + ((size_t)(bitmapPos->y + y) * pBitmap->width + bitmapPos->x) * depth;
+		memcpy(dst, src, (size_t)width * depth);
+	}
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubOffscreenGetChannelOrder(TriglavPlugInInt* channelOrder, TriglavPlugInOffscreenObject offscreenObject)
+{
+	bool gray = SLICPixelIsGray(Stub<StubOffscreen>(offscreenObject)->format);
+	*channelOrder = gray ? kTriglavPlugInOffscreenChannelOrderGrayAlpha : kTriglavPlugInOffscreenChannelOrderRGBAlpha;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static TriglavPlugInAPIResult TRIGLAV_PLUGIN_CALLBACK StubOffscreenGetRGBChannelIndex(TriglavPlugInInt* redChannelIndex, TriglavPlugInInt* greenChannelIndex, TriglavPlugInInt* blueChannelIndex, TriglavPlugInOffscreenObject offscreenObject)
+{
+	bool bgra = (Stub<StubOffscreen>(offscreenObject)->format == kSLICPixelBGRA);
+	*redChannelIndex = bgra ? 2 : 0;
+	*greenChannelIndex = 1;
+	*blueChannelIndex = bgra ? 0 : 2;
+	return kTriglavPlugInAPIResultSuccess;
+}
+
+static void PrintUsage()
+{
+	fprintf(stderr, "usage: slic_stubhost [--cell-size N] [--compactness M] [--engine slic|snic] [--no-active-set] [--hierarchy] [--select X,Y,W,H] [--layer rgba|bgra|gray] [--restart-compactness M2 [--restart-at POLL]] [--restart-cell-sizes N1,N2,...] [--runs N] <input> <output>\n");
+}
+
+int main(int argc, char** argv)
+{
+	TriglavPlugInInt cellSize = 30;
+	TriglavPlugInDouble compactness = 20.0;
+	TriglavPlugInDouble restartCompactness = -1.0;
+	TriglavPlugInInt restartAt = 3;
+	int runs = 1; // FilterRun calls in a row, as when the filter is applied again
+	TriglavPlugInInt engine = 0;
+	TriglavPlugInBool activeSet = true;
+	TriglavPlugInBool hierarchy = false;
+	std::vector<TriglavPlugInInt> restartCellSizes;
+	int select[4] = { 0, 0, -1, -1 };
+	SLICPixelFormat layerFormat = kSLICPixelRGBA;
+	std::string inputPath, outputPath;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--cell-size" && i + 1 < argc) cellSize = atoi(argv[++i]);
+		else if (arg == "--compactness" && i + 1 < argc) compactness = atof(argv[++i]);
+		else if (arg == "--engine" && i + 1 < argc) {
+			SLICEngine value = kSLICEngineSLIC;
+			if (!ParseEngine(argv[++i], value)) { PrintUsage(); return 2; }
+			engine = (value == kSLICEngineSNIC) ? 1 : 0;
+		}
+		else if (arg == "--no-active-set") activeSet = false;
+		else if (arg == "--hierarchy") hierarchy = true;
+		else if (arg == "--restart-cell-sizes" && i + 1 < argc) {
+			const char* p = argv[++i];
+			while (true) {
+				char* end = NULL;
+				long value = strtol(p, &end, 10);
+				if (end == p || (*end != ',' && *end != '\0')) { PrintUsage(); return 2; }
+				restartCellSizes.push_back((TriglavPlugInInt)value);
+				if (*end == '\0') break;
+				p = end + 1;
+			}
+		}
+		else if (arg == "--restart-compactness" && i + 1 < argc) restartCompactness = atof(argv[++i]);
+		else if (arg == "--restart-at" && i + 1 < argc) restartAt = atoi(argv[++i]);
+		else if (arg == "--runs" && i + 1 < argc) runs = std::max(1, atoi(argv[++i]));
+		else if (arg == "--layer" && i + 1 < argc) {
+			if (!ParsePixelFormat(argv[++i], layerFormat) || layerFormat == kSLICPixelRGB) { PrintUsage(); return 2; }
+		}
+		else if (arg == "--select" && i + 1 < argc) {
+			if (sscanf(argv[++i], "%d,%d,%d,%d", &select[0], &select[1], &select[2], &select[3]) != 4) { PrintUsage(); return 2; }
+		}
+		else if (inputPath.empty() && arg[0] != '-') inputPath = arg;
+		else if (outputPath.empty() && arg[0] != '-') outputPath = arg;
+		else { PrintUsage(); return 2; }
+	}
+	if (inputPath.empty() || outputPath.empty()) { PrintUsage(); return 2; }
+
+	StubHost host;
+	std::string error;
+	if (!LoadImageFile(inputPath, host.source.image, error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	TriglavPlugInRect extent = { 0, 0, host.source.image.width, host.source.image.height };
+	host.source.extent = extent;
+	host.source.format = layerFormat;
+	PackPixels(host.source.image, layerFormat, host.source.packed);
+	host.source.readCount = 0;
+	host.destination = host.source;
+	// Without --select the whole layer is selected
+	TriglavPlugInRect selectArea = { select[0], select[1], select[0] + select[2], select[1] + select[3] };
+	host.selectArea = (select[2] < 0) ? extent : selectArea;
+	host.pProperty = NULL;
+	host.propertyCallBack = NULL;
+	host.propertyCallBackData = NULL;
+	host.progressTotal = 0;
+	host.progressDone = 0;
+	host.processCalls = 0;
+	host.restartAtCall = (restartCompactness > 0.0) ? restartAt : 0;
+	host.restartCompactness = restartCompactness;
+	host.restartCellSizes = restartCellSizes;
+	host.passStart = std::chrono::steady_clock::now();
+	host.updateCount = 0;
+
+	TriglavPlugInModuleInitializeRecord moduleInitializeRecord;
+	memset(&moduleInitializeRecord, 0, sizeof(moduleInitializeRecord));
+	moduleInitializeRecord.getHostVersionProc = StubGetHostVersion;
+	moduleInitializeRecord.setModuleIDProc = StubSetModuleID;
+	moduleInitializeRecord.setModuleKindProc = StubSetModuleKind;
+
+	TriglavPlugInFilterInitializeRecord filterInitializeRecord;
+	memset(&filterInitializeRecord, 0, sizeof(filterInitializeRecord));
+	filterInitializeRecord.setFilterCategoryNameProc = StubSetName;
+	filterInitializeRecord.setFilterNameProc = StubSetName;
+	filterInitializeRecord.setCanPreviewProc = StubSetCanPreview;
+	filterInitializeRecord.setTargetKindsProc = StubSetTargetKinds;
+	filterInitializeRecord.setPropertyProc = StubSetProperty;
+	filterInitializeRecord.setPropertyCallBackProc = StubSetPropertyCallBack;
+
+	TriglavPlugInFilterRunRecord filterRunRecord;
+	memset(&filterRunRecord, 0, sizeof(filterRunRecord));
+	filterRunRecord.getPropertyProc = StubGetProperty;
+	filterRunRecord.getSourceOffscreenProc = StubGetSourceOffscreen;
+	filterRunRecord.getDestinationOffscreenProc = StubGetDestinationOffscreen;
+	filterRunRecord.getSelectAreaRectProc = StubGetSelectAreaRect;
+	filterRunRecord.updateDestinationOffscreenRectProc = StubUpdateDestinationOffscreenRect;
+	filterRunRecord.setProgressTotalProc = StubSetProgressTotal;
+	filterRunRecord.setProgressDoneProc = StubSetProgressDone;
+	filterRunRecord.processProc = StubProcess;
+
+	TriglavPlugInStringService stringService;
+	memset(&stringService, 0, sizeof(stringService));
+	stringService.createWithAsciiStringProc = StubStringCreateWithAscii;
+	stringService.createWithStringIDProc = StubStringCreateWithID;
+	stringService.releaseProc = StubStringRelease;
+
+	TriglavPlugInPropertyService propertyService;
+	memset(&propertyService, 0, sizeof(propertyService));
+	propertyService.createProc = StubPropertyCreate;
+	propertyService.releaseProc = StubPropertyRelease;
+	propertyService.addItemProc = StubPropertyAddItem;
+	propertyService.setIntegerValueProc = StubPropertySetInteger;
+	propertyService.getIntegerValueProc = StubPropertyGetInteger;
+	propertyService.setIntegerDefaultValueProc = StubPropertySetIntegerIgnored;
+	propertyService.setIntegerMinValueProc = StubPropertySetIntegerIgnored;
+	propertyService.setIntegerMaxValueProc = StubPropertySetIntegerIgnored;
+	propertyService.setDecimalValueProc = StubPropertySetDecimal;
+	propertyService.getDecimalValueProc = StubPropertyGetDecimal;
+	propertyService.setDecimalDefaultValueProc = StubPropertySetDecimalIgnored;
+	propertyService.setDecimalMinValueProc = StubPropertySetDecimalIgnored;
+	propertyService.setDecimalMaxValueProc = StubPropertySetDecimalIgnored;
+	// Enumeration values are stored like integers
+	propertyService.addEnumerationItemProc = StubPropertyAddEnumerationItem;
+	propertyService.setEnumerationValueProc = StubPropertySetInteger;
+	propertyService.getEnumerationValueProc = StubPropertyGetInteger;
+	propertyService.setEnumerationDefaultValueProc = StubPropertySetIntegerIgnored;
+	// So are booleans (TriglavPlugInBool is an integer)
+	propertyService.setBooleanValueProc = StubPropertySetInteger;
+	propertyService.getBooleanValueProc = StubPropertyGetInteger;
+	propertyService.setBooleanDefaultValueProc = StubPropertySetIntegerIgnored;
+
+	TriglavPlugInBitmapService bitmapService;
+	memset(&bitmapService, 0, sizeof(bitmapService));
+	bitmapService.createProc = StubBitmapCreate;
+	bitmapService.releaseProc = StubBitmapRelease;
+	bitmapService.getAddressProc = StubBitmapGetAddress;
+	bitmapService.getRowBytesProc = StubBitmapGetRowBytes;
+	bitmapService.getPixelBytesProc = StubBitmapGetPixelBytes;
+
+	TriglavPlugInOffscreenService offscreenService;
+	memset(&offscreenService, 0, sizeof(offscreenService));
+	offscreenService.getExtentRectProc = StubOffscreenGetExtentRect;
+	offscreenService.getBitmapProc = StubOffscreenGetBitmap;
+	offscreenService.setBitmapProc = StubOffscreenSetBitmap;
+	offscreenService.getChannelOrderProc = StubOffscreenGetChannelOrder;
+	offscreenService.getRGBChannelIndexProc = StubOffscreenGetRGBChannelIndex;
+
+	TriglavPlugInServer server;
+	memset(&server, 0, sizeof(server));
+	server.recordSuite.moduleInitializeRecord = &moduleInitializeRecord;
+	server.serviceSuite.stringService = &stringService;
+	server.serviceSuite.propertyService = &propertyService;
+	server.serviceSuite.bitmapService = &bitmapService;
+	server.serviceSuite.offscreenService = &offscreenService;
+	server.hostObject = reinterpret_cast<TriglavPlugInHostObject>(&host);
+
+	TriglavPlugInInt result = kTriglavPlugInCallResultFailed;
+	TriglavPlugInPtr data = NULL;
+	TriglavPluginCall(&result, &data, kTriglavPlugInSelectorModuleInitialize, &server, NULL);
+	if (result != kTriglavPlugInCallResultSuccess) { fprintf(stderr, "ModuleInitialize failed\n"); return 1; }
+
+	server.recordSuite.moduleInitializeRecord = NULL;
+	server.recordSuite.filterInitializeRecord = &filterInitializeRecord;
+	TriglavPluginCall(&result, &data, kTriglavPlugInSelectorFilterInitialize, &server, NULL);
+	if (result != kTriglavPlugInCallResultSuccess || host.pProperty == NULL) { fprintf(stderr, "FilterInitialize failed\n"); return 1; }
+
+	// Property values as the user would set them in the panel
+	host.pProperty->items[kStubItemKeyCellSize].integerValue = cellSize;
+	host.pProperty->items[kStubItemKeyCompactness].decimalValue = compactness;
+	host.pProperty->items[kStubItemKeyEngine].integerValue = engine;
+	host.pProperty->items[kStubItemKeyActiveSet].integerValue = activeSet;
+	host.pProperty->items[kStubItemKeyHierarchy].integerValue = hierarchy;
+
+	server.recordSuite.filterInitializeRecord = NULL;
+	server.recordSuite.filterRunRecord = &filterRunRecord;
+	bool runOk = true;
+	for (int run = 0; run < runs && runOk; run++) {
+		host.processCalls = 0;
+		host.source.readCount = 0;
+		host.updateCount = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		TriglavPluginCall(&result, &data, kTriglavPlugInSelectorFilterRun, &server, NULL);
+		double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		fprintf(stderr, "\nFilterRun: %s, %d process polls, %d source reads, %d destination updates, %.1f ms\n", (result == kTriglavPlugInCallResultSuccess) ? "success" : "failed", host.processCalls, host.source.readCount, host.updateCount, elapsedMs);
+		runOk = (result == kTriglavPlugInCallResultSuccess);
+	}
+
+	server.recordSuite.filterRunRecord = NULL;
+	TriglavPluginCall(&result, &data, kTriglavPlugInSelectorFilterTerminate, &server, NULL);
+	TriglavPluginCall(&result, &data, kTriglavPlugInSelectorModuleTerminate, &server, NULL);
+	if (host.pProperty != NULL) StubPropertyRelease(reinterpret_cast<TriglavPlugInPropertyObject>(host.pProperty));
+
+	if (!runOk) return 1;
+	UnpackPixels(host.destination.packed, host.destination.format, host.destination.image);
+	if (!SaveImageFile(outputPath, host.destination.image, error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	return 0;
+}